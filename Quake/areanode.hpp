@@ -11,5 +11,8 @@ struct areanode_t
     link_t solid_edicts;
 };
 
+// SV_ClearWorld picks the depth from the world size, between AREA_DEPTH and
+// AREA_MAX_DEPTH (or sv_areadepth)
 #define AREA_DEPTH 4
-#define AREA_NODES 32
+#define AREA_MAX_DEPTH 8
+#define AREA_NODES ((2 << AREA_MAX_DEPTH) - 1)
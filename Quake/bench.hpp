@@ -0,0 +1,97 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Phase timers shared by the server and client benchmarks. Each benchmark
+// owns an array of `PhaseStats` and hands `startTimer` the entry to fill, or
+// `nullptr` when it isn't running, which costs a single branch.
+
+namespace quake::bench
+{
+
+struct PhaseStats
+{
+    std::chrono::steady_clock::duration time{};
+    std::chrono::steady_clock::time_point start{}; // of the outermost call
+    std::uint64_t calls{};
+    std::uint64_t allocations{};
+    std::uint64_t allocatedBytes{};
+    int depth{};
+};
+
+// Innermost phase being timed on this thread, which heap allocations are
+// charged to by the benchmarks that count them.
+inline thread_local PhaseStats* currentPhase{nullptr};
+
+// A phase being timed, from `startTimer` until `stopTimer`. Nested calls of
+// the same phase (e.g. QC touching an entity whose touch function is QC
+// again) count once. This is deliberately not RAII: the timed code is left
+// by the longjmp in Host_Error and Host_EndGame, which must not skip over
+// destructors. Whoever handles that calls `closePhases` instead.
+struct Timer
+{
+    PhaseStats* stats;
+    PhaseStats* outer;
+};
+
+[[nodiscard]] inline Timer startTimer(PhaseStats* const stats) noexcept
+{
+    const Timer timer{stats, currentPhase};
+    if(!stats)
+    {
+        return timer;
+    }
+
+    currentPhase = stats;
+    if(stats->depth++ == 0)
+    {
+        stats->start = std::chrono::steady_clock::now();
+    }
+
+    return timer;
+}
+
+inline void stopTimer(const Timer& timer) noexcept
+{
+    // nothing to do if `closePhases` already finished it
+    if(!timer.stats || timer.stats->depth == 0)
+    {
+        return;
+    }
+
+    currentPhase = timer.outer;
+    if(--timer.stats->depth == 0)
+    {
+        timer.stats->time += std::chrono::steady_clock::now() -
+                             timer.stats->start;
+        ++timer.stats->calls;
+    }
+}
+
+// Stops every phase that is still running, as if `stopTimer` was called now
+// for each of them.
+inline void closePhases(PhaseStats* const stats, const int count) noexcept
+{
+    const auto now = std::chrono::steady_clock::now();
+    for(int i = 0; i < count; i++)
+    {
+        if(stats[i].depth > 0)
+        {
+            stats[i].time += now - stats[i].start;
+            ++stats[i].calls;
+            stats[i].depth = 0;
+        }
+    }
+
+    currentPhase = nullptr;
+}
+
+[[nodiscard]] inline double toMs(
+    const std::chrono::steady_clock::duration d) noexcept
+{
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+} // namespace quake::bench
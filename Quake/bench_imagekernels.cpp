@@ -0,0 +1,223 @@
+// Micro-benchmark for the texture manager's pixel kernels. Times every SIMD
+// level the CPU supports on texture sizes typical of Quake content, and
+// fails if any level's output differs from the scalar kernel's.
+//
+// Usage: quakevr-bench-imagekernels [iterations]
+
+#include "image_kernels.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+using quake::simd::Level;
+
+struct Size
+{
+    const char* what;
+    int width;
+    int height;
+};
+
+// wall textures, player skin, conchars-sized pic and an external hi-res one
+constexpr Size sizes[] = {
+    {"wall", 64, 64},
+    {"wall", 128, 128},
+    {"wall", 256, 256},
+    {"skin", 296, 194},
+    {"pic", 320, 200},
+    {"external", 1024, 1024},
+};
+
+[[nodiscard]] int padSize(const int s)
+{
+    int i = 1;
+    while(i < s)
+    {
+        i <<= 1;
+    }
+    return i;
+}
+
+template <typename T>
+[[nodiscard]] std::vector<T> randomPixels(std::size_t count, std::mt19937& rng)
+{
+    std::uniform_int_distribution<unsigned int> dist;
+    std::vector<T> res(count);
+    for(T& p : res)
+    {
+        p = static_cast<T>(dist(rng));
+    }
+    return res;
+}
+
+// Runs `f` on a fresh copy of `input` each iteration and returns the
+// average time per call in microseconds, not counting the copies.
+template <typename T, typename F>
+[[nodiscard]] double timeKernel(const std::vector<T>& input,
+    std::vector<T>& scratch, const int iterations, F&& f)
+{
+    using clock = std::chrono::steady_clock;
+    clock::duration total{};
+
+    for(int i = 0; i < iterations; ++i)
+    {
+        scratch = input;
+        const auto start = clock::now();
+        f(scratch);
+        total += clock::now() - start;
+    }
+
+    return std::chrono::duration<double, std::micro>(total).count() /
+           iterations;
+}
+
+bool failed = false;
+
+template <typename T>
+void report(const char* kernel, const Size& size, const Level level,
+    const double us, const double scalarUs, const std::vector<T>& out,
+    const std::vector<T>& expected)
+{
+    const bool same = out == expected;
+    failed |= !same;
+
+    std::printf("%-12s %-8s %4dx%-4d %-6s %9.2f us  %5.2fx%s\n", kernel,
+        size.what, size.width, size.height, quake::simd::levelName(level), us,
+        scalarUs / us, same ? "" : "  MISMATCH");
+}
+
+void benchSize(const Size& size, const int iterations, std::mt19937& rng)
+{
+    const int w = size.width;
+    const int h = size.height;
+    const std::size_t pixels = std::size_t(w) * h;
+
+    // the resampler reads (with zero weight) one row and pixel past the end
+    const auto rgba = randomPixels<std::uint32_t>(pixels + w + 1, rng);
+    const auto indexed = randomPixels<std::uint8_t>(pixels, rng);
+    const auto palette = randomPixels<std::uint32_t>(256, rng);
+
+    const int padw = padSize(w);
+    const int padh = padSize(h);
+
+    const Level detected = quake::simd::detectedLevel();
+
+    std::vector<std::uint32_t> scratch;
+    std::vector<std::uint32_t> out;
+    std::vector<std::uint32_t> expected;
+    std::vector<std::uint8_t> indexedScratch;
+    double scalarUs = 0;
+
+    for(int l = 0; l <= static_cast<int>(detected); ++l)
+    {
+        const auto level = static_cast<Level>(l);
+        const double us = timeKernel(rgba, scratch, iterations,
+            [&](std::vector<std::uint32_t>& data) {
+                quake::image::mipMapW(level, data.data(), w, h);
+            });
+
+        out.assign(scratch.begin(), scratch.begin() + pixels / 2);
+        if(l == 0)
+        {
+            expected = out;
+            scalarUs = us;
+        }
+        report("mipMapW", size, level, us, scalarUs, out, expected);
+    }
+
+    for(int l = 0; l <= static_cast<int>(detected); ++l)
+    {
+        const auto level = static_cast<Level>(l);
+        const double us = timeKernel(rgba, scratch, iterations,
+            [&](std::vector<std::uint32_t>& data) {
+                quake::image::mipMapH(level, data.data(), w, h);
+            });
+
+        const std::size_t outPixels = std::size_t(w) * (h / 2);
+        out.assign(scratch.begin(), scratch.begin() + outPixels);
+        if(l == 0)
+        {
+            expected = out;
+            scalarUs = us;
+        }
+        report("mipMapH", size, level, us, scalarUs, out, expected);
+    }
+
+    if(padw != w || padh != h)
+    {
+        for(const bool alpha : {false, true})
+        {
+            for(int l = 0; l <= static_cast<int>(detected); ++l)
+            {
+                const auto level = static_cast<Level>(l);
+                out.assign(std::size_t(padw) * padh, 0);
+
+                const double us = timeKernel(rgba, scratch, iterations,
+                    [&](std::vector<std::uint32_t>& data) {
+                        quake::image::resample(level, data.data(), w, h,
+                            out.data(), padw, padh, alpha);
+                    });
+
+                if(l == 0)
+                {
+                    expected = out;
+                    scalarUs = us;
+                }
+                report(alpha ? "resampleA" : "resample", size, level, us,
+                    scalarUs, out, expected);
+            }
+        }
+    }
+
+    for(int l = 0; l <= static_cast<int>(detected); ++l)
+    {
+        const auto level = static_cast<Level>(l);
+        out.assign(pixels, 0);
+
+        const double us = timeKernel(indexed, indexedScratch, iterations,
+            [&](std::vector<std::uint8_t>& data) {
+                quake::image::palette8to32(
+                    level, data.data(), pixels, palette.data(), out.data());
+            });
+
+        if(l == 0)
+        {
+            expected = out;
+            scalarUs = us;
+        }
+        report("8to32", size, level, us, scalarUs, out, expected);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const int iterations = argc > 1 ? std::max(std::atoi(argv[1]), 1) : 200;
+
+    std::printf("detected SIMD level: %s, %d iterations\n\n",
+        quake::simd::levelName(quake::simd::detectedLevel()), iterations);
+
+    std::mt19937 rng{1996};
+    for(const Size& size : sizes)
+    {
+        benchSize(size, iterations, rng);
+    }
+
+    if(failed)
+    {
+        std::printf("\nSIMD output differs from scalar output\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -431,7 +431,7 @@ static void BGM_UpdateStream()
     /* see how many samples should be copied into the raw buffer */
     if(s_rawend < paintedtime)
     {
-        s_rawend = paintedtime;
+        s_rawend = paintedtime.load();
     }
 
     while(s_rawend < paintedtime + MAX_RAW_SAMPLES)
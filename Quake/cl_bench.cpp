@@ -0,0 +1,370 @@
+/*
+Copyright (C) 1996-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+// cl_bench.cpp -- client timedemo benchmark. The demo is driven by the
+// regular host frames, so `cl_bench` only sets up a timedemo, collects one
+// sample per frame and reports once the demo is over.
+
+#include "cl_bench.hpp"
+#include "quakedef.hpp"
+#include "host.hpp"
+#include "client.hpp"
+#include "cmd.hpp"
+#include "common.hpp"
+#include "console.hpp"
+#include "cvar.hpp"
+#include "glquake.hpp"
+#include "sys.hpp"
+#include "json.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+extern cvar_t host_framerate;
+extern cvar_t host_timescale;
+
+namespace quake::clbench
+{
+
+bool enabled{false};
+PhaseStats stats[static_cast<int>(Phase::Count)];
+bool allocationsCounted{false};
+
+} // namespace quake::clbench
+
+namespace
+{
+
+struct BenchParams
+{
+    std::string demo;
+    double frametime{1.0 / 72.0};
+    unsigned int seed{1};
+    std::string outfile;
+};
+
+BenchParams params;
+bool quitWhenDone{false};
+bool quitPending{false};
+
+std::vector<double> frameMs;
+std::chrono::steady_clock::duration sampled{};
+double clientMs;
+std::chrono::steady_clock::time_point start;
+
+float oldFramerate;
+float oldTimescale;
+
+using quake::bench::toMs;
+
+[[nodiscard]] const char* phaseName(const quake::clbench::Phase phase) noexcept
+{
+    using quake::clbench::Phase;
+
+    switch(phase)
+    {
+        case Phase::Read: return "read";
+        case Phase::Parse: return "parse";
+        case Phase::ParseTEnts: return "parse_tents";
+        case Phase::Load: return "load";
+        case Phase::Relink: return "relink";
+        case Phase::UpdateTEnts: return "update_tents";
+        case Phase::Particles: return "particles";
+        default: return "unknown";
+    }
+}
+
+// Time spent in the client this frame, without the level loads that the
+// timedemo itself doesn't count either.
+[[nodiscard]] std::chrono::steady_clock::duration CL_Bench_ClientTime()
+{
+    using namespace quake::clbench;
+
+    const auto time = [](const Phase phase) {
+        return stats[static_cast<int>(phase)].time;
+    };
+
+    return time(Phase::Read) + time(Phase::Parse) - time(Phase::Load) +
+           time(Phase::Relink) + time(Phase::UpdateTEnts) +
+           time(Phase::Particles);
+}
+
+void CL_Bench_Start(const BenchParams& newParams)
+{
+    using namespace quake::clbench;
+
+    if(cls.state == ca_dedicated)
+    {
+        Con_Printf("cl_bench: not available on a dedicated server\n");
+        return;
+    }
+
+    if(enabled)
+    {
+        Con_Printf("cl_bench: a benchmark is already running\n");
+        return;
+    }
+
+    // The demo loop would start the next demo once this one disconnects.
+    cls.demonum = -1;
+
+    Cmd_ExecuteString(va("timedemo %s", newParams.demo.c_str()), src_command);
+    if(!cls.timedemo)
+    {
+        Con_Printf("cl_bench: couldn't play %s\n", newParams.demo.c_str());
+        quitPending = quitWhenDone;
+        return;
+    }
+
+    params = newParams;
+
+    // Frame times come from the cvars rather than the clock, so that lerping
+    // and particles advance the same way on every run.
+    oldFramerate = host_framerate.value;
+    oldTimescale = host_timescale.value;
+    Cvar_SetValueQuick(&host_framerate, params.frametime);
+    Cvar_SetValueQuick(&host_timescale, 0);
+
+    srand(params.seed);
+    R_SeedParticles(params.seed);
+
+    for(PhaseStats& s : stats)
+    {
+        s = {};
+    }
+
+    frameMs.clear();
+    sampled = {};
+    clientMs = 0;
+    start = std::chrono::steady_clock::now();
+    enabled = true;
+}
+
+void CL_Bench_Report()
+{
+    using namespace quake::clbench;
+
+    const auto total = std::chrono::steady_clock::now() - start;
+
+    nlohmann::json result;
+    result["demo"] = params.demo;
+    result["seed"] = params.seed;
+    result["frametime"] = params.frametime;
+    result["frames"] = frameMs.size();
+    result["total_ms"] = toMs(total);
+    result["client_ms"] = clientMs;
+
+    if(!frameMs.empty())
+    {
+        std::vector<double> sorted = frameMs;
+        std::sort(sorted.begin(), sorted.end());
+
+        const auto percentile = [&](const double p) {
+            return sorted[static_cast<std::size_t>(p * (sorted.size() - 1))];
+        };
+
+        result["frame_ms"] = {
+            {"mean", clientMs / frameMs.size()},
+            {"p50", percentile(0.5)},
+            {"p95", percentile(0.95)},
+            {"p99", percentile(0.99)},
+            {"max", sorted.back()},
+        };
+    }
+
+    std::uint64_t allocations = 0;
+    std::uint64_t allocatedBytes = 0;
+
+    for(int i = 0; i < static_cast<int>(Phase::Count); i++)
+    {
+        const PhaseStats& s = stats[i];
+        nlohmann::json& phase = result["phases"][phaseName(
+            static_cast<Phase>(i))];
+        phase = {
+            {"total_ms", toMs(s.time)},
+            {"calls", s.calls},
+            {"per_frame_ms",
+                frameMs.empty() ? 0.0 : toMs(s.time) / frameMs.size()},
+        };
+
+        if(allocationsCounted)
+        {
+            phase["allocations"] = s.allocations;
+            phase["allocated_bytes"] = s.allocatedBytes;
+        }
+
+        allocations += s.allocations;
+        allocatedBytes += s.allocatedBytes;
+    }
+
+    // only `quakevr-timedemo` counts them, see cl_bench_alloc.cpp
+    if(allocationsCounted)
+    {
+        result["allocations"] = allocations;
+        result["allocated_bytes"] = allocatedBytes;
+    }
+
+    const std::string text = result.dump(4);
+    Con_Printf("%s\n", text.c_str());
+
+    if(!params.outfile.empty())
+    {
+        char name[MAX_OSPATH];
+        q_snprintf(
+            name, sizeof(name), "%s/%s", com_gamedir, params.outfile.c_str());
+
+        FILE* f = fopen(name, "w");
+        if(!f)
+        {
+            Con_Printf("cl_bench: couldn't write %s\n", name);
+            return;
+        }
+
+        fprintf(f, "%s\n", text.c_str());
+        fclose(f);
+        Con_Printf("cl_bench: wrote %s\n", name);
+    }
+}
+
+} // namespace
+
+/*
+==================
+CL_Bench_f
+
+cl_bench <demo> [frametime] [seed] [outfile]
+==================
+*/
+static void CL_Bench_f()
+{
+    if(Cmd_Argc() < 2)
+    {
+        Con_Printf(
+            "cl_bench <demo> [frametime] [seed] [outfile]: time the client "
+            "side of a demo and print the timings as JSON\n");
+        return;
+    }
+
+    if(cmd_source != src_command)
+    {
+        return;
+    }
+
+    BenchParams newParams;
+    newParams.demo = Cmd_Argv(1);
+    if(Cmd_Argc() > 2)
+    {
+        newParams.frametime = q_max(Q_atof(Cmd_Argv(2)), 0.001f);
+    }
+    if(Cmd_Argc() > 3)
+    {
+        newParams.seed = strtoul(Cmd_Argv(3), nullptr, 10);
+    }
+    if(Cmd_Argc() > 4)
+    {
+        newParams.outfile = Cmd_Argv(4);
+    }
+
+    CL_Bench_Start(newParams);
+}
+
+void CL_Bench_Init()
+{
+    Cmd_AddCommand("cl_bench", CL_Bench_f);
+}
+
+void CL_Bench_EndFrame()
+{
+    using namespace quake::clbench;
+
+    // Quits here rather than through `quit`, which asks for confirmation
+    // unless the console is up, and out of the frame the demo ended in.
+    if(quitPending)
+    {
+        CL_Disconnect();
+        Host_ShutdownServer(false);
+        Sys_Quit();
+    }
+
+    if(!enabled)
+    {
+        return;
+    }
+
+    // Frames spent connecting to a level are left out, like the timedemo
+    // leaves out its first frame.
+    const auto clientTime = CL_Bench_ClientTime();
+    if(cls.signon == SIGNONS)
+    {
+        frameMs.push_back(toMs(clientTime - sampled));
+        clientMs += frameMs.back();
+    }
+    sampled = clientTime;
+}
+
+void CL_Bench_Finish()
+{
+    using namespace quake::clbench;
+
+    if(!enabled)
+    {
+        return;
+    }
+
+    // The demo usually ends with a disconnect that longjmps out of the
+    // parser once this returns, so the phases it is still in are finished
+    // here and the timers it skips find nothing left to stop.
+    enabled = false;
+    quake::bench::closePhases(stats, static_cast<int>(Phase::Count));
+    Cvar_SetValueQuick(&host_framerate, oldFramerate);
+    Cvar_SetValueQuick(&host_timescale, oldTimescale);
+
+    CL_Bench_Report();
+    quitPending = quitWhenDone;
+}
+
+void CL_Bench_QueueFromCommandLine()
+{
+    const int i = COM_CheckParm("-clbench");
+    if(!i)
+    {
+        return;
+    }
+
+    // the arguments of `cl_bench` follow the flag, up to the next option
+    std::string cmd = "cl_bench";
+    for(int j = i + 1; j < com_argc; j++)
+    {
+        if(com_argv[j][0] == '-' || com_argv[j][0] == '+')
+        {
+            break;
+        }
+
+        cmd += ' ';
+        cmd += com_argv[j];
+    }
+
+    quitWhenDone = true;
+    Cbuf_AddText(va("%s\n", cmd.c_str()));
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "bench.hpp"
+
+// Client timedemo benchmark: `cl_bench` plays a demo as `timedemo` does, with
+// a fixed frame time, and reports as JSON how long the client spent reading,
+// parsing and simulating it, and, in `quakevr-timedemo`, how often each part
+// allocated. Rendering is not timed, so the timings mean the same in
+// `quakevr-timedemo`, which has no renderer at all, as in the regular client.
+
+namespace quake::clbench
+{
+
+enum class Phase : int
+{
+    Read = 0,    // CL_GetMessage, demo file reads and keyframe captures
+    Parse,       // CL_ParseServerMessage, includes ParseTEnts and Load
+    ParseTEnts,  // CL_ParseTEnt, temp entity messages
+    Load,        // CL_ParseServerInfo, precaching models on level changes
+    Relink,      // CL_RelinkEntities
+    UpdateTEnts, // CL_UpdateTEnts, beams and other temp entities
+    Particles,   // CL_RunParticles
+    Count
+};
+
+using PhaseStats = quake::bench::PhaseStats;
+
+extern bool enabled;
+extern PhaseStats stats[static_cast<int>(Phase::Count)];
+
+// Set by the allocation hooks in cl_bench_alloc.cpp, which only
+// `quakevr-timedemo` links: the VR client keeps the default operator new.
+extern bool allocationsCounted;
+
+[[nodiscard]] inline quake::bench::Timer startTimer(const Phase phase) noexcept
+{
+    return quake::bench::startTimer(
+        enabled ? &stats[static_cast<int>(phase)] : nullptr);
+}
+
+using quake::bench::stopTimer;
+
+} // namespace quake::clbench
+
+void CL_Bench_Init();
+
+// Called by the host once per frame, after the client has run.
+void CL_Bench_EndFrame();
+
+// Called when a timedemo ends, reports the results if `cl_bench` started it.
+void CL_Bench_Finish();
+
+// Queues `cl_bench` when started with `-clbench`, which then quits once the
+// demo is over.
+void CL_Bench_QueueFromCommandLine();
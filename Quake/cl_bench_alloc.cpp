@@ -0,0 +1,82 @@
+/*
+Copyright (C) 1996-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+// cl_bench_alloc.cpp -- heap allocation counting for `cl_bench`. This
+// replaces the global operator new and delete, so it is only linked into
+// `quakevr-timedemo` and never into the shipped client.
+
+#include "cl_bench.hpp"
+
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+
+[[maybe_unused]] const bool registered =
+    (quake::clbench::allocationsCounted = true);
+
+} // namespace
+
+// Heap allocations are charged to the innermost phase being timed. Nothing
+// is counted while no benchmark is running, which is one thread local load
+// per allocation.
+void* operator new(const std::size_t size)
+{
+    if(quake::bench::PhaseStats* const phase = quake::bench::currentPhase)
+    {
+        ++phase->allocations;
+        phase->allocatedBytes += size;
+    }
+
+    if(void* const ptr = std::malloc(size ? size : 1))
+    {
+        return ptr;
+    }
+
+    throw std::bad_alloc{};
+}
+
+void* operator new[](const std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* const ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* const ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* const ptr, const std::size_t size) noexcept
+{
+    (void)size;
+    std::free(ptr);
+}
+
+void operator delete[](void* const ptr, const std::size_t size) noexcept
+{
+    (void)size;
+    std::free(ptr);
+}
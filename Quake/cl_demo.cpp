@@ -31,6 +31,15 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "sys.hpp"
 #include "cmd.hpp"
 #include "gl_texmgr.hpp"
+#include "glquake.hpp"
+#include "render.hpp"
+#include "sbar.hpp"
+#include "cl_bench.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
 
 static void CL_FinishTimeDemo();
 
@@ -51,6 +60,533 @@ read from the demo file.
 static byte demo_head[3][MAX_MSGLEN];
 static int demo_head_size[2];
 
+/*
+==============================================================================
+
+DEMO WRITER
+
+While recording, messages are appended to a single producer, single consumer
+ring. A writer thread empties it into cls.demofile in large blocks, so the
+client frame only waits on the disk when the ring is full.
+
+==============================================================================
+*/
+
+#define DEMO_RINGSIZE (4 * 1024 * 1024) // must be a power of two
+
+// how long the writer sleeps between writes; at most this much of the demo
+// is lost if the process is killed outright
+#define DEMO_WRITER_INTERVAL_MS 100
+
+static byte demo_ring[DEMO_RINGSIZE];
+static std::atomic<unsigned int> demo_ringhead; // next byte to append
+static std::atomic<unsigned int> demo_ringtail; // next byte to write out
+
+static std::thread demo_writer;
+static std::atomic<bool> demo_writerquit = false;
+
+static int demo_stalls; // appends that had to wait for the writer
+
+static long long demo_written; // bytes of messages recorded so far
+
+/*
+====================
+CL_DemoWriteOut
+
+writes everything in the ring to the demo file, in at most two contiguous
+blocks
+====================
+*/
+static void CL_DemoWriteOut()
+{
+    const unsigned int head = demo_ringhead.load(std::memory_order_acquire);
+    unsigned int tail = demo_ringtail.load(std::memory_order_relaxed);
+
+    if(head == tail)
+    {
+        return;
+    }
+
+    while(tail != head)
+    {
+        const unsigned int offset = tail & (DEMO_RINGSIZE - 1);
+        const unsigned int len = q_min(head - tail, DEMO_RINGSIZE - offset);
+
+        fwrite(&demo_ring[offset], len, 1, cls.demofile);
+        tail += len;
+        demo_ringtail.store(tail, std::memory_order_release);
+    }
+
+    fflush(cls.demofile);
+}
+
+static void CL_DemoWriterThread()
+{
+    while(!demo_writerquit)
+    {
+        CL_DemoWriteOut();
+        std::this_thread::sleep_for(
+            std::chrono::milliseconds(DEMO_WRITER_INTERVAL_MS));
+    }
+
+    CL_DemoWriteOut();
+}
+
+static void CL_StartDemoWriter()
+{
+    demo_ringhead = 0;
+    demo_ringtail = 0;
+    demo_stalls = 0;
+    demo_written = 0;
+    demo_writerquit = false;
+    demo_writer = std::thread{CL_DemoWriterThread};
+}
+
+/*
+====================
+CL_StopDemoWriter
+
+waits for the writer to put everything appended so far in the file
+====================
+*/
+static void CL_StopDemoWriter()
+{
+    if(!demo_writer.joinable())
+    {
+        return;
+    }
+
+    demo_writerquit = true;
+    demo_writer.join();
+
+    if(demo_stalls)
+    {
+        Con_DPrintf("demo writer: ring was full %i times\n", demo_stalls);
+    }
+}
+
+static void CL_DemoAppend(const void* data, unsigned int len)
+{
+    const byte* src = (const byte*)data;
+    unsigned int head = demo_ringhead.load(std::memory_order_relaxed);
+    bool stalled = false;
+
+    while(len)
+    {
+        const unsigned int tail =
+            demo_ringtail.load(std::memory_order_acquire);
+        const unsigned int space = DEMO_RINGSIZE - (head - tail);
+        if(!space)
+        {
+            // sleep rather than spin, the writer may share our core
+            if(!stalled)
+            {
+                demo_stalls++;
+                stalled = true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        const unsigned int offset = head & (DEMO_RINGSIZE - 1);
+        const unsigned int chunk =
+            q_min(q_min(len, space), DEMO_RINGSIZE - offset);
+
+        memcpy(&demo_ring[offset], src, chunk);
+        src += chunk;
+        len -= chunk;
+        head += chunk;
+        demo_ringhead.store(head, std::memory_order_release);
+    }
+}
+
+/*
+==============================================================================
+
+DEMO INDEX
+
+Keyframes of the client state, taken every DEMO_KEYFRAME_INTERVAL seconds of
+game time while recording or playing back. Each one holds what the messages
+before it left behind that later messages don't resend: stats, scores,
+lightstyles and, with replacement deltas, the entity states the deltas apply
+to. Seeking restores the closest keyframe and parses only the messages after
+it.
+
+The keyframes are saved next to the demo as <demo>.idx, so that seeking in a
+demo that has been recorded or played once doesn't need to parse it again.
+Offsets count from the first message, after the cd track line.
+
+==============================================================================
+*/
+
+#define DEMO_KEYFRAME_INTERVAL 10.0 // seconds of game time
+
+#define DEMO_INDEX_MAGIC 0x58444951 // "QIDX"
+#define DEMO_INDEX_VERSION 1
+
+cvar_t cl_demoindex = {"cl_demoindex", "1", CVAR_ARCHIVE};
+
+typedef struct
+{
+    long long offset;     // of the next message
+    long long levelstart; // of the message with the level's serverinfo
+    double mtime[2];
+    qvec3 mviewangles[2];
+    int stats[MAX_CL_STATS];
+    float statsf[MAX_CL_STATS];
+    int items;
+    int intermission;
+    int completed_time;
+    int viewentity;
+} demokeyframe_header_t;
+
+typedef struct
+{
+    char name[MAX_SCOREBOARDNAME];
+    float entertime;
+    int frags;
+    int colors;
+    int ping;
+} demokeyframe_score_t;
+
+typedef struct
+{
+    int index;
+    char map[MAX_STYLESTRING];
+} demokeyframe_lightstyle_t;
+
+typedef struct
+{
+    int num;
+    entity_state_t state;
+} demokeyframe_entity_t;
+
+struct demokeyframe_t
+{
+    demokeyframe_header_t h;
+    std::vector<demokeyframe_score_t> scores;
+    std::vector<demokeyframe_lightstyle_t> lightstyles;
+    std::vector<demokeyframe_entity_t> entities; // replacement deltas only
+};
+
+typedef struct
+{
+    int magic;
+    int version;
+    int headersize; // all the sizes are checked so that an index saved by a
+    int scoresize;  // different build is rebuilt rather than misread
+    int lightstylesize;
+    int entitysize;
+    long long demosize; // bytes of messages in the demo it belongs to
+    int numkeyframes;
+} demoindex_header_t;
+
+static std::vector<demokeyframe_t> demo_keyframes; // in offset order
+static bool demo_indexdirty;            // has keyframes the .idx doesn't
+static char demo_indexpath[MAX_OSPATH]; // where to save the .idx
+
+static long long demo_msgoffset;  // of the message being parsed
+static long long demo_levelstart; // of the current level's serverinfo
+static long demo_filestart;       // cls.demofile position of offset 0
+static long long demo_size;       // bytes of messages in the demo played
+
+/*
+====================
+CL_CaptureDemoKeyframe
+
+takes a keyframe at `offset` if the last one is far enough behind
+====================
+*/
+static void CL_CaptureDemoKeyframe(const long long offset)
+{
+    if(cls.signon != SIGNONS)
+    {
+        return;
+    }
+
+    if(!demo_keyframes.empty())
+    {
+        const demokeyframe_header_t& last = demo_keyframes.back().h;
+        if(offset <= last.offset)
+        {
+            return; // already indexed
+        }
+
+        if(last.levelstart == demo_levelstart &&
+            cl.mtime[0] < last.mtime[0] + DEMO_KEYFRAME_INTERVAL)
+        {
+            return;
+        }
+    }
+
+    demokeyframe_t kf;
+    kf.h.offset = offset;
+    kf.h.levelstart = demo_levelstart;
+    kf.h.mtime[0] = cl.mtime[0];
+    kf.h.mtime[1] = cl.mtime[1];
+    kf.h.mviewangles[0] = cl.mviewangles[0];
+    kf.h.mviewangles[1] = cl.mviewangles[1];
+    memcpy(kf.h.stats, cl.stats, sizeof(kf.h.stats));
+    memcpy(kf.h.statsf, cl.statsf, sizeof(kf.h.statsf));
+    kf.h.items = cl.items;
+    kf.h.intermission = cl.intermission;
+    kf.h.completed_time = cl.completed_time;
+    kf.h.viewentity = cl.viewentity;
+
+    kf.scores.resize(cl.maxclients);
+    for(int i = 0; i < cl.maxclients; i++)
+    {
+        demokeyframe_score_t& score = kf.scores[i];
+        q_strlcpy(score.name, cl.scores[i].name, sizeof(score.name));
+        score.entertime = cl.scores[i].entertime;
+        score.frags = cl.scores[i].frags;
+        score.colors = cl.scores[i].colors;
+        score.ping = cl.scores[i].ping;
+    }
+
+    for(int i = 0; i < MAX_LIGHTSTYLES; i++)
+    {
+        if(cl_lightstyle[i].length)
+        {
+            demokeyframe_lightstyle_t& style = kf.lightstyles.emplace_back();
+            style.index = i;
+            q_strlcpy(style.map, cl_lightstyle[i].map, sizeof(style.map));
+        }
+    }
+
+    // without replacement deltas, every frame updates all of the visible
+    // entities from their baselines
+    if(cl.protocol_pext2 & PEXT2_REPLACEMENTDELTAS)
+    {
+        for(int i = 1; i < cl.num_entities; i++)
+        {
+            if(cl.entities[i].update_type)
+            {
+                kf.entities.push_back({i, cl.entities[i].netstate});
+            }
+        }
+    }
+
+    demo_keyframes.push_back(std::move(kf));
+    demo_indexdirty = true;
+}
+
+/*
+====================
+CL_RestoreDemoKeyframe
+
+puts the client back in the state it was at a keyframe of the current level,
+and the demo file at the message after it
+====================
+*/
+static void CL_RestoreDemoKeyframe(const demokeyframe_t& kf)
+{
+    fseek(cls.demofile, demo_filestart + kf.h.offset, SEEK_SET);
+
+    cl.mtime[0] = kf.h.mtime[0];
+    cl.mtime[1] = kf.h.mtime[1];
+    cl.mviewangles[0] = kf.h.mviewangles[0];
+    cl.mviewangles[1] = kf.h.mviewangles[1];
+    memcpy(cl.stats, kf.h.stats, sizeof(cl.stats));
+    memcpy(cl.statsf, kf.h.statsf, sizeof(cl.statsf));
+    cl.items = kf.h.items;
+    cl.intermission = kf.h.intermission;
+    cl.completed_time = kf.h.completed_time;
+    cl.viewentity = kf.h.viewentity;
+
+    for(int i = 0; i < cl.maxclients && i < (int)kf.scores.size(); i++)
+    {
+        const demokeyframe_score_t& score = kf.scores[i];
+        q_strlcpy(cl.scores[i].name, score.name, MAX_SCOREBOARDNAME);
+        cl.scores[i].entertime = score.entertime;
+        cl.scores[i].frags = score.frags;
+        cl.scores[i].ping = score.ping;
+        if(cl.scores[i].colors != score.colors)
+        {
+            cl.scores[i].colors = score.colors;
+            CL_NewTranslation(i);
+        }
+    }
+    Sbar_Changed();
+
+    std::size_t style = 0;
+    for(int i = 0; i < MAX_LIGHTSTYLES; i++)
+    {
+        const char* map = "";
+        if(style < kf.lightstyles.size() && kf.lightstyles[style].index == i)
+        {
+            map = kf.lightstyles[style++].map;
+        }
+
+        if(strcmp(cl_lightstyle[i].map, map))
+        {
+            CL_UpdateLightstyle(i, map);
+        }
+    }
+
+    if(cl.protocol_pext2 & PEXT2_REPLACEMENTDELTAS)
+    {
+        // same as the "reset all" entity removal
+        for(int i = 1; i < cl.num_entities; i++)
+        {
+            cl.entities[i].update_type = false;
+            cl.entities[i].model = nullptr;
+        }
+
+        for(const demokeyframe_entity_t& e : kf.entities)
+        {
+            entity_t* ent = CL_EntityNum(e.num);
+            ent->netstate = e.state;
+            ent->update_type = true;
+            ent->lerpflags |= LERP_RESETMOVE | LERP_RESETANIM;
+        }
+    }
+}
+
+/*
+====================
+CL_LoadDemoIndex
+
+reads the keyframes saved for the demo being played, if they match it
+====================
+*/
+static void CL_LoadDemoIndex(const char* name, const long long demosize)
+{
+    FILE* f;
+    COM_FOpenFile(name, &f, nullptr);
+    if(!f)
+    {
+        return;
+    }
+
+    demoindex_header_t header;
+    bool ok = fread(&header, sizeof(header), 1, f) == 1 &&
+              header.magic == DEMO_INDEX_MAGIC &&
+              header.version == DEMO_INDEX_VERSION &&
+              header.headersize == (int)sizeof(demokeyframe_header_t) &&
+              header.scoresize == (int)sizeof(demokeyframe_score_t) &&
+              header.lightstylesize == (int)sizeof(demokeyframe_lightstyle_t) &&
+              header.entitysize == (int)sizeof(demokeyframe_entity_t) &&
+              header.demosize == demosize;
+
+    const auto readVector = [&](auto& v, const int maxcount) {
+        int count;
+        if(!ok || fread(&count, sizeof(count), 1, f) != 1 || count < 0 ||
+            count > maxcount)
+        {
+            ok = false;
+            return;
+        }
+
+        v.resize(count);
+        ok = !count || fread(v.data(), sizeof(v[0]), count, f) == (size_t)count;
+    };
+
+    for(int i = 0; ok && i < header.numkeyframes; i++)
+    {
+        demokeyframe_t kf;
+        ok = fread(&kf.h, sizeof(kf.h), 1, f) == 1 && kf.h.viewentity >= 0 &&
+             kf.h.viewentity < MAX_EDICTS;
+        readVector(kf.scores, MAX_SCOREBOARD);
+        readVector(kf.lightstyles, MAX_LIGHTSTYLES);
+        readVector(kf.entities, MAX_EDICTS);
+
+        // strings are terminated here, and anything out of range means a
+        // damaged file, which gets rebuilt rather than trusted
+        for(demokeyframe_score_t& score : kf.scores)
+        {
+            score.name[MAX_SCOREBOARDNAME - 1] = 0;
+        }
+        for(demokeyframe_lightstyle_t& style : kf.lightstyles)
+        {
+            ok = ok && style.index >= 0 && style.index < MAX_LIGHTSTYLES;
+            style.map[MAX_STYLESTRING - 1] = 0;
+        }
+        for(const demokeyframe_entity_t& e : kf.entities)
+        {
+            ok = ok && e.num > 0 && e.num < MAX_EDICTS;
+        }
+
+        demo_keyframes.push_back(std::move(kf));
+    }
+
+    fclose(f);
+
+    if(!ok)
+    {
+        Con_DPrintf("%s is out of date, rebuilding it\n", name);
+        demo_keyframes.clear();
+        return;
+    }
+
+    Con_DPrintf("%s: %i keyframes\n", name, (int)demo_keyframes.size());
+}
+
+/*
+====================
+CL_SaveDemoIndex
+
+====================
+*/
+static void CL_SaveDemoIndex(const long long demosize)
+{
+    if(!cl_demoindex.value || !demo_indexdirty || demo_keyframes.empty())
+    {
+        return;
+    }
+
+    demo_indexdirty = false;
+
+    FILE* f = fopen(demo_indexpath, "wb");
+    if(!f)
+    {
+        Con_Printf("ERROR: couldn't write %s\n", demo_indexpath);
+        return;
+    }
+
+    demoindex_header_t header;
+    header.magic = DEMO_INDEX_MAGIC;
+    header.version = DEMO_INDEX_VERSION;
+    header.headersize = sizeof(demokeyframe_header_t);
+    header.scoresize = sizeof(demokeyframe_score_t);
+    header.lightstylesize = sizeof(demokeyframe_lightstyle_t);
+    header.entitysize = sizeof(demokeyframe_entity_t);
+    header.demosize = demosize;
+    header.numkeyframes = demo_keyframes.size();
+    fwrite(&header, sizeof(header), 1, f);
+
+    const auto writeVector = [&](const auto& v) {
+        const int count = v.size();
+        fwrite(&count, sizeof(count), 1, f);
+        if(count)
+        {
+            fwrite(v.data(), sizeof(v[0]), count, f);
+        }
+    };
+
+    for(const demokeyframe_t& kf : demo_keyframes)
+    {
+        fwrite(&kf.h, sizeof(kf.h), 1, f);
+        writeVector(kf.scores);
+        writeVector(kf.lightstyles);
+        writeVector(kf.entities);
+    }
+
+    fclose(f);
+}
+
+/*
+====================
+CL_DemoNewLevel
+
+called when a serverinfo message is parsed
+====================
+*/
+void CL_DemoNewLevel()
+{
+    demo_levelstart = demo_msgoffset;
+}
+
 /*
 ==============
 CL_StopPlayback
@@ -65,9 +601,12 @@ void CL_StopPlayback()
         return;
     }
 
+    CL_SaveDemoIndex(demo_size);
+
     fclose(cls.demofile);
     cls.demoplayback = false;
     cls.demopaused = false;
+    cls.demoseeking = false;
     cls.demofile = nullptr;
     cls.state = ca_disconnected;
 
@@ -77,32 +616,107 @@ void CL_StopPlayback()
     }
 }
 
+/*
+====================
+CL_WriteDemoPacket
+
+Records a message, prefixed by the length and view angles
+====================
+*/
+void CL_WriteDemoPacket(const byte* data, int size)
+{
+    byte header[16];
+
+    const int len = LittleLong(size);
+    memcpy(&header[0], &len, 4);
+
+    for(int i = 0; i < 3; i++)
+    {
+        const float f = LittleFloat(cl.viewangles[i]);
+        memcpy(&header[4 + i * 4], &f, 4);
+    }
+
+    CL_DemoAppend(header, sizeof(header));
+    CL_DemoAppend(data, size);
+    demo_written += sizeof(header) + size;
+}
+
 /*
 ====================
 CL_WriteDemoMessage
 
-Dumps the current net message, prefixed by the length and view angles
+Dumps the current net message
 ====================
 */
 static void CL_WriteDemoMessage()
 {
-    int len = LittleLong(net_message.cursize);
-    fwrite(&len, 4, 1, cls.demofile);
+    CL_WriteDemoPacket(net_message.data, net_message.cursize);
+}
+
+/*
+====================
+CL_FinishDemo
+
+ends the demo with a disconnect, so that playback stops there, and closes
+the file once the writer has caught up
+====================
+*/
+static void CL_FinishDemo()
+{
+    // write a disconnect message to the demo file
+    SZ_Clear(&net_message);
+    MSG_WriteByte(&net_message, svc_disconnect);
+    CL_WriteDemoMessage();
 
+    CL_StopDemoWriter();
+    fclose(cls.demofile);
+    cls.demofile = nullptr;
+    cls.demorecording = false;
+
+    CL_SaveDemoIndex(demo_written);
+}
+
+/*
+====================
+CL_ReadDemoMessage
+
+reads the next message of the demo into net_message
+====================
+*/
+static int CL_ReadDemoMessage()
+{
+    int r;
+
+    demo_msgoffset = ftell(cls.demofile) - demo_filestart;
+    CL_CaptureDemoKeyframe(demo_msgoffset);
+
+    // get the next message
+    fread(&net_message.cursize, 4, 1, cls.demofile);
+    cl.mviewangles[1] = cl.mviewangles[0];
     for(int i = 0; i < 3; i++)
     {
-        float f = LittleFloat(cl.viewangles[i]);
-        fwrite(&f, 4, 1, cls.demofile);
+        float f;
+        r = fread(&f, 4, 1, cls.demofile);
+        cl.mviewangles[0][i] = LittleFloat(f);
     }
 
-    fwrite(net_message.data, net_message.cursize, 1, cls.demofile);
-    fflush(cls.demofile);
+    net_message.cursize = LittleLong(net_message.cursize);
+    if(net_message.cursize > MAX_MSGLEN)
+    {
+        Sys_Error("Demo message > MAX_MSGLEN");
+    }
+    r = fread(net_message.data, net_message.cursize, 1, cls.demofile);
+    if(r != 1)
+    {
+        CL_StopPlayback();
+        return 0;
+    }
+
+    return 1;
 }
 
 static int CL_GetDemoMessage()
 {
-    int r;
-
     if(cls.demopaused)
     {
         return 0;
@@ -131,29 +745,7 @@ static int CL_GetDemoMessage()
         }
     }
 
-    // get the next message
-    fread(&net_message.cursize, 4, 1, cls.demofile);
-    cl.mviewangles[1] = cl.mviewangles[0];
-    for(int i = 0; i < 3; i++)
-    {
-        float f;
-        r = fread(&f, 4, 1, cls.demofile);
-        cl.mviewangles[0][i] = LittleFloat(f);
-    }
-
-    net_message.cursize = LittleLong(net_message.cursize);
-    if(net_message.cursize > MAX_MSGLEN)
-    {
-        Sys_Error("Demo message > MAX_MSGLEN");
-    }
-    r = fread(net_message.data, net_message.cursize, 1, cls.demofile);
-    if(r != 1)
-    {
-        CL_StopPlayback();
-        return 0;
-    }
-
-    return 1;
+    return CL_ReadDemoMessage();
 }
 
 /*
@@ -165,11 +757,16 @@ Handles recording and playback of demos, on top of NET_ code
 */
 int CL_GetMessage()
 {
+    const quake::bench::Timer benchTimer =
+        quake::clbench::startTimer(quake::clbench::Phase::Read);
+
     int r;
 
     if(cls.demoplayback)
     {
-        return CL_GetDemoMessage();
+        r = CL_GetDemoMessage();
+        quake::clbench::stopTimer(benchTimer);
+        return r;
     }
 
     while(true)
@@ -178,6 +775,7 @@ int CL_GetMessage()
 
         if(r != 1 && r != 2)
         {
+            quake::clbench::stopTimer(benchTimer);
             return r;
         }
 
@@ -194,6 +792,8 @@ int CL_GetMessage()
 
     if(cls.demorecording)
     {
+        CL_CaptureDemoKeyframe(demo_written);
+        demo_msgoffset = demo_written;
         CL_WriteDemoMessage();
     }
 
@@ -205,6 +805,7 @@ int CL_GetMessage()
         demo_head_size[cls.signon] = net_message.cursize;
     }
 
+    quake::clbench::stopTimer(benchTimer);
     return r;
 }
 
@@ -229,21 +830,29 @@ void CL_Stop_f()
         return;
     }
 
-    // write a disconnect message to the demo file
-    SZ_Clear(&net_message);
-    MSG_WriteByte(&net_message, svc_disconnect);
-    CL_WriteDemoMessage();
-
-    // finish up
-    fclose(cls.demofile);
-    cls.demofile = nullptr;
-    cls.demorecording = false;
+    CL_FinishDemo();
     Con_Printf("Completed demo\n");
 
     // ericw -- update demo tab-completion list
     DemoList_Rebuild();
 }
 
+/*
+====================
+CL_ShutdownDemo
+
+called on shutdown, including after a fatal error, so that a demo being
+recorded is complete on disk
+====================
+*/
+void CL_ShutdownDemo()
+{
+    if(cls.demorecording)
+    {
+        CL_FinishDemo();
+    }
+}
+
 /*
 ====================
 CL_Record_f
@@ -333,11 +942,20 @@ void CL_Record_f()
         return;
     }
 
+    COM_InvalidateFileCache();
+
     cls.forcetrack = track;
     fprintf(cls.demofile, "%i\n", cls.forcetrack);
 
+    CL_StartDemoWriter();
     cls.demorecording = true;
 
+    demo_keyframes.clear();
+    demo_indexdirty = false;
+    demo_levelstart = 0;
+    COM_StripExtension(name, demo_indexpath, sizeof(demo_indexpath));
+    COM_AddExtension(demo_indexpath, ".idx", sizeof(demo_indexpath));
+
     // from ProQuake: initialize the demo file if we're already connected
     if(c == 2 && cls.state == ca_connected)
     {
@@ -446,7 +1064,7 @@ void CL_PlayDemo_f()
 
     Con_Printf("Playing demo from %s.\n", name);
 
-    COM_FOpenFile(name, &cls.demofile, nullptr);
+    const int filesize = COM_FOpenFile(name, &cls.demofile, nullptr);
     if(!cls.demofile)
     {
         Con_Printf("ERROR: couldn't open %s\n", name);
@@ -454,6 +1072,8 @@ void CL_PlayDemo_f()
         return;
     }
 
+    const long filestart = ftell(cls.demofile);
+
     // ZOID, fscanf is evil
     // O.S.: if a space character e.g. 0x20 (' ') follows '\n',
     // fscanf skips that byte too and screws up further reads.
@@ -491,6 +1111,22 @@ void CL_PlayDemo_f()
         cls.forcetrack = -cls.forcetrack;
     }
 
+    demo_filestart = ftell(cls.demofile);
+    demo_levelstart = 0;
+    demo_keyframes.clear();
+    demo_indexdirty = false;
+
+    char indexname[MAX_OSPATH];
+    COM_StripExtension(name, indexname, sizeof(indexname));
+    COM_AddExtension(indexname, ".idx", sizeof(indexname));
+    q_snprintf(demo_indexpath, sizeof(demo_indexpath), "%s/%s", com_gamedir,
+        indexname);
+    demo_size = filesize - (demo_filestart - filestart);
+    if(cl_demoindex.value)
+    {
+        CL_LoadDemoIndex(indexname, demo_size);
+    }
+
     cls.demoplayback = true;
     cls.demopaused = false;
     cls.state = ca_connected;
@@ -521,6 +1157,8 @@ static void CL_FinishTimeDemo()
     }
     Con_Printf(
         "%i frames %5.1f seconds %5.1f fps\n", frames, time, frames / time);
+
+    CL_Bench_Finish();
 }
 
 /*
@@ -556,3 +1194,137 @@ void CL_TimeDemo_f()
     cls.td_startframe = host_framecount;
     cls.td_lastframe = -1; // get a new message this frame
 }
+
+/*
+====================
+CL_DemoSeek
+
+jumps to `target` seconds of game time on the current level of the demo by
+restoring the last keyframe before it and parsing only the messages after
+that keyframe
+====================
+*/
+static void CL_DemoSeek(double target)
+{
+    if(!cls.demoplayback)
+    {
+        Con_Printf("Not playing a demo.\n");
+        return;
+    }
+
+    if(cls.timedemo || cls.signon != SIGNONS)
+    {
+        Con_Printf("Can't seek now\n");
+        return;
+    }
+
+    target = q_max(target, 0.0);
+
+    const long long level = demo_levelstart;
+    const long long current = ftell(cls.demofile) - demo_filestart;
+
+    const demokeyframe_t* best = nullptr;
+    for(const demokeyframe_t& kf : demo_keyframes)
+    {
+        if(kf.h.levelstart == level && kf.h.mtime[0] <= target)
+        {
+            best = &kf;
+        }
+    }
+
+    if(best && (target < cl.mtime[0] || best->h.offset > current))
+    {
+        CL_RestoreDemoKeyframe(*best);
+    }
+    else if(target < cl.mtime[0])
+    {
+        // nothing indexed that early, so go through the level's signon again
+        fseek(cls.demofile, demo_filestart + level, SEEK_SET);
+        cls.signon = 0;
+    }
+
+    cls.demoseeking = true;
+    while(cls.demoplayback && (cls.signon != SIGNONS || cl.mtime[0] < target))
+    {
+        if(!CL_ReadDemoMessage())
+        {
+            break;
+        }
+
+        cl.last_received_message = realtime;
+        CL_ParseServerMessage();
+
+        if(demo_levelstart != level)
+        {
+            break; // the level ended before the target time
+        }
+    }
+    cls.demoseeking = false;
+
+    if(!cls.demoplayback)
+    {
+        return;
+    }
+
+    cl.time = cl.oldtime = cl.mtime[0];
+
+    // only the lasting state of the skipped messages is wanted, not their
+    // effects
+    memset(cl_dlights, 0, sizeof(cl_dlights));
+    memset(cl_beams, 0, sizeof(cl_beams));
+    R_ClearParticles();
+    CL_ClearTrailStates();
+}
+
+/*
+====================
+CL_DemoSeek_f
+
+demoseek <time>
+====================
+*/
+void CL_DemoSeek_f()
+{
+    if(cmd_source != src_command)
+    {
+        return;
+    }
+
+    if(Cmd_Argc() != 2)
+    {
+        Con_Printf(
+            "demoseek <time> : jump to a time in seconds on the current level "
+            "of the demo\n");
+        return;
+    }
+
+    CL_DemoSeek(Q_atof(Cmd_Argv(1)));
+}
+
+/*
+====================
+CL_DemoSkip_f
+
+demoskip [seconds]
+====================
+*/
+void CL_DemoSkip_f()
+{
+    if(cmd_source != src_command)
+    {
+        return;
+    }
+
+    if(Cmd_Argc() > 2)
+    {
+        Con_Printf(
+            "demoskip [seconds] : skip forward (or back, if negative) in the "
+            "demo, %g seconds by default\n",
+            DEMO_KEYFRAME_INTERVAL);
+        return;
+    }
+
+    const double seconds =
+        Cmd_Argc() == 2 ? Q_atof(Cmd_Argv(1)) : DEMO_KEYFRAME_INTERVAL;
+    CL_DemoSeek(cl.mtime[0] + seconds);
+}
@@ -41,6 +41,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "input.hpp"
 #include "q_sound.hpp"
 #include "crc.hpp"
+#include "cl_bench.hpp"
 
 #include <string>
 #include <vector>
@@ -468,6 +469,37 @@ void CL_DecayLights()
     }
 }
 
+// Spike - made this a general function
+void CL_UpdateLightstyle(unsigned int idx, const char* str)
+{
+    int total;
+    int j;
+    if(idx < MAX_LIGHTSTYLES)
+    {
+        q_strlcpy(cl_lightstyle[idx].map, str, MAX_STYLESTRING);
+        cl_lightstyle[idx].length = Q_strlen(cl_lightstyle[idx].map);
+        // johnfitz -- save extra info
+        if(cl_lightstyle[idx].length)
+        {
+            total = 0;
+            cl_lightstyle[idx].peak = 'a';
+            for(j = 0; j < cl_lightstyle[idx].length; j++)
+            {
+                total += cl_lightstyle[idx].map[j] - 'a';
+                cl_lightstyle[idx].peak =
+                    q_max(cl_lightstyle[idx].peak, cl_lightstyle[idx].map[j]);
+            }
+            cl_lightstyle[idx].average =
+                total / cl_lightstyle[idx].length + 'a';
+        }
+        else
+        {
+            cl_lightstyle[idx].average = cl_lightstyle[idx].peak = 'm';
+        }
+        // johnfitz
+    }
+}
+
 
 /*
 ===============
@@ -683,6 +715,9 @@ CL_RelinkEntities
 */
 void CL_RelinkEntities()
 {
+    const quake::bench::Timer benchTimer =
+        quake::clbench::startTimer(quake::clbench::Phase::Relink);
+
     // determine partial update time
     const float frac = CL_LerpPoint();
 
@@ -984,6 +1019,7 @@ void CL_RelinkEntities()
             cl_numvisedicts++;
         }
     }
+    quake::clbench::stopTimer(benchTimer);
 }
 
 #ifdef PSET_SCRIPT
@@ -1604,6 +1640,7 @@ void CL_Init()
     Cvar_RegisterVariable(&cl_minpitch); // johnfitz -- variable pitch clamping
     Cvar_RegisterVariable(&cl_recordingdemo); // spike -- for mod hacks. combine
                                               // with cvar_string or something
+    Cvar_RegisterVariable(&cl_demoindex);
 
     Cmd_AddCommand("entities", CL_PrintEntities_f);
     Cmd_AddCommand("disconnect", CL_Disconnect_f);
@@ -1611,6 +1648,8 @@ void CL_Init()
     Cmd_AddCommand("stop", CL_Stop_f);
     Cmd_AddCommand("playdemo", CL_PlayDemo_f);
     Cmd_AddCommand("timedemo", CL_TimeDemo_f);
+    Cmd_AddCommand("demoseek", CL_DemoSeek_f);
+    Cmd_AddCommand("demoskip", CL_DemoSkip_f);
 
     Cmd_AddCommand("tracepos", [] { CL_Tracepos_f(r_refdef); }); // johnfitz
     Cmd_AddCommand("viewpos", [] { CL_Viewpos_f(r_refdef); });   // johnfitz
@@ -1656,4 +1695,6 @@ void CL_Init()
     Cmd_AddCommand_ServerCommand(
         "cl_downloadfinished", CL_Download_Finished_f); // spike
     Cmd_AddCommand("stopdownload", CL_StopDownload_f);  // spike
+
+    CL_Bench_Init();
 }
@@ -0,0 +1,117 @@
+/*
+Copyright (C) 1996-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+// cl_null.cpp -- client for the dedicated server. `cls.state` is always
+// `ca_dedicated`, so the host never runs the client; these only exist so the
+// shared code links.
+
+#include "quakedef.hpp"
+#include "client.hpp"
+#include "glquake.hpp"
+#include "cl_bench.hpp"
+
+client_static_t cls;
+client_state_t cl;
+
+cvar_t cl_name = {"_cl_name", "player", CVAR_ARCHIVE};
+cvar_t cl_color = {"_cl_color", "0", CVAR_ARCHIVE};
+
+kbutton_t in_mlook, in_klook;
+
+/*
+==============================================================================
+
+CLIENT
+
+==============================================================================
+*/
+
+void CL_Init()
+{
+}
+
+void CL_EstablishConnection(const char* host)
+{
+    (void)host;
+}
+
+void CL_Disconnect()
+{
+}
+
+void CL_Disconnect_f()
+{
+}
+
+void CL_NextDemo()
+{
+}
+
+void CL_StopPlayback()
+{
+}
+
+void CL_ShutdownDemo()
+{
+}
+
+bool CL_CheckDownloads()
+{
+    return true;
+}
+
+void CL_AccumulateCmd()
+{
+}
+
+void CL_SendCmd()
+{
+}
+
+int CL_ReadFromServer()
+{
+    return 0;
+}
+
+void CL_DecayLights()
+{
+}
+
+void CL_RunParticles()
+{
+}
+
+void CL_UpdateLightstyle(unsigned int idx, const char* stylestring)
+{
+    (void)idx;
+    (void)stylestring;
+}
+
+void Chase_Init()
+{
+}
+
+void CL_Bench_EndFrame()
+{
+}
+
+void CL_Bench_QueueFromCommandLine()
+{
+}
@@ -45,6 +45,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "cmd.hpp"
 #include "client.hpp"
 #include "snd_voip.hpp"
+#include "cl_bench.hpp"
 
 #include <limits>
 
@@ -1392,6 +1393,11 @@ static void CL_ParseStartSoundPacket()
         pos[i] = MSG_ReadCoord(cl.protocolflags);
     }
 
+    if(cls.demoseeking)
+    {
+        return;
+    }
+
     S_StartSound(ent, channel, cl.sound_precache[sound_num], pos,
         volume / 255.0, attenuation);
 }
@@ -1476,6 +1482,9 @@ CL_ParseServerInfo
 */
 void CL_ParseServerInfo()
 {
+    const quake::bench::Timer benchTimer =
+        quake::clbench::startTimer(quake::clbench::Phase::Load);
+
     const char* str;
     int i;
     int nummodels;
@@ -1486,6 +1495,8 @@ void CL_ParseServerInfo()
 
     Con_DPrintf("Serverinfo packet received.\n");
 
+    CL_DemoNewLevel();
+
     // ericw -- bring up loading plaque for map changes within a demo.
     //          it will be hidden in CL_SignonReply.
     if(cls.demoplayback)
@@ -1668,6 +1679,7 @@ void CL_ParseServerInfo()
     }*/
 
     S_Voip_MapChange();
+    quake::clbench::stopTimer(benchTimer);
 }
 
 /*
@@ -2327,7 +2339,7 @@ static void CL_ParseClientdata()
 CL_NewTranslation
 =====================
 */
-static void CL_NewTranslation(int slot)
+void CL_NewTranslation(int slot)
 {
     int i;
     int j;
@@ -2777,6 +2789,9 @@ CL_ParseServerMessage
 */
 void CL_ParseServerMessage()
 {
+    const quake::bench::Timer benchTimer =
+        quake::clbench::startTimer(quake::clbench::Phase::Parse);
+
     int cmd;
     int i;
     const char* str; // johnfitz
@@ -2847,6 +2862,7 @@ void CL_ParseServerMessage()
                            // gets flushed to the cbuf. the cursize check is to
                            // reduce backbuffer overflows that would give a
                            // false positive.
+            quake::clbench::stopTimer(benchTimer);
             return;        // end of message
         }
 
@@ -31,6 +31,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "q_sound.hpp"
 #include "client.hpp"
 #include "sys.hpp"
+#include "cl_bench.hpp"
 
 struct qmodel_t;
 
@@ -142,6 +143,9 @@ CL_ParseTEnt
 */
 void CL_ParseTEnt()
 {
+    const quake::bench::Timer benchTimer =
+        quake::clbench::startTimer(quake::clbench::Phase::ParseTEnts);
+
     const int type = MSG_ReadByte();
     switch(type)
     {
@@ -340,6 +344,7 @@ void CL_ParseTEnt()
 
         default: Sys_Error("CL_ParseTEnt: bad type");
     }
+    quake::clbench::stopTimer(benchTimer);
 }
 
 void CL_ParseEffect(bool big)
@@ -417,6 +422,9 @@ CL_UpdateTEnts
 */
 void CL_UpdateTEnts()
 {
+    const quake::bench::Timer benchTimer =
+        quake::clbench::startTimer(quake::clbench::Phase::UpdateTEnts);
+
     num_temp_entities = 0;
 
     srand((int)(cl.time * 1000)); // johnfitz -- freeze beams when paused
@@ -477,6 +485,7 @@ void CL_UpdateTEnts()
             entity_t* ent = CL_NewTempEntity();
             if(!ent)
             {
+                quake::clbench::stopTimer(benchTimer);
                 return;
             }
 
@@ -496,4 +505,5 @@ void CL_UpdateTEnts()
             d -= incr;
         }
     }
+    quake::clbench::stopTimer(benchTimer);
 }
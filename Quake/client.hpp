@@ -127,6 +127,11 @@ typedef struct
     bool demopaused;
 
     bool timedemo;
+
+    // parsing demo messages to catch up with a demoseek; their sounds are
+    // not played
+    bool demoseeking;
+
     int forcetrack; // -1 = use normal cd track
     FILE* demofile;
     int td_lastframe;   // to meter out one message a frame
@@ -449,6 +454,7 @@ extern cvar_t cl_alwaysrun; // QuakeSpasm
 extern cvar_t cl_autofire;
 
 extern cvar_t cl_recordingdemo; // QSS
+extern cvar_t cl_demoindex;
 extern cvar_t cl_shownet;
 extern cvar_t cl_nolerp;
 
@@ -535,18 +541,24 @@ void CL_ClearTrailStates(); // QSS
 //
 void CL_StopPlayback();
 int CL_GetMessage();
+void CL_WriteDemoPacket(const byte* data, int size);
+void CL_ShutdownDemo();
+void CL_DemoNewLevel();
 
 void CL_Stop_f();
 void CL_Record_f();
 void CL_PlayDemo_f();
 void CL_TimeDemo_f();
+void CL_DemoSeek_f();
+void CL_DemoSkip_f();
 
 //
 // cl_parse.c
 //
 void CL_ParseServerMessage();
 void CL_RegisterParticles(); // QSS
-static void CL_NewTranslation(int slot);
+void CL_NewTranslation(int slot);
+entity_t* CL_EntityNum(int num);
 
 //
 // view
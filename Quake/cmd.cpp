@@ -34,6 +34,11 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "sys.hpp"
 #include "developer.hpp"
 #include "qcvm.hpp"
+#include "nametable.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
 
 // QSS
 cvar_t cl_nopext = {"cl_nopext", "0",
@@ -60,8 +65,57 @@ typedef struct cmdalias_s
 
 cmdalias_t* cmd_alias;
 
+// aliases sharing a name regardless of case, in cmd_alias order. Keyed by the
+// name of the first one.
+static quake::NoCaseNameMap<std::vector<cmdalias_t*>> cmd_aliasindex;
+
 bool cmd_wait;
 
+/*
+============
+Cmd_FindAlias
+
+Exact (case sensitive) match, as used by alias and unalias.
+============
+*/
+static cmdalias_t* Cmd_FindAlias(const char* name)
+{
+    const auto it = cmd_aliasindex.find(name);
+    if(it == cmd_aliasindex.end())
+    {
+        return nullptr;
+    }
+
+    for(cmdalias_t* a : it->second)
+    {
+        if(!strcmp(name, a->name))
+        {
+            return a;
+        }
+    }
+
+    return nullptr;
+}
+
+static void Cmd_UnindexAlias(cmdalias_t* a)
+{
+    const auto it = cmd_aliasindex.find(a->name);
+    std::vector<cmdalias_t*>& group = it->second;
+    group.erase(std::find(group.begin(), group.end(), a));
+
+    if(group.empty())
+    {
+        cmd_aliasindex.erase(it);
+    }
+    else if(it->first == a->name)
+    {
+        // the key points into the alias being freed
+        auto node = cmd_aliasindex.extract(it);
+        node.key() = node.mapped().front()->name;
+        cmd_aliasindex.insert(std::move(node));
+    }
+}
+
 //=============================================================================
 
 /*
@@ -393,12 +447,9 @@ void Cmd_Alias_f()
             }
             break;
         case 2: // output current alias string
-            for(a = cmd_alias; a; a = a->next)
+            if((a = Cmd_FindAlias(Cmd_Argv(1))))
             {
-                if(!strcmp(Cmd_Argv(1), a->name))
-                {
-                    Con_Printf("   %s: %s", a->name, a->value);
-                }
+                Con_Printf("   %s: %s", a->name, a->value);
             }
             break;
         default: // set alias string
@@ -410,22 +461,21 @@ void Cmd_Alias_f()
             }
 
             // if the alias allready exists, reuse it
-            for(a = cmd_alias; a; a = a->next)
+            if((a = Cmd_FindAlias(s)))
             {
-                if(!strcmp(s, a->name))
-                {
-                    Z_Free(a->value);
-                    break;
-                }
+                Z_Free(a->value);
             }
-
-            if(!a)
+            else
             {
                 a = (cmdalias_t*)Z_Malloc(sizeof(cmdalias_t));
                 a->next = cmd_alias;
                 cmd_alias = a;
+                strcpy(a->name, s);
+
+                // newest first, like the list
+                std::vector<cmdalias_t*>& group = cmd_aliasindex[a->name];
+                group.insert(group.begin(), a);
             }
-            strcpy(a->name, s);
 
             // copy the rest of the command line
             cmd[0] = 0; // start out with a null string
@@ -465,11 +515,19 @@ void Cmd_Unalias_f()
         default:
         case 1: Con_Printf("unalias <name> : delete alias\n"); break;
         case 2:
+            if(!Cmd_FindAlias(Cmd_Argv(1)))
+            {
+                Con_Printf("No alias named %s\n", Cmd_Argv(1));
+                break;
+            }
+
             prev = nullptr;
             for(a = cmd_alias; a; a = a->next)
             {
                 if(!strcmp(Cmd_Argv(1), a->name))
                 {
+                    Cmd_UnindexAlias(a);
+
                     if(prev)
                     {
                         prev->next = a->next;
@@ -485,7 +543,6 @@ void Cmd_Unalias_f()
                 }
                 prev = a;
             }
-            Con_Printf("No alias named %s\n", Cmd_Argv(1));
             break;
     }
 }
@@ -493,15 +550,7 @@ void Cmd_Unalias_f()
 // QSS
 bool Cmd_AliasExists(const char* aliasname)
 {
-    for(cmdalias_t* a = cmd_alias; a; a = a->next)
-    {
-        if(!q_strcasecmp(aliasname, a->name))
-        {
-            return true;
-        }
-    }
-
-    return false;
+    return cmd_aliasindex.count(aliasname) != 0;
 }
 
 /*
@@ -513,6 +562,8 @@ void Cmd_Unaliasall_f()
 {
     cmdalias_t* blah;
 
+    cmd_aliasindex.clear();
+
     while(cmd_alias)
     {
         blah = cmd_alias->next;
@@ -540,6 +591,24 @@ static const char* cmd_args = nullptr;
 cmd_source_t cmd_source;
 cmd_function_t* cmd_functions; // possible commands to execute
 
+// cmd_functions in list order, for binary searches by name
+static std::vector<cmd_function_t*> cmd_sorted;
+
+// commands sharing a name regardless of case (usually the same command
+// registered for several sources), in cmd_functions order
+static quake::NoCaseNameMap<std::vector<cmd_function_t*>> cmd_index;
+
+[[nodiscard]] static std::size_t Cmd_LowerBound(
+    const std::size_t first, const char* name)
+{
+    const auto it = std::lower_bound(cmd_sorted.begin() + first,
+        cmd_sorted.end(), name, [](const cmd_function_t* cmd, const char* n) {
+            return strcmp(cmd->name, n) < 0;
+        });
+
+    return it - cmd_sorted.begin();
+}
+
 /*
 ============
 Cmd_List_f -- johnfitz
@@ -793,8 +862,6 @@ void Cmd_AddCommand2(
     const char* cmd_name, xcommand_t function, cmd_source_t srctype /* QSS */)
 {
     cmd_function_t* cmd;
-    cmd_function_t* cursor;
-    cmd_function_t* prev; // johnfitz -- sorted list insert
 
     if(host_initialized && function /* QSS */)
     {
@@ -810,12 +877,13 @@ void Cmd_AddCommand2(
     }
 
     // fail if the command already exists
-    for(cmd = cmd_functions; cmd; cmd = cmd->next)
+    std::vector<cmd_function_t*>& group = cmd_index[cmd_name];
+    for(cmd_function_t* other : group)
     {
         // QSS
-        if(!Q_strcmp(cmd_name, cmd->name) && cmd->srctype == srctype)
+        if(!Q_strcmp(cmd_name, other->name) && other->srctype == srctype)
         {
-            if(cmd->function != function && function)
+            if(other->function != function && function)
             {
                 Con_Printf("Cmd_AddCommand: %s already defined\n", cmd_name);
             }
@@ -839,25 +907,38 @@ void Cmd_AddCommand2(
     cmd->srctype = srctype;
 
     // johnfitz -- insert each entry in alphabetical order
-    if(cmd_functions == nullptr ||
-        strcmp(cmd->name, cmd_functions->name) < 0) // insert at front
+    // a name equal to the first entry's still goes after it
+    std::size_t pos = 0;
+    if(cmd_functions != nullptr &&
+        strcmp(cmd->name, cmd_functions->name) >= 0)
+    {
+        pos = Cmd_LowerBound(1, cmd->name);
+    }
+
+    if(pos == 0) // insert at front
     {
         cmd->next = cmd_functions;
         cmd_functions = cmd;
     }
     else // insert later
     {
-        prev = cmd_functions;
-        cursor = cmd_functions->next;
-        while((cursor != nullptr) && (strcmp(cmd->name, cursor->name) > 0))
-        {
-            prev = cursor;
-            cursor = cursor->next;
-        }
+        cmd_function_t* prev = cmd_sorted[pos - 1];
         cmd->next = prev->next;
         prev->next = cmd;
     }
     // johnfitz
+
+    // keep the group in list order too
+    auto at = group.begin();
+    while(at != group.end() &&
+          (strcmp((*at)->name, cmd->name) < 0 ||
+              (pos > 0 && *at == cmd_sorted[0])))
+    {
+        ++at;
+    }
+
+    group.insert(at, cmd);
+    cmd_sorted.insert(cmd_sorted.begin() + pos, cmd);
 }
 
 /*
@@ -867,9 +948,13 @@ Cmd_Exists
 */
 bool Cmd_Exists(const char* cmd_name)
 {
-    cmd_function_t* cmd;
+    const auto it = cmd_index.find(cmd_name);
+    if(it == cmd_index.end())
+    {
+        return false;
+    }
 
-    for(cmd = cmd_functions; cmd; cmd = cmd->next)
+    for(cmd_function_t* cmd : it->second)
     {
         if(!Q_strcmp(cmd_name, cmd->name))
         {
@@ -889,24 +974,21 @@ Cmd_CompleteCommand
 */
 const char* Cmd_CompleteCommand(const char* partial)
 {
-    cmd_function_t* cmd;
-    int len;
-
-    len = Q_strlen(partial);
+    const int len = Q_strlen(partial);
 
     if(!len)
     {
         return nullptr;
     }
 
-    // check functions
-    for(cmd = cmd_functions; cmd; cmd = cmd->next)
+    // names sharing a prefix are contiguous, and the first of them is the
+    // first name not sorting before the prefix itself
+    const std::size_t i = Cmd_LowerBound(0, partial);
+    if(i < cmd_sorted.size() && !Q_strncmp(partial, cmd_sorted[i]->name, len))
     {
-        if(!Q_strncmp(partial, cmd->name, len))
-        {
-            return cmd->name;
-        }
+        return cmd_sorted[i]->name;
     }
+
     return nullptr;
 }
 
@@ -915,14 +997,10 @@ const char* Cmd_CompleteCommand(const char* partial)
 Cmd_ExecuteString
 
 A complete command line has been parsed, so try to execute it
-FIXME: lookupnoadd the token to speed search?
 ============
 */
 bool Cmd_ExecuteString(const char* text, cmd_source_t src)
 {
-    cmd_function_t* cmd;
-    cmdalias_t* a;
-
     cmd_source = src;
     Cmd_TokenizeString(text);
 
@@ -934,9 +1012,10 @@ bool Cmd_ExecuteString(const char* text, cmd_source_t src)
 
     // QSS
     // check functions
-    for(cmd = cmd_functions; cmd; cmd = cmd->next)
+    const auto cmdit = cmd_index.find(cmd_argv[0]);
+    if(cmdit != cmd_index.end())
     {
-        if(!q_strcasecmp(cmd_argv[0], cmd->name))
+        for(cmd_function_t* cmd : cmdit->second)
         {
             if(src == src_client && cmd->srctype != src_client)
             {
@@ -1001,13 +1080,11 @@ bool Cmd_ExecuteString(const char* text, cmd_source_t src)
     }
 
     // check alias
-    for(a = cmd_alias; a; a = a->next)
+    if(const auto it = cmd_aliasindex.find(cmd_argv[0]);
+        it != cmd_aliasindex.end())
     {
-        if(!q_strcasecmp(cmd_argv[0], a->name))
-        {
-            Cbuf_InsertText(a->value);
-            return true;
-        }
+        Cbuf_InsertText(it->second.front()->value);
+        return true;
     }
 
     // check cvars
@@ -50,6 +50,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <string_view>
 #include <string>
 #include <vector>
+#include <unordered_map>
+#include <unordered_set>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -1303,6 +1305,102 @@ int file_from_pak; // ZOID: global indicating that file came from a pak
 searchpath_t* com_searchpaths;
 searchpath_t* com_base_searchpaths;
 
+//
+// pak/pk3 directory index
+//
+// Maps a file name to every pack that contains it, in search order, so
+// `COM_FindFile` does not have to `strcmp` every entry of every pack. The
+// index is rebuilt lazily after the search path changes. Misses are
+// remembered until the search path changes or a file is written.
+//
+struct com_packentry_t
+{
+    const searchpath_t* search;
+    int fileidx;
+};
+
+static std::unordered_map<std::string, std::vector<com_packentry_t>>
+    com_packindex;
+static std::unordered_set<std::string> com_missingfiles;
+static bool com_packindex_dirty = true;
+
+static struct
+{
+    unsigned int lookups;
+    unsigned int packhits;
+    unsigned int dirhits;
+    unsigned int misses;
+    unsigned int cachedmisses;
+    unsigned int rebuilds;
+    double time;
+} com_fsstats;
+
+static void COM_SearchPathsChanged()
+{
+    com_packindex_dirty = true;
+    com_missingfiles.clear();
+}
+
+void COM_InvalidateFileCache()
+{
+    com_missingfiles.clear();
+}
+
+static void COM_RebuildPackIndex()
+{
+    com_packindex.clear();
+
+    for(const searchpath_t* search = com_searchpaths; search;
+        search = search->next)
+    {
+        if(!search->pack)
+        {
+            continue;
+        }
+
+        const pack_t* pak = search->pack;
+        for(int i = 0; i < pak->numfiles; i++)
+        {
+            auto& entries = com_packindex[pak->files[i].name];
+
+            // only the first occurrence within a pack is ever found
+            if(entries.empty() || entries.back().search != search)
+            {
+                entries.push_back({search, i});
+            }
+        }
+    }
+
+    com_packindex_dirty = false;
+    ++com_fsstats.rebuilds;
+}
+
+/*
+============
+COM_FSStats_f
+============
+*/
+static void COM_FSStats_f()
+{
+    if(Cmd_Argc() > 1 && !q_strcasecmp(Cmd_Argv(1), "reset"))
+    {
+        const unsigned int rebuilds = com_fsstats.rebuilds;
+        com_fsstats = {};
+        com_fsstats.rebuilds = rebuilds;
+        return;
+    }
+
+    Con_Printf("%u lookups in %.3f ms\n", com_fsstats.lookups,
+        com_fsstats.time * 1000.0);
+    Con_Printf("  %u pack hits, %u directory hits\n", com_fsstats.packhits,
+        com_fsstats.dirhits);
+    Con_Printf("  %u misses (%u from miss cache)\n", com_fsstats.misses,
+        com_fsstats.cachedmisses);
+    Con_Printf("%u names indexed, %u cached misses, %u index rebuilds\n",
+        (unsigned int)com_packindex.size(),
+        (unsigned int)com_missingfiles.size(), com_fsstats.rebuilds);
+}
+
 /*
 ============
 COM_Path_f
@@ -1353,6 +1451,8 @@ void COM_WriteFile(const char* filename, const void* data, int len)
     Sys_Printf("COM_WriteFile: %s\n", name);
     Sys_FileWrite(handle, data, len);
     Sys_FileClose(handle);
+
+    COM_InvalidateFileCache();
 }
 
 /*
@@ -1404,7 +1504,7 @@ If neither of file or handle is set, this
 can be used for detecting a file's presence.
 ===========
 */
-static int COM_FindFile(
+static int COM_FindFileImpl(
     const char* filename, int* handle, FILE** file, unsigned int* path_id)
 {
     if(file && handle)
@@ -1414,34 +1514,57 @@ static int COM_FindFile(
 
     file_from_pak = 0;
 
-    //
-    // search through the path, one element at a time
-    //
-    for(searchpath_t* search = com_searchpaths; search; search = search->next)
+    if(com_packindex_dirty)
+    {
+        COM_RebuildPackIndex();
+    }
+
+    const bool cachedmiss = com_missingfiles.count(filename) != 0;
+
+    if(cachedmiss)
     {
-        if(search->pack) /* look through all the pak file elements */
+        ++com_fsstats.cachedmisses;
+    }
+    else
+    {
+        const auto it = com_packindex.find(filename);
+        const std::vector<com_packentry_t>* candidates =
+            it != com_packindex.end() ? &it->second : nullptr;
+        std::size_t nextcandidate = 0;
+
+        //
+        // search through the path, one element at a time
+        //
+        for(searchpath_t* search = com_searchpaths; search;
+            search = search->next)
         {
-            pack_t* pak = search->pack;
-            for(int i = 0; i < pak->numfiles; i++)
+            if(search->pack) /* look up the pak file elements in the index */
             {
-                if(strcmp(pak->files[i].name, filename) != 0)
+                if(!candidates || nextcandidate >= candidates->size() ||
+                    (*candidates)[nextcandidate].search != search)
                 {
                     continue;
                 }
 
+                pack_t* pak = search->pack;
+                const int i = (*candidates)[nextcandidate++].fileidx;
+
                 // VR: This hack allows multiple "start.bsp" maps to coexist.
                 // The user can decide which one is loaded by setting a CVar.
-                const auto extractedPakName = VR_ExtractPakName(*pak);
-                if(std::strcmp(filename, "maps/start.bsp") == 0 &&
-                    extractedPakName != VR_GetActiveStartPakName() &&
-                    extractedPakName != "pak0")
+                if(std::strcmp(filename, "maps/start.bsp") == 0)
                 {
-                    continue;
+                    const auto extractedPakName = VR_ExtractPakName(*pak);
+                    if(extractedPakName != VR_GetActiveStartPakName() &&
+                        extractedPakName != "pak0")
+                    {
+                        continue;
+                    }
                 }
 
                 // found it!
                 com_filesize = pak->files[i].filelen;
                 file_from_pak = 1;
+                ++com_fsstats.packhits;
 
                 if(path_id)
                 {
@@ -1483,9 +1606,9 @@ static int COM_FindFile(
                     {
                         fseek(*file, pak->files[i].filepos, SEEK_SET);
                         if(pak->files[i].deflatedsize)
-                            *file =
-                                FSZIP_Deflate(*file, pak->files[i].deflatedsize,
-                                    pak->files[i].filelen);
+                            *file = FSZIP_Deflate(*file,
+                                pak->files[i].deflatedsize,
+                                pak->files[i].filelen);
                     }
 
                     return com_filesize;
@@ -1495,57 +1618,72 @@ static int COM_FindFile(
                     return com_filesize;
                 }
             }
-        }
-        else /* check a file in the directory tree */
-        {
-            char netpath[MAX_OSPATH];
-            q_snprintf(
-                netpath, sizeof(netpath), "%s/%s", search->filename, filename);
-
-            const int findtime = Sys_FileTime(netpath);
-            if(findtime == -1)
+            else /* check a file in the directory tree */
             {
-                continue;
-            }
+                char netpath[MAX_OSPATH];
+                q_snprintf(netpath, sizeof(netpath), "%s/%s",
+                    search->filename, filename);
 
-            if(path_id)
-            {
-                *path_id = search->path_id;
-            }
+                const int findtime = Sys_FileTime(netpath);
+                if(findtime == -1)
+                {
+                    continue;
+                }
 
-            if(handle)
-            {
-                int i;
-                com_filesize = Sys_FileOpenRead(netpath, &i);
-                *handle = i;
-                return com_filesize;
-            }
-            else if(file)
-            {
-                *file = fopen(netpath, "rb");
-                com_filesize = (*file == nullptr) ? -1 : COM_filelength(*file);
-                return com_filesize;
-            }
-            else
-            {
-                return 0; /* dummy valid value for COM_FileExists() */
+                ++com_fsstats.dirhits;
+
+                if(path_id)
+                {
+                    *path_id = search->path_id;
+                }
+
+                if(handle)
+                {
+                    int i;
+                    com_filesize = Sys_FileOpenRead(netpath, &i);
+                    *handle = i;
+                    return com_filesize;
+                }
+                else if(file)
+                {
+                    *file = fopen(netpath, "rb");
+                    com_filesize =
+                        (*file == nullptr) ? -1 : COM_filelength(*file);
+                    return com_filesize;
+                }
+                else
+                {
+                    return 0; /* dummy valid value for COM_FileExists() */
+                }
             }
         }
-    }
 
-    const char* ext = COM_FileGetExtension(filename);
-    if(strcmp(ext, "pcx") != 0 && strcmp(ext, "tga") != 0 &&
-        strcmp(ext, "png") != 0 && strcmp(ext, "jpg") != 0 &&
-        strcmp(ext, "jpeg") != 0 && strcmp(ext, "lit") != 0 &&
-        strcmp(ext, "ent") != 0)
-    {
-        Con_DPrintf2("FindFile: can't find %s\n", filename);
+        // a pack hit rejected by the "start.bsp" filter is not a miss
+        if(!candidates)
+        {
+            com_missingfiles.emplace(filename);
+        }
     }
-    else
+
+    ++com_fsstats.misses;
+
+    // Only report the first miss of each file, not every cached repeat.
+    if(!cachedmiss)
     {
-        Con_DPrintf3("FindFile: can't find %s\n", filename);
+        const char* ext = COM_FileGetExtension(filename);
+        if(strcmp(ext, "pcx") != 0 && strcmp(ext, "tga") != 0 &&
+            strcmp(ext, "png") != 0 && strcmp(ext, "jpg") != 0 &&
+            strcmp(ext, "jpeg") != 0 && strcmp(ext, "lit") != 0 &&
+            strcmp(ext, "ent") != 0)
+        {
+            Con_DPrintf2("FindFile: can't find %s\n", filename);
+        }
+        else
+        {
+            Con_DPrintf3("FindFile: can't find %s\n", filename);
+        }
+        // Log pcx, tga, lit, ent misses only if (developer.value >= 2)
     }
-    // Log pcx, tga, lit, ent misses only if (developer.value >= 2)
 
     if(handle)
     {
@@ -1561,6 +1699,18 @@ static int COM_FindFile(
     return com_filesize;
 }
 
+static int COM_FindFile(
+    const char* filename, int* handle, FILE** file, unsigned int* path_id)
+{
+    const double start = Sys_DoubleTime();
+    const int result = COM_FindFileImpl(filename, handle, file, path_id);
+
+    ++com_fsstats.lookups;
+    com_fsstats.time += Sys_DoubleTime() - start;
+
+    return result;
+}
+
 
 /*
 ===========
@@ -2076,6 +2226,8 @@ static bool COM_AddPackage(searchpath_t* basepath, const char* pakfile)
     search->next = com_searchpaths;
     com_searchpaths = search;
 
+    COM_SearchPathsChanged();
+
     return true;
 }
 
@@ -2240,6 +2392,8 @@ _add_path:
         Sys_mkdir(com_gamedir);
         goto _add_path;
     }
+
+    COM_SearchPathsChanged();
 }
 
 //==============================================================================
@@ -2337,6 +2491,7 @@ static void COM_Game_f()
             Z_Free(com_searchpaths);
             com_searchpaths = search;
         }
+        COM_SearchPathsChanged();
         hipnotic = false;
         rogue = false;
         standard_quake = true;
@@ -2438,6 +2593,7 @@ void COM_InitFilesystem() // johnfitz -- modified based on topaz's tutorial
     Cvar_RegisterVariable(&cmdline);
     Cmd_AddCommand("path", COM_Path_f);
     Cmd_AddCommand("game", COM_Game_f); // johnfitz
+    Cmd_AddCommand("fs_stats", COM_FSStats_f);
 
     i = COM_CheckParm("-basedir");
     if(i && i < com_argc - 1)
@@ -182,6 +182,10 @@ int COM_FOpenFile(const char* filename, FILE** file, unsigned int* path_id);
 bool COM_FileExists(const char* filename, unsigned int* path_id);
 void COM_CloseFile(int h);
 
+// forgets cached lookup misses; call after creating files that may later be
+// opened through the search path
+void COM_InvalidateFileCache();
+
 // these procedures open a file using COM_FindFile and loads it into a proper
 // buffer. the buffer is allocated with a total size of com_filesize + 1. the
 // procedures differ by their buffer allocation method.
@@ -29,13 +29,32 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "zone.hpp"
 #include "common.hpp"
 #include "progs.hpp"
+#include "nametable.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <vector>
 
 static cvar_t* cvar_vars;
 static char cvar_null_string[] = "";
 static std::vector<cvar_t*> cvar_handles;
 
+// cvar_vars in list order, for binary searches by name
+static std::vector<cvar_t*> cvar_sorted;
+
+// names are case sensitive, so a bucket can hold "foo" and "Foo"
+static quake::NoCaseNameMap<std::vector<cvar_t*>> cvar_index;
+
+[[nodiscard]] static std::size_t Cvar_LowerBound(const char* name)
+{
+    const auto it = std::lower_bound(cvar_sorted.begin(), cvar_sorted.end(),
+        name, [](const cvar_t* var, const char* n) {
+            return strcmp(var->name, n) < 0;
+        });
+
+    return it - cvar_sorted.begin();
+}
+
 //==============================================================================
 //
 //  USER COMMANDS
@@ -299,6 +318,8 @@ void Cvar_Init()
     Cmd_AddCommand("seta", Cvar_Set_f);
 
     cvar_handles.reserve(128);
+    cvar_sorted.reserve(1024);
+    cvar_index.reserve(1024);
 }
 
 //==============================================================================
@@ -314,7 +335,13 @@ Cvar_FindVar
 */
 cvar_t* Cvar_FindVar(const char* var_name)
 {
-    for(cvar_t* var = cvar_vars; var; var = var->next)
+    const auto it = cvar_index.find(var_name);
+    if(it == cvar_index.end())
+    {
+        return nullptr;
+    }
+
+    for(cvar_t* var : it->second)
     {
         if(!Q_strcmp(var_name, var->name))
         {
@@ -434,13 +461,12 @@ const char* Cvar_CompleteVariable(const char* partial)
         return nullptr;
     }
 
-    // check functions
-    for(cvar_t* cvar = cvar_vars; cvar; cvar = cvar->next)
+    // names sharing a prefix are contiguous, and the first of them is the
+    // first name not sorting before the prefix itself
+    const std::size_t i = Cvar_LowerBound(partial);
+    if(i < cvar_sorted.size() && !Q_strncmp(partial, cvar_sorted[i]->name, len))
     {
-        if(!Q_strncmp(partial, cvar->name, len))
-        {
-            return cvar->name;
-        }
+        return cvar_sorted[i]->name;
     }
 
     return nullptr;
@@ -661,27 +687,22 @@ void Cvar_RegisterVariable(cvar_t* variable)
 
     // link the variable in
     // johnfitz -- insert each entry in alphabetical order
-    if(cvar_vars == nullptr ||
-        strcmp(variable->name, cvar_vars->name) < 0) // insert at front
+    const std::size_t pos = Cvar_LowerBound(variable->name);
+    if(pos == 0) // insert at front
     {
         variable->next = cvar_vars;
         cvar_vars = variable;
     }
     else // insert later
     {
-        cvar_t* prev = cvar_vars;
-        cvar_t* cursor = cvar_vars->next;
-
-        while(cursor && (strcmp(variable->name, cursor->name) > 0))
-        {
-            prev = cursor;
-            cursor = cursor->next;
-        }
-
+        cvar_t* prev = cvar_sorted[pos - 1];
         variable->next = prev->next;
         prev->next = variable;
     }
     // johnfitz
+
+    cvar_sorted.insert(cvar_sorted.begin() + pos, variable);
+    cvar_index[variable->name].push_back(variable);
     variable->flags |= CVAR_REGISTERED;
 
     // copy the value off, because future sets will Z_Free it
@@ -40,6 +40,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "gl_texmgr.hpp"
 #include "sys.hpp"
 #include "srcformat.hpp"
+#include "jobs.hpp"
+
+#include <cstddef>
+#include <cstdint>
 
 qmodel_t* loadmodel;
 char loadname[32]; // for hunk tags
@@ -50,16 +54,20 @@ void Mod_LoadAliasModel(qmodel_t* mod, void* buffer, int pvtype);
 void Mod_LoadMD3Model(qmodel_t* mod, void* buffer);
 void Mod_LoadIQMModel(qmodel_t* mod, const void* buffer);
 qmodel_t* Mod_LoadModel(qmodel_t* mod, bool crash);
+static void Mod_BuildPHSRow(const qmodel_t* mod, const int i);
 
 cvar_t external_ents = {"external_ents", "1", CVAR_ARCHIVE};
 cvar_t gl_load24bit = {"gl_load24bit", "1", CVAR_ARCHIVE};
 cvar_t mod_ignorelmscale = {"mod_ignorelmscale", "0"};
+// megabytes the precomputed PVS+PHS of a map may use, 0 disables them
+cvar_t mod_vismatrix = {"mod_vismatrix", "32", CVAR_ARCHIVE};
 
-static byte* mod_novis;
-static int mod_novis_capacity;
+// per thread, the server builds client snapshots on the job threads
+static thread_local byte* mod_novis;
+static thread_local int mod_novis_capacity;
 
-static byte* mod_decompressed;
-static int mod_decompressed_capacity;
+static thread_local byte* mod_decompressed;
+static thread_local int mod_decompressed_capacity;
 
 #define MAX_MOD_KNOWN                                                          \
     8192 /*spike -- new value, was 2048 in qs, 512 in vanilla. Needs to be big \
@@ -82,6 +90,7 @@ void Mod_Init()
     Cvar_RegisterVariable(&external_ents);
     Cvar_RegisterVariable(&gl_load24bit);
     Cvar_RegisterVariable(&mod_ignorelmscale);
+    Cvar_RegisterVariable(&mod_vismatrix);
 
     // johnfitz -- create notexture miptex
     r_notexture_mip =
@@ -241,9 +250,33 @@ byte* Mod_LeafPVS(mleaf_t* leaf, qmodel_t* model)
     {
         return Mod_NoVisPVS(model);
     }
+
+    const int row = leaf - model->leafs - 1;
+    if(model->pvsmatrix && row < model->numleafs)
+    {
+        return model->pvsmatrix + row * model->visrowbytes;
+    }
+
     return Mod_DecompressVis(leaf->compressed_vis, model);
 }
 
+byte* Mod_LeafPHS(mleaf_t* leaf, qmodel_t* model)
+{
+    const int row = leaf - model->leafs - 1;
+    if(!model->phsmatrix || row < 0 || row >= model->numleafs)
+    {
+        return nullptr;
+    }
+
+    if(model->phsbuilt && !(model->phsbuilt[row >> 3] & (1 << (row & 7))))
+    {
+        Mod_BuildPHSRow(model, row);
+        model->phsbuilt[row >> 3] |= 1 << (row & 7);
+    }
+
+    return model->phsmatrix + row * model->visrowbytes;
+}
+
 byte* Mod_NoVisPVS(qmodel_t* model)
 {
     int pvsbytes;
@@ -867,6 +900,8 @@ void Mod_LoadTextures(lump_t* l)
     loadmodel->textures = (texture_t**)Hunk_AllocName(
         loadmodel->numtextures * sizeof(*loadmodel->textures), loadname);
 
+    TexMgr_BeginBatch();
+
     // spike -- rewrote this loop to run backwards (to make it easier to track
     // the end of the miptex) and added handling for extra texture block
     // compression.
@@ -1081,6 +1116,8 @@ void Mod_LoadTextures(lump_t* l)
         // johnfitz
     }
 
+    TexMgr_EndBatch();
+
     // johnfitz -- last 2 slots in array should be filled with dummy textures
     loadmodel->textures[loadmodel->numtextures - 2] =
         r_notexture_mip; // for lightmapped surfs
@@ -1382,6 +1419,128 @@ void Mod_LoadVisibility(lump_t* l)
 }
 
 
+/*
+=================
+Mod_BuildPHSRow
+
+ORs together the PVS rows of every leaf visible from leaf `i`.
+=================
+*/
+static void Mod_BuildPHSRow(const qmodel_t* mod, const int i)
+{
+    const int numleafs = mod->numleafs;
+    const int rowwords = mod->visrowbytes / 8;
+    const byte* pvs = mod->pvsmatrix;
+
+    const auto* src = (const std::uint64_t*)(pvs + i * mod->visrowbytes);
+    auto* dst = (std::uint64_t*)(mod->phsmatrix + i * mod->visrowbytes);
+
+    for(int w = 0; w < rowwords; w++)
+    {
+        for(std::uint64_t bits = src[w]; bits; bits &= bits - 1)
+        {
+            int j = w * 64;
+            for(std::uint64_t b = bits; !(b & 1); b >>= 1)
+            {
+                j++;
+            }
+
+            if(j >= numleafs)
+            {
+                break;
+            }
+
+            const auto* row =
+                (const std::uint64_t*)(pvs + j * mod->visrowbytes);
+            for(int k = 0; k < rowwords; k++)
+            {
+                dst[k] |= row[k];
+            }
+        }
+    }
+}
+
+/*
+=================
+Mod_BuildVisMatrix
+
+Decompresses the PVS of every leaf into one bit matrix at load time, and
+derives the PHS from it (everything visible from a leaf in the PVS), so that
+Mod_LeafPVS and Mod_LeafPHS become a row lookup. Skipped when both matrices
+would not fit in mod_vismatrix megabytes. On maps where deriving the whole
+PHS would stall the load, its rows are built on first use instead.
+=================
+*/
+static void Mod_BuildVisMatrix(qmodel_t* mod)
+{
+    mod->pvsmatrix = nullptr;
+    mod->phsmatrix = nullptr;
+    mod->phsbuilt = nullptr;
+    mod->visrowbytes = 0;
+
+    if(!mod->visdata || mod->numleafs <= 0 || mod_vismatrix.value <= 0)
+    {
+        return;
+    }
+
+    // whole 64-bit words, so the PHS can be merged a word at a time
+    const int numleafs = mod->numleafs;
+    const int rowwords = (numleafs + 63) >> 6;
+    const int rowbytes = rowwords * 8;
+    const double matrixbytes = (double)rowbytes * numleafs;
+
+    if(2 * matrixbytes > mod_vismatrix.value * 1024 * 1024)
+    {
+        Con_DPrintf("%s: %d leafs need %.1f MB for PVS+PHS, over "
+                    "mod_vismatrix\n",
+            mod->name, numleafs, 2 * matrixbytes / (1024 * 1024));
+        return;
+    }
+
+    byte* pvs = Hunk_AllocName<byte>(rowbytes * numleafs, loadname);
+    byte* phs = Hunk_AllocName<byte>(rowbytes * numleafs, loadname);
+
+    // the PHS costs one row merge per visible leaf of every leaf
+    const int pvsbytes = (numleafs + 7) >> 3;
+    double visible = 0;
+    for(int i = 0; i < numleafs; i++)
+    {
+        byte* row = pvs + i * rowbytes;
+        memcpy(row, Mod_DecompressVis(mod->leafs[i + 1].compressed_vis, mod),
+            pvsbytes);
+
+        for(int j = 0; j < pvsbytes; j++)
+        {
+            for(int b = row[j]; b; b &= b - 1)
+            {
+                visible++;
+            }
+        }
+    }
+
+    mod->pvsmatrix = pvs;
+    mod->phsmatrix = phs;
+    mod->visrowbytes = rowbytes;
+
+    // a few dozen milliseconds of merging spread over the job threads
+    constexpr double maxLoadWords = 64.0 * 1024 * 1024;
+    if(visible * rowwords > maxLoadWords)
+    {
+        Con_DPrintf("%s: building the PHS of %d leafs on demand\n", mod->name,
+            numleafs);
+        mod->phsbuilt = Hunk_AllocName<byte>((numleafs + 7) >> 3, loadname);
+        return;
+    }
+
+    quake::jobs::parallelFor(
+        numleafs, 64, [&](const std::size_t begin, const std::size_t end) {
+            for(std::size_t i = begin; i < end; i++)
+            {
+                Mod_BuildPHSRow(mod, static_cast<int>(i));
+            }
+        });
+}
+
 /*
 =================
 Mod_LoadEntities
@@ -3329,6 +3488,12 @@ void Mod_LoadBrushModel(qmodel_t* mod, void* buffer)
 
         mod->numleafs = bm->visleafs;
 
+        if(i == 0)
+        {
+            // submodels copy the matrices along with the leafs
+            Mod_BuildVisMatrix(mod);
+        }
+
         if(i < mod->numsubmodels - 1)
         { // duplicate the basic information
             char name[10];
@@ -3582,6 +3747,8 @@ void* Mod_LoadAllSkins(int numskins, daliasskintype_t* pskintype)
 
     size = pheader->skinwidth * pheader->skinheight;
 
+    TexMgr_BeginBatch();
+
     if(loadmodel->flags & MF_HOLEY)
     {
         texflags |= TEXPREF_ALPHA;
@@ -3746,6 +3913,8 @@ void* Mod_LoadAllSkins(int numskins, daliasskintype_t* pskintype)
         }
     }
 
+    TexMgr_EndBatch();
+
     return (void*)pskintype;
 }
 
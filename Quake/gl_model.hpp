@@ -587,6 +587,12 @@ struct qmodel_t
 
     bool viswarn; // for Mod_DecompressVis()
 
+    // decompressed PVS and PHS of every leaf, see Mod_BuildVisMatrix
+    byte* pvsmatrix;
+    byte* phsmatrix;
+    byte* phsbuilt; // rows of phsmatrix built so far, nullptr if all are
+    int visrowbytes;
+
     int bspversion;
     int contentstransparent; // spike -- added this so we can disable glitchy
                              // wateralpha where its not supported.
@@ -623,6 +629,8 @@ void Mod_TouchModel(const char* name);
 
 mleaf_t* Mod_PointInLeaf(const qvec3& p, qmodel_t* model);
 byte* Mod_LeafPVS(mleaf_t* leaf, qmodel_t* model);
+// nullptr if not built. Main thread only, rows may be built on first use.
+byte* Mod_LeafPHS(mleaf_t* leaf, qmodel_t* model);
 byte* Mod_NoVisPVS(qmodel_t* model);
 
 void Mod_SetExtraFlags(qmodel_t* mod);
@@ -92,6 +92,7 @@ cvar_t r_lightmap = {"r_lightmap", "0", CVAR_NONE};
 cvar_t r_shadows = {"r_shadows", "1", CVAR_ARCHIVE};
 cvar_t r_wateralpha = {"r_wateralpha", "1", CVAR_ARCHIVE};
 cvar_t r_dynamic = {"r_dynamic", "1", CVAR_ARCHIVE};
+cvar_t r_lightmap_simd = {"r_lightmap_simd", "2", CVAR_ARCHIVE};
 cvar_t r_novis = {"r_novis", "0", CVAR_ARCHIVE};
 
 cvar_t gl_finish = {"gl_finish", "0", CVAR_NONE};
@@ -241,6 +241,7 @@ void R_Init()
     Cvar_RegisterVariable(&r_wateralpha);
     Cvar_SetCallback(&r_wateralpha, R_SetWateralpha_f);
     Cvar_RegisterVariable(&r_dynamic);
+    Cvar_RegisterVariable(&r_lightmap_simd);
     Cvar_RegisterVariable(&r_novis);
     Cvar_SetCallback(&r_novis, R_VisChanged);
     Cvar_RegisterVariable(&r_speeds);
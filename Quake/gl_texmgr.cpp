@@ -35,6 +35,12 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "sys.hpp"
 #include "render.hpp"
 #include "srcformat.hpp"
+#include "jobs.hpp"
+#include "image_kernels.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
 
 const int gl_solid_format = 3;
 const int gl_alpha_format = 4;
@@ -44,6 +50,8 @@ static cvar_t gl_texture_anisotropy = {
     "gl_texture_anisotropy", "1", CVAR_ARCHIVE};
 static cvar_t gl_max_size = {"gl_max_size", "0", CVAR_NONE};
 static cvar_t gl_picmip = {"gl_picmip", "0", CVAR_NONE};
+static cvar_t gl_texbatch = {"gl_texbatch", "1", CVAR_NONE};
+static cvar_t gl_texture_simd = {"gl_texture_simd", "2", CVAR_ARCHIVE};
 static GLint gl_hardware_maxsize;
 
 #define MAX_GLTEXTURES 2048
@@ -490,6 +498,7 @@ TexMgr_NewTexture
 }
 
 static void GL_DeleteTexture(gltexture_t* texture);
+static void TexMgr_DropPending(gltexture_t* glt);
 
 // ericw -- workaround for preventing TexMgr_FreeTexture during
 // TexMgr_ReloadImages
@@ -515,6 +524,8 @@ void TexMgr_FreeTexture(gltexture_t* kill)
         return;
     }
 
+    TexMgr_DropPending(kill);
+
     if(active_gltextures == kill)
     {
         active_gltextures = kill->next;
@@ -788,6 +799,8 @@ void TexMgr_Init()
 
     Cvar_RegisterVariable(&gl_max_size);
     Cvar_RegisterVariable(&gl_picmip);
+    Cvar_RegisterVariable(&gl_texbatch);
+    Cvar_RegisterVariable(&gl_texture_simd);
     Cvar_RegisterVariable(&gl_texture_anisotropy);
     Cvar_SetCallback(&gl_texture_anisotropy, &TexMgr_Anisotropy_f);
     gl_texturemode.string = glmodes[glmode_idx].name;
@@ -824,6 +837,29 @@ void TexMgr_Init()
 ================================================================================
 */
 
+// One mip level ready for glTexImage2D.
+struct texlevel_t
+{
+    int width;
+    int height;
+    unsigned* data;
+};
+
+// The CPU side of loading an 8 or 32 bit image: the converted mip chain and
+// the buffers holding it. The hunk is not thread safe, so the conversion
+// helpers allocate from here instead, and this can be filled on a job thread.
+struct texupload_t
+{
+    std::vector<std::unique_ptr<byte[]>> buffers;
+    std::vector<texlevel_t> levels;
+};
+
+[[nodiscard]] static byte* TexMgr_UploadAlloc(texupload_t& up, size_t size)
+{
+    up.buffers.emplace_back(new byte[size]);
+    return up.buffers.back().get();
+}
+
 /*
 ================
 TexMgr_Pad -- return smallest power of two greater than or equal to s
@@ -881,22 +917,8 @@ TexMgr_MipMapW
 */
 static unsigned* TexMgr_MipMapW(unsigned* data, int width, int height)
 {
-    int i;
-    int size;
-    byte* out;
-    byte* in;
-
-    out = in = (byte*)data;
-    size = (width * height) >> 1;
-
-    for(i = 0; i < size; i++, out += 4, in += 8)
-    {
-        out[0] = (in[0] + in[4]) >> 1;
-        out[1] = (in[1] + in[5]) >> 1;
-        out[2] = (in[2] + in[6]) >> 1;
-        out[3] = (in[3] + in[7]) >> 1;
-    }
-
+    quake::image::mipMapW(
+        quake::simd::clampLevel(gl_texture_simd.value), data, width, height);
     return data;
 }
 
@@ -907,26 +929,8 @@ TexMgr_MipMapH
 */
 static unsigned* TexMgr_MipMapH(unsigned* data, int width, int height)
 {
-    int i;
-    int j;
-    byte* out;
-    byte* in;
-
-    out = in = (byte*)data;
-    height >>= 1;
-    width <<= 2;
-
-    for(i = 0; i < height; i++, in += width)
-    {
-        for(j = 0; j < width; j += 4, out += 4, in += 4)
-        {
-            out[0] = (in[0] + in[width + 0]) >> 1;
-            out[1] = (in[1] + in[width + 1]) >> 1;
-            out[2] = (in[2] + in[width + 2]) >> 1;
-            out[3] = (in[3] + in[width + 3]) >> 1;
-        }
-    }
-
+    quake::image::mipMapH(
+        quake::simd::clampLevel(gl_texture_simd.value), data, width, height);
     return data;
 }
 
@@ -936,86 +940,19 @@ TexMgr_ResampleTexture -- bilinear resample
 ================
 */
 static unsigned* TexMgr_ResampleTexture(
-    unsigned* in, int inwidth, int inheight, bool alpha)
+    texupload_t& up, unsigned* in, int inwidth, int inheight, bool alpha)
 {
-    byte* nwpx;
-    byte* nepx;
-    byte* swpx;
-    byte* sepx;
-    byte* dest;
-    unsigned xfrac;
-    unsigned yfrac;
-    unsigned x;
-    unsigned y;
-    unsigned modx;
-    unsigned mody;
-    unsigned imodx;
-    unsigned imody;
-    unsigned injump;
-    unsigned outjump;
-    unsigned* out;
-    int i;
-    int j;
-    int outwidth;
-    int outheight;
-
     if(inwidth == TexMgr_Pad(inwidth) && inheight == TexMgr_Pad(inheight))
     {
         return in;
     }
 
-    outwidth = TexMgr_Pad(inwidth);
-    outheight = TexMgr_Pad(inheight);
-    out = (unsigned*)Hunk_Alloc(outwidth * outheight * 4);
-
-    xfrac = ((inwidth - 1) << 16) / (outwidth - 1);
-    yfrac = ((inheight - 1) << 16) / (outheight - 1);
-    y = outjump = 0;
+    const int outwidth = TexMgr_Pad(inwidth);
+    const int outheight = TexMgr_Pad(inheight);
+    auto* out = (unsigned*)TexMgr_UploadAlloc(up, outwidth * outheight * 4);
 
-    for(i = 0; i < outheight; i++)
-    {
-        mody = (y >> 8) & 0xFF;
-        imody = 256 - mody;
-        injump = (y >> 16) * inwidth;
-        x = 0;
-
-        for(j = 0; j < outwidth; j++)
-        {
-            modx = (x >> 8) & 0xFF;
-            imodx = 256 - modx;
-
-            nwpx = (byte*)(in + (x >> 16) + injump);
-            nepx = nwpx + 4;
-            swpx = nwpx + inwidth * 4;
-            sepx = swpx + 4;
-
-            dest = (byte*)(out + outjump + j);
-
-            dest[0] = (nwpx[0] * imodx * imody + nepx[0] * modx * imody +
-                          swpx[0] * imodx * mody + sepx[0] * modx * mody) >>
-                      16;
-            dest[1] = (nwpx[1] * imodx * imody + nepx[1] * modx * imody +
-                          swpx[1] * imodx * mody + sepx[1] * modx * mody) >>
-                      16;
-            dest[2] = (nwpx[2] * imodx * imody + nepx[2] * modx * imody +
-                          swpx[2] * imodx * mody + sepx[2] * modx * mody) >>
-                      16;
-            if(alpha)
-            {
-                dest[3] = (nwpx[3] * imodx * imody + nepx[3] * modx * imody +
-                              swpx[3] * imodx * mody + sepx[3] * modx * mody) >>
-                          16;
-            }
-            else
-            {
-                dest[3] = 255;
-            }
-
-            x += xfrac;
-        }
-        outjump += outwidth;
-        y += yfrac;
-    }
+    quake::image::resample(quake::simd::clampLevel(gl_texture_simd.value), in,
+        inwidth, inheight, out, outwidth, outheight, alpha);
 
     return out;
 }
@@ -1233,18 +1170,13 @@ static void TexMgr_PadEdgeFixH(byte* data, int width, int height)
 TexMgr_8to32
 ================
 */
-static unsigned* TexMgr_8to32(byte* in, int pixels, unsigned int* usepal)
+static unsigned* TexMgr_8to32(
+    texupload_t& up, byte* in, int pixels, unsigned int* usepal)
 {
-    int i;
-    unsigned* out;
-    unsigned* data;
-
-    out = data = (unsigned*)Hunk_Alloc(pixels * 4);
+    auto* data = (unsigned*)TexMgr_UploadAlloc(up, pixels * 4);
 
-    for(i = 0; i < pixels; i++)
-    {
-        *out++ = usepal[*in++];
-    }
+    quake::image::palette8to32(quake::simd::clampLevel(gl_texture_simd.value),
+        in, pixels, usepal, data);
 
     return data;
 }
@@ -1254,7 +1186,8 @@ static unsigned* TexMgr_8to32(byte* in, int pixels, unsigned int* usepal)
 TexMgr_PadImageW -- return image with width padded up to power-of-two dimentions
 ================
 */
-static byte* TexMgr_PadImageW(byte* in, int width, int height, byte padbyte)
+static byte* TexMgr_PadImageW(
+    texupload_t& up, byte* in, int width, int height, byte padbyte)
 {
     int i;
     int j;
@@ -1269,7 +1202,7 @@ static byte* TexMgr_PadImageW(byte* in, int width, int height, byte padbyte)
 
     outwidth = TexMgr_Pad(width);
 
-    out = data = (byte*)Hunk_Alloc(outwidth * height);
+    out = data = TexMgr_UploadAlloc(up, outwidth * height);
 
     for(i = 0; i < height; i++)
     {
@@ -1292,7 +1225,8 @@ TexMgr_PadImageH -- return image with height padded up to power-of-two
 dimentions
 ================
 */
-static byte* TexMgr_PadImageH(byte* in, int width, int height, byte padbyte)
+static byte* TexMgr_PadImageH(
+    texupload_t& up, byte* in, int width, int height, byte padbyte)
 {
     int i;
     int srcpix;
@@ -1308,7 +1242,7 @@ static byte* TexMgr_PadImageH(byte* in, int width, int height, byte padbyte)
     srcpix = width * height;
     dstpix = width * TexMgr_Pad(height);
 
-    out = data = (byte*)Hunk_Alloc(dstpix);
+    out = data = TexMgr_UploadAlloc(up, dstpix);
 
     for(i = 0; i < srcpix; i++)
     {
@@ -1323,10 +1257,10 @@ static byte* TexMgr_PadImageH(byte* in, int width, int height, byte padbyte)
 }
 
 [[nodiscard]] static byte* TexMgr_PreMultiply32(
-    byte* in, size_t width, size_t height)
+    texupload_t& up, byte* in, size_t width, size_t height)
 {
     size_t pixels = width * height;
-    byte* out = (byte*)Hunk_Alloc(pixels * 4);
+    byte* out = TexMgr_UploadAlloc(up, pixels * 4);
     byte* result = out;
     while(pixels-- > 0)
     {
@@ -1342,13 +1276,11 @@ static byte* TexMgr_PadImageH(byte* in, int width, int height, byte padbyte)
 
 /*
 ================
-TexMgr_LoadImage32 -- handles 32bit source data
+TexMgr_Prepare32 -- builds the mip chain for 32bit source data
 ================
 */
-static void TexMgr_LoadImage32(gltexture_t* glt, unsigned* data)
+static void TexMgr_Prepare32(gltexture_t* glt, unsigned* data, texupload_t& up)
 {
-    int internalformat;
-    int miplevel;
     int mipwidth;
     int mipheight;
     int picmip;
@@ -1357,14 +1289,14 @@ static void TexMgr_LoadImage32(gltexture_t* glt, unsigned* data)
     if(glt->flags & TEXPREF_PREMULTIPLY)
     {
         data = (unsigned*)TexMgr_PreMultiply32(
-            (byte*)data, glt->width, glt->height);
+            up, (byte*)data, glt->width, glt->height);
     }
 
     if(!gl_texture_NPOT)
     {
         // resample up
         data = TexMgr_ResampleTexture(
-            data, glt->width, glt->height, glt->flags & TEXPREF_ALPHA);
+            up, data, glt->width, glt->height, glt->flags & TEXPREF_ALPHA);
         glt->width = TexMgr_Pad(glt->width);
         glt->height = TexMgr_Pad(glt->height);
     }
@@ -1393,21 +1325,21 @@ static void TexMgr_LoadImage32(gltexture_t* glt, unsigned* data)
         }
     }
 
-    // upload
-    GL_Bind(glt);
-    internalformat =
-        (glt->flags & TEXPREF_ALPHA) ? gl_alpha_format : gl_solid_format;
-    glTexImage2D(GL_TEXTURE_2D, 0, internalformat, glt->width, glt->height, 0,
-        GL_RGBA, GL_UNSIGNED_BYTE, data);
+    up.levels.push_back({(int)glt->width, (int)glt->height, data});
 
-    // upload mipmaps
+    // mipmaps -- each level is reduced in place from a copy of the last one
     if(glt->flags & TEXPREF_MIPMAP)
     {
         mipwidth = glt->width;
         mipheight = glt->height;
 
-        for(miplevel = 1; mipwidth > 1 || mipheight > 1; miplevel++)
+        while(mipwidth > 1 || mipheight > 1)
         {
+            const size_t size = (size_t)mipwidth * mipheight * 4;
+            auto* mip = (unsigned*)TexMgr_UploadAlloc(up, size);
+            memcpy(mip, data, size);
+            data = mip;
+
             if(mipwidth > 1)
             {
                 TexMgr_MipMapW(data, mipwidth, mipheight);
@@ -1418,10 +1350,29 @@ static void TexMgr_LoadImage32(gltexture_t* glt, unsigned* data)
                 TexMgr_MipMapH(data, mipwidth, mipheight);
                 mipheight >>= 1;
             }
-            glTexImage2D(GL_TEXTURE_2D, miplevel, internalformat, mipwidth,
-                mipheight, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+
+            up.levels.push_back({mipwidth, mipheight, data});
         }
     }
+}
+
+/*
+================
+TexMgr_Upload32 -- uploads a mip chain built by TexMgr_Prepare32
+================
+*/
+static void TexMgr_Upload32(gltexture_t* glt, const texupload_t& up)
+{
+    GL_Bind(glt);
+    const int internalformat =
+        (glt->flags & TEXPREF_ALPHA) ? gl_alpha_format : gl_solid_format;
+
+    for(size_t miplevel = 0; miplevel < up.levels.size(); miplevel++)
+    {
+        const texlevel_t& level = up.levels[miplevel];
+        glTexImage2D(GL_TEXTURE_2D, miplevel, internalformat, level.width,
+            level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, level.data);
+    }
 
     // set filter modes
     TexMgr_SetFilterModes(glt);
@@ -1578,10 +1529,10 @@ static void TexMgr_LoadImageCompressed(gltexture_t* glt, byte* data)
 
 /*
 ================
-TexMgr_LoadImage8 -- handles 8bit source data, then passes it to LoadImage32
+TexMgr_Prepare8 -- converts 8bit source data, then passes it to Prepare32
 ================
 */
-static void TexMgr_LoadImage8(gltexture_t* glt, byte* data)
+static void TexMgr_Prepare8(gltexture_t* glt, byte* data, texupload_t& up)
 {
     extern cvar_t gl_fullbrights;
     bool padw = false;
@@ -1659,20 +1610,22 @@ static void TexMgr_LoadImage8(gltexture_t* glt, byte* data)
     {
         if((int)glt->width < TexMgr_SafeTextureSize(glt->width))
         {
-            data = TexMgr_PadImageW(data, glt->width, glt->height, padbyte);
+            data =
+                TexMgr_PadImageW(up, data, glt->width, glt->height, padbyte);
             glt->width = TexMgr_Pad(glt->width);
             padw = true;
         }
         if((int)glt->height < TexMgr_SafeTextureSize(glt->height))
         {
-            data = TexMgr_PadImageH(data, glt->width, glt->height, padbyte);
+            data =
+                TexMgr_PadImageH(up, data, glt->width, glt->height, padbyte);
             glt->height = TexMgr_Pad(glt->height);
             padh = true;
         }
     }
 
     // convert to 32bit
-    data = (byte*)TexMgr_8to32(data, glt->width * glt->height, usepal);
+    data = (byte*)TexMgr_8to32(up, data, glt->width * glt->height, usepal);
 
     // fix edges
     if((glt->flags & TEXPREF_ALPHA) && !(glt->flags & TEXPREF_PREMULTIPLY))
@@ -1691,8 +1644,183 @@ static void TexMgr_LoadImage8(gltexture_t* glt, byte* data)
         }
     }
 
-    // upload it
-    TexMgr_LoadImage32(glt, (unsigned*)data);
+    TexMgr_Prepare32(glt, (unsigned*)data, up);
+}
+
+/*
+================================================================================
+
+    BATCHED LOADING
+
+While a batch is open, 8 and 32 bit images are only copied when loaded. The
+batch is converted on the job threads when it closes (or grows too large), then
+uploaded in order from the main thread.
+
+================================================================================
+*/
+
+// Copy of the caller's data, which is usually freed before the batch ends.
+struct texpending_t
+{
+    gltexture_t* glt;
+    srcformat format;
+    std::unique_ptr<byte[]> source;
+    texupload_t up;
+};
+
+#define TEXBATCH_MAXBYTES (256 * 1024 * 1024)
+
+static int texbatch_depth;
+static size_t texbatch_bytes;
+static std::vector<texpending_t> texbatch_pending;
+
+/*
+================
+TexMgr_DropPending -- forget queued images of a texture being replaced or freed
+================
+*/
+static void TexMgr_DropPending(gltexture_t* glt)
+{
+    if(texbatch_pending.empty())
+    {
+        return;
+    }
+
+    const auto it = std::remove_if(texbatch_pending.begin(),
+        texbatch_pending.end(),
+        [&](const texpending_t& p) { return p.glt == glt; });
+
+    texbatch_pending.erase(it, texbatch_pending.end());
+}
+
+/*
+================
+TexMgr_FlushBatch
+================
+*/
+static void TexMgr_FlushBatch()
+{
+    if(texbatch_pending.empty())
+    {
+        return;
+    }
+
+    quake::jobs::parallelFor(texbatch_pending.size(), 1,
+        [](const std::size_t begin, const std::size_t end) {
+            for(std::size_t i = begin; i < end; ++i)
+            {
+                texpending_t& p = texbatch_pending[i];
+                if(p.format == SRC_INDEXED)
+                {
+                    TexMgr_Prepare8(p.glt, p.source.get(), p.up);
+                }
+                else
+                {
+                    TexMgr_Prepare32(p.glt, (unsigned*)p.source.get(), p.up);
+                }
+            }
+        });
+
+    for(texpending_t& p : texbatch_pending)
+    {
+        TexMgr_Upload32(p.glt, p.up);
+    }
+
+    texbatch_pending.clear();
+    texbatch_bytes = 0;
+}
+
+/*
+================
+TexMgr_QueueImage -- returns false if the image must be loaded right away
+================
+*/
+[[nodiscard]] static bool TexMgr_QueueImage(
+    gltexture_t* glt, srcformat format, byte* data)
+{
+    if(texbatch_depth == 0 || !gl_texbatch.value)
+    {
+        return false;
+    }
+
+    if(glt->flags & TEXPREF_OVERWRITE)
+    {
+        TexMgr_DropPending(glt);
+    }
+
+    const size_t size = TexMgr_ImageSize(glt->width, glt->height, format);
+
+    texpending_t& p = texbatch_pending.emplace_back();
+    p.glt = glt;
+    p.format = format;
+    p.source.reset(new byte[size]);
+    memcpy(p.source.get(), data, size);
+
+    // converted images take about 4-6x their source size until uploaded
+    texbatch_bytes += size * (format == SRC_INDEXED ? 6 : 2);
+    if(texbatch_bytes > TEXBATCH_MAXBYTES)
+    {
+        TexMgr_FlushBatch();
+    }
+
+    return true;
+}
+
+/*
+================
+TexMgr_BeginBatch -- batches nest, only the outermost TexMgr_EndBatch uploads
+================
+*/
+void TexMgr_BeginBatch()
+{
+    texbatch_depth++;
+}
+
+/*
+================
+TexMgr_EndBatch
+================
+*/
+void TexMgr_EndBatch()
+{
+    if(texbatch_depth > 0 && --texbatch_depth == 0)
+    {
+        TexMgr_FlushBatch();
+    }
+}
+
+/*
+================
+TexMgr_LoadImage32 -- handles 32bit source data
+================
+*/
+static void TexMgr_LoadImage32(gltexture_t* glt, unsigned* data)
+{
+    if(TexMgr_QueueImage(glt, SRC_RGBA, (byte*)data))
+    {
+        return;
+    }
+
+    texupload_t up;
+    TexMgr_Prepare32(glt, data, up);
+    TexMgr_Upload32(glt, up);
+}
+
+/*
+================
+TexMgr_LoadImage8 -- handles 8bit source data
+================
+*/
+static void TexMgr_LoadImage8(gltexture_t* glt, byte* data)
+{
+    if(TexMgr_QueueImage(glt, SRC_INDEXED, data))
+    {
+        return;
+    }
+
+    texupload_t up;
+    TexMgr_Prepare8(glt, data, up);
+    TexMgr_Upload32(glt, up);
 }
 
 /*
@@ -114,6 +114,11 @@ void TexMgr_ReloadImage(gltexture_t* glt, int shirt, int pants);
 void TexMgr_ReloadImages();
 void TexMgr_ReloadNobrightImages();
 
+// textures loaded between these are converted on the job threads, then
+// uploaded by the outermost TexMgr_EndBatch
+void TexMgr_BeginBatch();
+void TexMgr_EndBatch();
+
 [[nodiscard]] int TexMgr_Pad(int s);
 [[nodiscard]] int TexMgr_SafeTextureSize(int s);
 [[nodiscard]] int TexMgr_PadConditional(int s);
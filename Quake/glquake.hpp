@@ -169,6 +169,7 @@ extern cvar_t r_lavaalpha;
 extern cvar_t r_telealpha;
 extern cvar_t r_slimealpha;
 extern cvar_t r_dynamic;
+extern cvar_t r_lightmap_simd;
 extern cvar_t r_novis;
 extern cvar_t r_scale;
 
@@ -416,6 +417,7 @@ void R_MarkLights(
     dlight_t* light, const qvec3& lightorg, int num, mnode_t* node);
 
 void R_InitParticles();
+void R_SeedParticles(unsigned int seed);
 void R_DrawParticles();
 void CL_RunParticles();
 void R_ClearParticles();
@@ -446,7 +448,8 @@ int R_LightPoint(const qvec3& p);
 
 void GL_SubdivideSurface(msurface_t* fa);
 void R_BuildLightMap(qmodel_t* model, msurface_t* surf, byte* dest, int stride);
-void R_RenderDynamicLightmaps(qmodel_t* model, msurface_t* fa);
+void R_RenderDynamicLightmaps(msurface_t* fa);
+void R_BuildDynamicLightmaps(qmodel_t* model);
 void R_UploadLightmaps();
 
 void R_DrawWorld_ShowTris();
@@ -27,6 +27,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "quakedef.hpp"
 #include "bgmusic.hpp"
 #include <setjmp.h>
+#include <exception>
 #include "vr.hpp"
 #include "vr_cvars.hpp"
 #include "cmd.hpp"
@@ -44,6 +45,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "client.hpp"
 #include "console.hpp"
 #include "saveutil.hpp"
+#include "jobs.hpp"
 #include "sys.hpp"
 #include "server.hpp"
 #include "screen.hpp"
@@ -55,6 +57,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "view.hpp"
 #include "developer.hpp"
 #include "qcvm.hpp"
+#include "sv_bench.hpp"
+#include "cl_bench.hpp"
 
 /*
 
@@ -193,6 +197,7 @@ void Host_EndGame(const char* message, ...)
     Con_DPrintf("Host_EndGame: %s\n", string);
 
     PR_SwitchQCVM(nullptr);
+    SV_Bench_Abort();
 
     if(sv.active)
     {
@@ -276,6 +281,7 @@ void Host_Error(const char* error, ...)
     }
 
     PR_SwitchQCVM(nullptr);
+    SV_Bench_Abort();
 
     SCR_EndLoadingPlaque(); // reenable screen updates
 
@@ -471,6 +477,8 @@ void Host_WriteConfiguration()
             return;
         }
 
+        COM_InvalidateFileCache();
+
         // VID_SyncCvars (); //johnfitz -- write actual current mode to config
         // file, in case cvars were messed with
 
@@ -591,6 +599,10 @@ void SV_DropClient(bool crash)
             pr_global_struct->self = EDICT_TO_PROG(host_client->edict);
             PR_ExecuteProgram(pr_global_struct->ClientDisconnect);
             pr_global_struct->self = saveSelf;
+
+            // the other clients' prepared snapshots may point at edicts
+            // ClientDisconnect has just freed
+            SV_InvalidateClientSnapshots();
         }
 
         Sys_Printf("Client %s removed\n", host_client->name);
@@ -743,6 +755,7 @@ void Host_ClearMemory()
 {
     Con_DPrintf("Clearing memory\n");
     D_FlushCaches();
+    COM_InvalidateFileCache();
     Mod_ClearAll();
     /* host_hunklevel MUST be set at this point */
     Hunk_FreeToLowMark(host_hunklevel);
@@ -1106,6 +1119,7 @@ void _Host_Frame(double time) // QSS
     SCR_UpdateScreen();
 
     CL_RunParticles(); // johnfitz -- seperated from rendering
+    CL_Bench_EndFrame();
 
     if(host_speeds.value)
     {
@@ -1219,6 +1233,7 @@ void Host_Init()
     Cvar_Init(); // johnfitz
     VR_InitCvars();
     COM_Init();
+    quake::jobs::init();
     COM_InitFilesystem();
     Host_InitLocal();
     W_LoadWadFile(); // johnfitz -- filename is now hard-coded for honesty
@@ -1288,6 +1303,8 @@ void Host_Init()
             VR_ModAllModels();
         }
 
+        CL_Bench_QueueFromCommandLine();
+
         // johnfitz -- in case the vid mode was locked during vid_init, we
         // can unlock it now. note: two leading newlines because the command
         // buffer swallows one of them.
@@ -1310,7 +1327,7 @@ void Host_Init()
         Cbuf_AddText("stuffcmds");
         Cbuf_Execute();
 
-        if(!sv.active)
+        if(!sv.active && !SV_Bench_QueueFromCommandLine())
         {
             // QSS
             Cbuf_AddText("startmap_dm\n");
@@ -1343,6 +1360,8 @@ void Host_Shutdown()
 
     Host_WriteConfiguration();
 
+    quake::saveutil::finishPendingSave();
+
     NET_Shutdown();
 
     if(cls.state != ca_dedicated)
@@ -1351,6 +1370,7 @@ void Host_Shutdown()
         {
             History_Shutdown();
         }
+        CL_ShutdownDemo();
         BGM_Shutdown();
         CDAudio_Shutdown();
         S_Shutdown();
@@ -1359,5 +1379,7 @@ void Host_Shutdown()
         VID_Shutdown();
     }
 
+    quake::jobs::shutdown();
+
     LOG_Close();
 }
@@ -1273,8 +1273,6 @@ LOAD / SAVE GAME
 ===============================================================================
 */
 
-#define SAVEGAME_VERSION 5
-
 /*
 ===============
 Host_SavegameComment
@@ -1307,8 +1305,8 @@ void Host_SavegameComment(char* text)
     text[SAVEGAME_COMMENT_LENGTH] = '\0';
 }
 
-bool Host_MakeSavegame(
-    const char* filename, const std::time_t* timestamp, const bool printMessage)
+bool Host_MakeSavegame(const char* filename, const std::time_t* timestamp,
+    const bool printMessage, const bool background)
 {
     if(!sv.active)
     {
@@ -1352,115 +1350,32 @@ bool Host_MakeSavegame(
         Con_Printf("Saving game to %s...\n", name);
     }
 
-    FILE* f = fopen(name, "w");
-    if(!f)
-    {
-        Con_Printf("ERROR: couldn't open.\n");
-        return false;
-    }
-
-    if(timestamp != nullptr)
-    {
-        std::tm* ptm = gmtime(timestamp);
-
-        char buf[256];
-        std::strftime(buf, sizeof(buf), "%F %T", ptm);
-
-        fprintf(f, "%s\n", buf);
-    }
-
-    // QSS
-    QCVMGuard qg{&sv.qcvm};
-
-    fprintf(f, "%i\n", SAVEGAME_VERSION);
     char comment[SAVEGAME_COMMENT_LENGTH + 1];
     Host_SavegameComment(comment);
-    fprintf(f, "%s\n", comment);
 
-    for(int i = 0; i < NUM_BASIC_SPAWN_PARMS; i++) // QSS
-    {
-        fprintf(f, "%f\n", svs.clients->spawn_parms[i]);
-    }
-
-    fprintf(f, "%d\n", current_skill);
-    fprintf(f, "%s\n", sv.name);
-    fprintf(f, "%f\n", qcvm->time); // QSS
-
-    // write the light styles
+    quake::saveutil::SaveSnapshot snapshot;
 
-    for(int i = 0; i < MAX_LIGHTSTYLES_VANILLA; i++) // QSS
     {
-        if(sv.lightstyles[i])
-        {
-            fprintf(f, "%s\n", sv.lightstyles[i]);
-        }
-        else
-        {
-            fprintf(f, "m\n");
-        }
+        // QSS
+        QCVMGuard qg{&sv.qcvm};
+        quake::saveutil::captureSaveSnapshot(snapshot, timestamp, comment);
     }
 
-    ED_WriteGlobals(f);
-    for(int i = 0; i < qcvm->num_edicts; i++) // QSS
+    if(background)
     {
-        ED_Write(f, EDICT_NUM(i));
-        fflush(f);
+        quake::saveutil::writeSaveSnapshotAsync(
+            name, std::move(snapshot), printMessage);
+        return true;
     }
 
-    // QSS
-    // add extra info (lightstyles, precaches, etc) in a way that's supposed to
-    // be compatible with DP. sidenote - this provides extended lightstyles and
-    // support for late precaches it does NOT protect against spawnfunc precache
-    // changes - we would need to include makestatics here too (and optionally
-    // baselines, or just recalculate those).
-    fprintf(f, "/*\n");
-    fprintf(f, "// QuakeSpasm extended savegame\n");
-    int i = 0;
-    for(i = MAX_LIGHTSTYLES_VANILLA; i < MAX_LIGHTSTYLES; i++)
-    {
-        if(sv.lightstyles[i])
-        {
-            fprintf(f, "sv.lightstyles %i \"%s\"\n", i, sv.lightstyles[i]);
-        }
-    }
-    for(i = 1; i < MAX_MODELS; i++)
-    {
-        if(sv.model_precache[i])
-        {
-            fprintf(
-                f, "sv.model_precache %i \"%s\"\n", i, sv.model_precache[i]);
-        }
-    }
-    for(i = 1; i < MAX_SOUNDS; i++)
-    {
-        if(sv.sound_precache[i])
-        {
-            fprintf(
-                f, "sv.sound_precache %i \"%s\"\n", i, sv.sound_precache[i]);
-        }
-    }
-    for(i = 1; i < MAX_PARTICLETYPES; i++)
-    {
-        if(sv.particle_precache[i])
-        {
-            fprintf(f, "sv.particle_precache %i \"%s\"\n", i,
-                sv.particle_precache[i]);
-        }
-    }
+    quake::saveutil::finishPendingSave();
 
-    for(i = NUM_BASIC_SPAWN_PARMS; i < NUM_TOTAL_SPAWN_PARMS; i++)
+    if(!quake::saveutil::writeSaveSnapshot(name, snapshot))
     {
-        if(svs.clients->spawn_parms[i])
-        {
-            fprintf(
-                f, "spawnparm %i \"%f\"\n", i + 1, svs.clients->spawn_parms[i]);
-        }
+        Con_Printf("ERROR: couldn't open.\n");
+        return false;
     }
 
-    fprintf(f, "*/\n");
-
-    fclose(f);
-
     if(printMessage)
     {
         Con_Printf("done.\n");
@@ -1494,6 +1409,9 @@ void Host_Savegame_f()
 
 bool Host_Loadgame(const char* filename, const bool hasTimestamp)
 {
+    // an autosave may still be being written in the background
+    quake::saveutil::finishPendingSave();
+
     if(strstr(filename, ".."))
     {
         Con_Printf("Relative pathnames are not allowed.\n");
@@ -1739,6 +1657,7 @@ bool Host_Loadgame(const char* filename, const bool hasTimestamp)
 
     qcvm->num_edicts = entnum;
     qcvm->time = time;
+    PR_FieldIndexClear(qcvm);
 
     free(start);
     start = nullptr;
@@ -2251,6 +2170,7 @@ void Host_Spawn_f()
         ent = host_client->edict;
 
         memset(&ent->v, 0, qcvm->progs->entityfields * 4); // QSS
+        PR_FieldIndexTouch(ent);
 
         ent->v.colormap = NUM_FOR_EDICT(ent);
         ent->v.team = (host_client->colors & 15) + 1;
@@ -0,0 +1,463 @@
+#include "image_kernels.hpp"
+
+namespace quake::image
+{
+
+namespace
+{
+
+//
+// Scalar kernels: these define the expected output. The SIMD versions handle
+// whole vectors and leave the remainder to them.
+//
+
+void mipMapWPairsScalar(std::uint32_t* data, std::size_t begin,
+    const std::size_t pairs) noexcept
+{
+    auto* out = reinterpret_cast<std::uint8_t*>(data + begin);
+    auto* in = reinterpret_cast<const std::uint8_t*>(data + begin * 2);
+
+    for(; begin < pairs; ++begin, out += 4, in += 8)
+    {
+        out[0] = (in[0] + in[4]) >> 1;
+        out[1] = (in[1] + in[5]) >> 1;
+        out[2] = (in[2] + in[6]) >> 1;
+        out[3] = (in[3] + in[7]) >> 1;
+    }
+}
+
+void mipMapHRowScalar(std::uint8_t* out, const std::uint8_t* top,
+    const std::uint8_t* bottom, std::size_t begin,
+    const std::size_t bytes) noexcept
+{
+    for(; begin < bytes; ++begin)
+    {
+        out[begin] = (top[begin] + bottom[begin]) >> 1;
+    }
+}
+
+[[nodiscard]] std::uint32_t resamplePixelScalar(const std::uint32_t* nw,
+    const int inwidth, const unsigned modx, const unsigned mody,
+    const bool alpha) noexcept
+{
+    const unsigned imodx = 256 - modx;
+    const unsigned imody = 256 - mody;
+
+    const auto* nwpx = reinterpret_cast<const std::uint8_t*>(nw);
+    const std::uint8_t* nepx = nwpx + 4;
+    const std::uint8_t* swpx = nwpx + inwidth * 4;
+    const std::uint8_t* sepx = swpx + 4;
+
+    std::uint32_t res;
+    auto* dest = reinterpret_cast<std::uint8_t*>(&res);
+
+    for(int c = 0; c < 3; ++c)
+    {
+        dest[c] = (nwpx[c] * imodx * imody + nepx[c] * modx * imody +
+                      swpx[c] * imodx * mody + sepx[c] * modx * mody) >>
+                  16;
+    }
+
+    if(alpha)
+    {
+        dest[3] = (nwpx[3] * imodx * imody + nepx[3] * modx * imody +
+                      swpx[3] * imodx * mody + sepx[3] * modx * mody) >>
+                  16;
+    }
+    else
+    {
+        dest[3] = 255;
+    }
+
+    return res;
+}
+
+// Runs `pixel(nw, modx, mody)` for every output pixel, with the same fixed
+// point stepping as the original quakespasm resampler.
+template <typename F>
+void resampleRows(const std::uint32_t* in, const int inwidth,
+    const int inheight, std::uint32_t* out, const int outwidth,
+    const int outheight, F&& pixel) noexcept
+{
+    const unsigned xfrac = ((inwidth - 1) << 16) / (outwidth - 1);
+    const unsigned yfrac = ((inheight - 1) << 16) / (outheight - 1);
+    unsigned y = 0;
+
+    for(int i = 0; i < outheight; ++i, out += outwidth, y += yfrac)
+    {
+        const unsigned mody = (y >> 8) & 0xFF;
+        const std::uint32_t* row = in + (y >> 16) * inwidth;
+        unsigned x = 0;
+
+        for(int j = 0; j < outwidth; ++j, x += xfrac)
+        {
+            out[j] = pixel(row + (x >> 16), (x >> 8) & 0xFF, mody);
+        }
+    }
+}
+
+void mipMapWScalar(
+    std::uint32_t* data, const int width, const int height) noexcept
+{
+    mipMapWPairsScalar(data, 0, (std::size_t(width) * height) >> 1);
+}
+
+void mipMapHScalar(
+    std::uint32_t* data, const int width, const int height) noexcept
+{
+    const std::size_t rowBytes = std::size_t(width) * 4;
+    auto* bytes = reinterpret_cast<std::uint8_t*>(data);
+
+    for(int i = 0; i < height / 2; ++i)
+    {
+        const std::uint8_t* top = bytes + rowBytes * 2 * i;
+        mipMapHRowScalar(
+            bytes + rowBytes * i, top, top + rowBytes, 0, rowBytes);
+    }
+}
+
+void resampleScalar(const std::uint32_t* in, const int inwidth,
+    const int inheight, std::uint32_t* out, const int outwidth,
+    const int outheight, const bool alpha) noexcept
+{
+    resampleRows(in, inwidth, inheight, out, outwidth, outheight,
+        [&](const std::uint32_t* nw, const unsigned modx,
+            const unsigned mody) {
+            return resamplePixelScalar(nw, inwidth, modx, mody, alpha);
+        });
+}
+
+void palette8to32Scalar(const std::uint8_t* in, const std::size_t pixels,
+    const std::uint32_t* palette, std::uint32_t* out) noexcept
+{
+    for(std::size_t i = 0; i < pixels; ++i)
+    {
+        out[i] = palette[in[i]];
+    }
+}
+
+#if QUAKE_SIMD_X86
+
+//
+// SSE2
+//
+
+// (a + b) >> 1 per byte. `_mm_avg_epu8` rounds up, so take the carry back.
+[[nodiscard]] __m128i floorAvgSSE2(const __m128i a, const __m128i b) noexcept
+{
+    return _mm_sub_epi8(_mm_avg_epu8(a, b),
+        _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+}
+
+void mipMapWSSE2(
+    std::uint32_t* data, const int width, const int height) noexcept
+{
+    const std::size_t pairs = (std::size_t(width) * height) >> 1;
+    std::size_t i = 0;
+
+    // four output pixels from eight input ones; stores never pass the loads
+    for(; i + 4 <= pairs; i += 4)
+    {
+        const __m128 a = _mm_castsi128_ps(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 2)));
+        const __m128 b = _mm_castsi128_ps(_mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(data + i * 2 + 4)));
+
+        const __m128i even =
+            _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        const __m128i odd =
+            _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+
+        _mm_storeu_si128(
+            reinterpret_cast<__m128i*>(data + i), floorAvgSSE2(even, odd));
+    }
+
+    mipMapWPairsScalar(data, i, pairs);
+}
+
+void mipMapHSSE2(
+    std::uint32_t* data, const int width, const int height) noexcept
+{
+    const std::size_t rowBytes = std::size_t(width) * 4;
+    auto* bytes = reinterpret_cast<std::uint8_t*>(data);
+
+    for(int i = 0; i < height / 2; ++i)
+    {
+        std::uint8_t* out = bytes + rowBytes * i;
+        const std::uint8_t* top = bytes + rowBytes * 2 * i;
+        const std::uint8_t* bottom = top + rowBytes;
+        std::size_t j = 0;
+
+        for(; j + 16 <= rowBytes; j += 16)
+        {
+            const __m128i a =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(top + j));
+            const __m128i b =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + j));
+
+            _mm_storeu_si128(
+                reinterpret_cast<__m128i*>(out + j), floorAvgSSE2(a, b));
+        }
+
+        mipMapHRowScalar(out, top, bottom, j, rowBytes);
+    }
+}
+
+// All the products and sums are integers below 2^24, so single precision
+// floats compute the scalar fixed point sum exactly, and scaling by 2^-16
+// then truncating matches the `>> 16`.
+void resampleSSE2(const std::uint32_t* in, const int inwidth,
+    const int inheight, std::uint32_t* out, const int outwidth,
+    const int outheight, const bool alpha) noexcept
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 scale = _mm_set1_ps(1.f / 65536.f);
+    const std::uint32_t alphaMask = alpha ? 0 : 0xFF000000;
+
+    resampleRows(in, inwidth, inheight, out, outwidth, outheight,
+        [&](const std::uint32_t* nw, const unsigned modx,
+            const unsigned mody) {
+            const unsigned imodx = 256 - modx;
+            const unsigned imody = 256 - mody;
+
+            // nw and ne are adjacent, as are sw and se
+            const __m128i top = _mm_unpacklo_epi8(
+                _mm_loadl_epi64(reinterpret_cast<const __m128i*>(nw)), zero);
+            const __m128i bottom = _mm_unpacklo_epi8(
+                _mm_loadl_epi64(
+                    reinterpret_cast<const __m128i*>(nw + inwidth)),
+                zero);
+
+            const __m128 nwpx = _mm_cvtepi32_ps(_mm_unpacklo_epi16(top, zero));
+            const __m128 nepx = _mm_cvtepi32_ps(_mm_unpackhi_epi16(top, zero));
+            const __m128 swpx =
+                _mm_cvtepi32_ps(_mm_unpacklo_epi16(bottom, zero));
+            const __m128 sepx =
+                _mm_cvtepi32_ps(_mm_unpackhi_epi16(bottom, zero));
+
+            const __m128 sum = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(nwpx, _mm_set1_ps(float(imodx * imody))),
+                    _mm_mul_ps(nepx, _mm_set1_ps(float(modx * imody)))),
+                _mm_add_ps(_mm_mul_ps(swpx, _mm_set1_ps(float(imodx * mody))),
+                    _mm_mul_ps(sepx, _mm_set1_ps(float(modx * mody)))));
+
+            const __m128i v = _mm_cvttps_epi32(_mm_mul_ps(sum, scale));
+            const __m128i packed =
+                _mm_packus_epi16(_mm_packs_epi32(v, zero), zero);
+
+            return std::uint32_t(_mm_cvtsi128_si32(packed)) | alphaMask;
+        });
+}
+
+//
+// AVX2
+//
+
+QUAKE_TARGET_AVX2 [[nodiscard]] __m256i floorAvgAVX2(
+    const __m256i a, const __m256i b) noexcept
+{
+    return _mm256_sub_epi8(_mm256_avg_epu8(a, b),
+        _mm256_and_si256(_mm256_xor_si256(a, b), _mm256_set1_epi8(1)));
+}
+
+QUAKE_TARGET_AVX2 void mipMapWAVX2(
+    std::uint32_t* data, const int width, const int height) noexcept
+{
+    const std::size_t pairs = (std::size_t(width) * height) >> 1;
+    std::size_t i = 0;
+
+    for(; i + 8 <= pairs; i += 8)
+    {
+        const __m256 a = _mm256_castsi256_ps(_mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(data + i * 2)));
+        const __m256 b = _mm256_castsi256_ps(_mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(data + i * 2 + 8)));
+
+        // per lane, so the pairs come out as 0 2 8 10 | 4 6 12 14
+        const __m256i even = _mm256_castps_si256(
+            _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        const __m256i odd = _mm256_castps_si256(
+            _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+
+        const __m256i avg = _mm256_permute4x64_epi64(
+            floorAvgAVX2(even, odd), _MM_SHUFFLE(3, 1, 2, 0));
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + i), avg);
+    }
+
+    mipMapWPairsScalar(data, i, pairs);
+}
+
+QUAKE_TARGET_AVX2 void mipMapHAVX2(
+    std::uint32_t* data, const int width, const int height) noexcept
+{
+    const std::size_t rowBytes = std::size_t(width) * 4;
+    auto* bytes = reinterpret_cast<std::uint8_t*>(data);
+
+    for(int i = 0; i < height / 2; ++i)
+    {
+        std::uint8_t* out = bytes + rowBytes * i;
+        const std::uint8_t* top = bytes + rowBytes * 2 * i;
+        const std::uint8_t* bottom = top + rowBytes;
+        std::size_t j = 0;
+
+        for(; j + 32 <= rowBytes; j += 32)
+        {
+            const __m256i a =
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(top + j));
+            const __m256i b = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(bottom + j));
+
+            _mm256_storeu_si256(
+                reinterpret_cast<__m256i*>(out + j), floorAvgAVX2(a, b));
+        }
+
+        mipMapHRowScalar(out, top, bottom, j, rowBytes);
+    }
+}
+
+// Same exact float arithmetic as `resampleSSE2`, with the top pair of
+// pixels in one register and the bottom pair in another. The row stepping is
+// spelled out rather than shared with `resampleRows`, so that the per pixel
+// code can be inlined into this AVX2 function.
+QUAKE_TARGET_AVX2 void resampleAVX2(const std::uint32_t* in, const int inwidth,
+    const int inheight, std::uint32_t* out, const int outwidth,
+    const int outheight, const bool alpha) noexcept
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 scale = _mm_set1_ps(1.f / 65536.f);
+    const std::uint32_t alphaMask = alpha ? 0 : 0xFF000000;
+
+    const unsigned xfrac = ((inwidth - 1) << 16) / (outwidth - 1);
+    const unsigned yfrac = ((inheight - 1) << 16) / (outheight - 1);
+    unsigned y = 0;
+
+    for(int i = 0; i < outheight; ++i, out += outwidth, y += yfrac)
+    {
+        const unsigned mody = (y >> 8) & 0xFF;
+        const unsigned imody = 256 - mody;
+        const std::uint32_t* row = in + (y >> 16) * inwidth;
+        unsigned x = 0;
+
+        for(int j = 0; j < outwidth; ++j, x += xfrac)
+        {
+            const std::uint32_t* nw = row + (x >> 16);
+            const unsigned modx = (x >> 8) & 0xFF;
+            const unsigned imodx = 256 - modx;
+
+            const __m256 top = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
+                _mm_loadl_epi64(reinterpret_cast<const __m128i*>(nw))));
+            const __m256 bottom = _mm256_cvtepi32_ps(
+                _mm256_cvtepu8_epi32(_mm_loadl_epi64(
+                    reinterpret_cast<const __m128i*>(nw + inwidth))));
+
+            const __m256 topWeights = _mm256_insertf128_ps(
+                _mm256_castps128_ps256(_mm_set1_ps(float(imodx * imody))),
+                _mm_set1_ps(float(modx * imody)), 1);
+            const __m256 bottomWeights = _mm256_insertf128_ps(
+                _mm256_castps128_ps256(_mm_set1_ps(float(imodx * mody))),
+                _mm_set1_ps(float(modx * mody)), 1);
+
+            const __m256 sums = _mm256_add_ps(_mm256_mul_ps(top, topWeights),
+                _mm256_mul_ps(bottom, bottomWeights));
+            const __m128 sum = _mm_add_ps(_mm256_castps256_ps128(sums),
+                _mm256_extractf128_ps(sums, 1));
+
+            const __m128i v = _mm_cvttps_epi32(_mm_mul_ps(sum, scale));
+            const __m128i packed =
+                _mm_packus_epi16(_mm_packs_epi32(v, zero), zero);
+
+            out[j] = std::uint32_t(_mm_cvtsi128_si32(packed)) | alphaMask;
+        }
+    }
+}
+
+QUAKE_TARGET_AVX2 void palette8to32AVX2(const std::uint8_t* in,
+    const std::size_t pixels, const std::uint32_t* palette,
+    std::uint32_t* out) noexcept
+{
+    const auto* table = reinterpret_cast<const int*>(palette);
+    std::size_t i = 0;
+
+    for(; i + 8 <= pixels; i += 8)
+    {
+        const __m256i indices = _mm256_cvtepu8_epi32(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i)));
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+            _mm256_i32gather_epi32(table, indices, 4));
+    }
+
+    palette8to32Scalar(in + i, pixels - i, palette, out + i);
+}
+
+#endif
+
+} // namespace
+
+void mipMapW(const simd::Level level, std::uint32_t* data, const int width,
+    const int height) noexcept
+{
+    switch(level)
+    {
+#if QUAKE_SIMD_X86
+        case simd::Level::AVX2: mipMapWAVX2(data, width, height); return;
+        case simd::Level::SSE2: mipMapWSSE2(data, width, height); return;
+#endif
+        default: mipMapWScalar(data, width, height); return;
+    }
+}
+
+void mipMapH(const simd::Level level, std::uint32_t* data, const int width,
+    const int height) noexcept
+{
+    switch(level)
+    {
+#if QUAKE_SIMD_X86
+        case simd::Level::AVX2: mipMapHAVX2(data, width, height); return;
+        case simd::Level::SSE2: mipMapHSSE2(data, width, height); return;
+#endif
+        default: mipMapHScalar(data, width, height); return;
+    }
+}
+
+void resample(const simd::Level level, const std::uint32_t* in,
+    const int inwidth, const int inheight, std::uint32_t* out,
+    const int outwidth, const int outheight, const bool alpha) noexcept
+{
+    switch(level)
+    {
+#if QUAKE_SIMD_X86
+        case simd::Level::AVX2:
+            resampleAVX2(
+                in, inwidth, inheight, out, outwidth, outheight, alpha);
+            return;
+        case simd::Level::SSE2:
+            resampleSSE2(
+                in, inwidth, inheight, out, outwidth, outheight, alpha);
+            return;
+#endif
+        default:
+            resampleScalar(
+                in, inwidth, inheight, out, outwidth, outheight, alpha);
+            return;
+    }
+}
+
+void palette8to32(const simd::Level level, const std::uint8_t* in,
+    const std::size_t pixels, const std::uint32_t* palette,
+    std::uint32_t* out) noexcept
+{
+    switch(level)
+    {
+#if QUAKE_SIMD_X86
+        case simd::Level::AVX2:
+            palette8to32AVX2(in, pixels, palette, out);
+            return;
+#endif
+        // SSE2 has no gather, so its lookups stay scalar
+        default: palette8to32Scalar(in, pixels, palette, out); return;
+    }
+}
+
+} // namespace quake::image
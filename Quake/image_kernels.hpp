@@ -0,0 +1,38 @@
+#pragma once
+
+#include "simd.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+// Pixel kernels used by the texture manager to convert and mipmap images
+// before uploading them. Every level produces exactly the same bytes as the
+// scalar version, so `level` only trades speed. Images are 32 bit RGBA, one
+// `std::uint32_t` per pixel.
+//
+// Kept free of engine dependencies so that `quakevr-bench-imagekernels` can
+// build them on their own.
+
+namespace quake::image
+{
+
+// Halves the width of `data` in place, averaging pairs of pixels.
+void mipMapW(simd::Level level, std::uint32_t* data, int width,
+    int height) noexcept;
+
+// Halves the height of `data` in place, averaging pairs of rows.
+void mipMapH(simd::Level level, std::uint32_t* data, int width,
+    int height) noexcept;
+
+// Bilinear resample of `in` to `outwidth` by `outheight`. Without `alpha`,
+// the output alpha is 255.
+void resample(simd::Level level, const std::uint32_t* in, int inwidth,
+    int inheight, std::uint32_t* out, int outwidth, int outheight,
+    bool alpha) noexcept;
+
+// Expands indexed pixels through a 256 entry palette.
+void palette8to32(simd::Level level, const std::uint8_t* in,
+    std::size_t pixels, const std::uint32_t* palette,
+    std::uint32_t* out) noexcept;
+
+} // namespace quake::image
@@ -0,0 +1,188 @@
+/*
+Copyright (C) 1996-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+// in_null.cpp -- input, keys and menu for the builds without a window, the
+// dedicated server and the headless timedemo. Nothing is ever typed, bound or
+// shown; these only exist so the shared code links.
+
+#include "quakedef.hpp"
+#include "keys.hpp"
+#include "menu.hpp"
+#include "input.hpp"
+
+/*
+==============================================================================
+
+INPUT
+
+==============================================================================
+*/
+
+void IN_Init()
+{
+}
+
+void IN_Shutdown()
+{
+}
+
+void IN_Commands()
+{
+}
+
+void IN_UpdateInputMode()
+{
+}
+
+void IN_UpdateGrabs()
+{
+}
+
+void IN_Move(usercmd_t* cmd)
+{
+    (void)cmd;
+}
+
+/*
+==============================================================================
+
+KEYS
+
+==============================================================================
+*/
+
+char key_lines[CMDLINES][MAXCMDLINE];
+int key_linepos;
+int key_insert = true;
+double key_blinktime;
+int edit_line = 0;
+int history_line = 0;
+keydest_t key_dest;
+int key_bindmap[2] = {0, 1};
+char* keybindings[MAX_BINDMAPS][MAX_KEYS];
+bool keydown[MAX_KEYS];
+bool chat_team = false;
+
+void Key_Init()
+{
+}
+
+void History_Shutdown()
+{
+}
+
+void Key_EndChat()
+{
+}
+
+void Key_UpdateForDest()
+{
+}
+
+void Key_BeginInputGrab()
+{
+}
+
+void Key_EndInputGrab()
+{
+}
+
+void Key_GetGrabbedInput(int* lastkey, int* lastchar)
+{
+    if(lastkey)
+    {
+        *lastkey = 0;
+    }
+    if(lastchar)
+    {
+        *lastchar = 0;
+    }
+}
+
+const char* Key_GetChatBuffer()
+{
+    return "";
+}
+
+int Key_GetChatMsgLen()
+{
+    return 0;
+}
+
+const char* Key_KeynumToString(int keynum)
+{
+    (void)keynum;
+    return "<UNKNOWN KEYNUM>";
+}
+
+int Key_StringToKeynum(const char* str)
+{
+    (void)str;
+    return -1;
+}
+
+int Key_NativeToQC(int code)
+{
+    (void)code;
+    return -1;
+}
+
+int Key_QCToNative(int code)
+{
+    (void)code;
+    return -1;
+}
+
+void Key_SetBinding(int keynum, const char* binding, int bindmap)
+{
+    (void)keynum;
+    (void)binding;
+    (void)bindmap;
+}
+
+void Key_WriteBindings(FILE* f)
+{
+    (void)f;
+}
+
+/*
+==============================================================================
+
+MENU
+
+==============================================================================
+*/
+
+enum m_state_e m_state;
+enum m_state_e m_return_state;
+bool m_return_onerror;
+char m_return_reason[32];
+
+void M_Init()
+{
+}
+
+void M_Menu_Main_f()
+{
+}
+
+void M_Menu_Quit_f()
+{
+}
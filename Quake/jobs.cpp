@@ -0,0 +1,200 @@
+#include "jobs.hpp"
+
+#include "quakedef.hpp"
+#include "common.hpp"
+#include "console.hpp"
+#include "cmd.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace quake::jobs
+{
+
+namespace
+{
+
+struct Batch
+{
+    ChunkFn fn;
+    void* ctx;
+    std::size_t count;
+    std::size_t chunkSize;
+    std::size_t numChunks;
+    std::atomic<std::size_t> nextChunk;
+};
+
+struct Pool
+{
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wakeCv;
+    std::condition_variable doneCv;
+    Batch* batch{nullptr};
+    std::size_t busyWorkers{0}; // workers currently holding `batch`
+    unsigned int generation{0};
+    bool quit{false};
+};
+
+Pool pool;
+thread_local bool isWorkerThread{false};
+
+// Runs chunks of `b` until none are left to claim.
+void runChunks(Batch& b) noexcept
+{
+    for(std::size_t c; (c = b.nextChunk.fetch_add(1)) < b.numChunks;)
+    {
+        const std::size_t begin = c * b.chunkSize;
+        const std::size_t end = std::min(begin + b.chunkSize, b.count);
+        b.fn(b.ctx, begin, end);
+    }
+}
+
+void workerLoop() noexcept
+{
+    isWorkerThread = true;
+    unsigned int seenGeneration = 0;
+
+    while(true)
+    {
+        Batch* b;
+
+        {
+            std::unique_lock lock{pool.mutex};
+            pool.wakeCv.wait(lock, [&] {
+                return pool.quit || pool.generation != seenGeneration;
+            });
+
+            if(pool.quit)
+            {
+                return;
+            }
+
+            seenGeneration = pool.generation;
+            b = pool.batch;
+
+            if(b == nullptr)
+            {
+                continue;
+            }
+
+            ++pool.busyWorkers;
+        }
+
+        runChunks(*b);
+
+        {
+            std::lock_guard lock{pool.mutex};
+            --pool.busyWorkers;
+        }
+
+        pool.doneCv.notify_one();
+    }
+}
+
+void Jobs_Info_f()
+{
+    Con_Printf("%u job threads (%u workers)\n", (unsigned int)numThreads(),
+        (unsigned int)pool.workers.size());
+}
+
+} // namespace
+
+void init()
+{
+    std::size_t numWorkers =
+        std::max(std::thread::hardware_concurrency(), 1u) - 1;
+
+    const int i = COM_CheckParm("-jobthreads");
+    if(i && i < com_argc - 1)
+    {
+        // includes the main thread
+        numWorkers = std::max(Q_atoi(com_argv[i + 1]), 1) - 1;
+    }
+
+    numWorkers = std::min<std::size_t>(numWorkers, 31);
+
+    pool.workers.reserve(numWorkers);
+    for(std::size_t w = 0; w < numWorkers; ++w)
+    {
+        pool.workers.emplace_back(workerLoop);
+    }
+
+    Cmd_AddCommand("jobs_info", Jobs_Info_f);
+}
+
+void shutdown()
+{
+    {
+        std::lock_guard lock{pool.mutex};
+        pool.quit = true;
+    }
+
+    pool.wakeCv.notify_all();
+
+    for(std::thread& t : pool.workers)
+    {
+        t.join();
+    }
+
+    pool.workers.clear();
+}
+
+[[nodiscard]] std::size_t numThreads() noexcept
+{
+    return pool.workers.size() + 1;
+}
+
+void parallelForImpl(const std::size_t count, const std::size_t grainSize,
+    const ChunkFn fn, void* ctx) noexcept
+{
+    if(count == 0)
+    {
+        return;
+    }
+
+    const std::size_t grain = std::max<std::size_t>(grainSize, 1);
+
+    if(pool.workers.empty() || isWorkerThread || count <= grain)
+    {
+        fn(ctx, 0, count);
+        return;
+    }
+
+    // Aim for a few chunks per thread so uneven chunks balance out.
+    const std::size_t maxChunks = numThreads() * 4;
+    const std::size_t chunkSize =
+        std::max(grain, (count + maxChunks - 1) / maxChunks);
+
+    Batch b;
+    b.fn = fn;
+    b.ctx = ctx;
+    b.count = count;
+    b.chunkSize = chunkSize;
+    b.numChunks = (count + chunkSize - 1) / chunkSize;
+    b.nextChunk = 0;
+
+    {
+        std::lock_guard lock{pool.mutex};
+        pool.batch = &b;
+        ++pool.generation;
+    }
+
+    pool.wakeCv.notify_all();
+
+    runChunks(b);
+
+    // Every chunk has been claimed; wait for the workers still running one.
+    // Workers that wake up late must not see a dead batch.
+    {
+        std::unique_lock lock{pool.mutex};
+        pool.doneCv.wait(lock, [] { return pool.busyWorkers == 0; });
+        pool.batch = nullptr;
+    }
+}
+
+} // namespace quake::jobs
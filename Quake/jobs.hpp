@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+// Small fork/join job system: a fixed pool of worker threads that split an
+// index range into chunks. The calling thread always takes part in the work
+// and `parallelFor` only returns once every chunk has run. Calls made from a
+// worker, or when the pool has no threads, run inline on the caller.
+
+namespace quake::jobs
+{
+
+void init();
+void shutdown();
+
+// Number of threads that take part in a `parallelFor`, including the caller.
+[[nodiscard]] std::size_t numThreads() noexcept;
+
+using ChunkFn = void (*)(void* ctx, std::size_t begin, std::size_t end);
+
+void parallelForImpl(std::size_t count, std::size_t grainSize, ChunkFn fn,
+    void* ctx) noexcept;
+
+// Calls `f(begin, end)` for consecutive sub-ranges of `[0, count)`, each at
+// least `grainSize` long (except the last), possibly on several threads.
+template <typename F>
+void parallelFor(const std::size_t count, const std::size_t grainSize, F&& f)
+{
+    parallelForImpl(
+        count, grainSize,
+        [](void* ctx, const std::size_t begin, const std::size_t end) {
+            (*static_cast<std::remove_reference_t<F>*>(ctx))(begin, end);
+        },
+        &f);
+}
+
+} // namespace quake::jobs
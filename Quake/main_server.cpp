@@ -0,0 +1,121 @@
+/*
+Copyright (C) 1996-2001 Id Software, Inc.
+Copyright (C) 2002-2005 John Fitzgibbons and others
+Copyright (C) 2007-2008 Kristian Duske
+Copyright (C) 2010-2014 QuakeSpasm developers
+Copyright (C) 2020-2021 Vittorio Romeo
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+// Entry point of `quakevr-server`, the headless dedicated server. Same as
+// `main_sdl.cpp` running with `-dedicated`, without SDL.
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include "host.hpp"
+#include "quakedef.hpp"
+#include "common.hpp"
+#include "quakeparms.hpp"
+#include "sys.hpp"
+
+#define DEFAULT_MEMORY \
+    (256 * 1024 * 1024) // ericw -- was 72MB (64-bit) / 64MB (32-bit)
+
+static quakeparms_t parms;
+
+int main(int argc, char* argv[])
+{
+    int t;
+    double time;
+    double oldtime;
+    double newtime;
+
+    // `Host_FindMaxClients` reads the client count from `-dedicated`, so
+    // make sure it is always there.
+    std::vector<char*> args(argv, argv + argc);
+    static char dedicatedArg[] = "-dedicated";
+
+    if(std::none_of(args.begin(), args.end(),
+           [](const char* arg) { return !Q_strcmp(arg, "-dedicated"); }))
+    {
+        args.push_back(dedicatedArg);
+    }
+    args.push_back(nullptr);
+
+    host_parms = &parms;
+    parms.basedir = ".";
+
+    parms.argc = static_cast<int>(args.size()) - 1;
+    parms.argv = args.data();
+
+    parms.errstate = 0;
+
+    COM_InitArgv(parms.argc, parms.argv);
+
+    isDedicated = true;
+
+    Sys_Init();
+
+    parms.memsize = DEFAULT_MEMORY;
+    if(COM_CheckParm("-heapsize"))
+    {
+        t = COM_CheckParm("-heapsize") + 1;
+        if(t < com_argc)
+        {
+            parms.memsize = Q_atoi(com_argv[t]) * 1024;
+        }
+    }
+
+    parms.membase = malloc(parms.memsize);
+
+    if(!parms.membase)
+    {
+        Sys_Error("Not enough memory free; check disk space\n");
+    }
+
+    Sys_Printf("Quake %1.2f (c) id Software\n", VERSION);
+    Sys_Printf("QuakeSpasm " QUAKESPASM_VER_STRING
+               " (c) Ozkan Sezer, Eric Wasylishen & others\n");
+    Sys_Printf("QuakeSpasm-Spiked (c) Spike\n");
+    Sys_Printf("Quake VR " QUAKEVR_VERSION
+               " dedicated server by Vittorio Romeo & others\n");
+
+    Sys_Printf("Host_Init\n");
+    Host_Init();
+
+    oldtime = Sys_DoubleTime();
+    while(true)
+    {
+        newtime = Sys_DoubleTime();
+        time = newtime - oldtime;
+
+        while(time < sys_ticrate.value)
+        {
+            Sys_Sleep(1);
+            newtime = Sys_DoubleTime();
+            time = newtime - oldtime;
+        }
+
+        Host_Frame(time);
+        oldtime = newtime;
+    }
+
+    return 0;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "q_ctype.hpp"
+
+#include <cstddef>
+#include <unordered_map>
+
+// Case-insensitive hash maps keyed by NUL-terminated names, used to look up
+// cvars, commands and aliases without walking their lists. Keys are not
+// copied: they must point at a name that lives as long as the entry.
+
+namespace quake
+{
+
+struct NoCaseNameHash
+{
+    [[nodiscard]] std::size_t operator()(const char* s) const noexcept
+    {
+        std::size_t h = 2166136261u;
+        for(; *s; ++s)
+        {
+            h = (h ^ static_cast<unsigned char>(q_tolower(*s))) * 16777619u;
+        }
+        return h;
+    }
+};
+
+struct NoCaseNameEqual
+{
+    [[nodiscard]] bool operator()(const char* a, const char* b) const noexcept
+    {
+        for(; *a && q_tolower(*a) == q_tolower(*b); ++a, ++b)
+        {
+        }
+        return q_tolower(*a) == q_tolower(*b);
+    }
+};
+
+template <typename T>
+using NoCaseNameMap =
+    std::unordered_map<const char*, T, NoCaseNameHash, NoCaseNameEqual>;
+
+} // namespace quake
@@ -99,6 +99,10 @@ int NET_SendUnreliableMessage(struct qsocket_s* sock, sizebuf_t* data);
 int NET_SendToAll(sizebuf_t* data, double blocktime);
 // This is a reliable *blocking* send to all attached clients.
 
+void NET_BeginSendBatch();
+void NET_FlushSendBatch();
+// sends made in between may be queued by the lan drivers and sent together
+
 void NET_Close(struct qsocket_s* sock);
 // if a dead connection is returned by a get or send function, this function
 // should be called when it is convenient
@@ -54,13 +54,15 @@ net_landriver_t net_landrivers[] = {
         UDP_Read, UDP_Write, UDP4_Broadcast, UDP_AddrToString,
         UDP4_StringToAddr, UDP_GetSocketAddr, UDP_GetNameFromAddr,
         UDP4_GetAddrFromName, UDP_AddrCompare, UDP_GetSocketPort,
-        UDP_SetSocketPort},
+        UDP_SetSocketPort, 0, UDP_BeginSendBatch, UDP_FlushSendBatch,
+        UDP_PrintStats},
     {"UDP6", false, 0, UDP6_Init, UDP6_Shutdown, UDP6_Listen, UDP6_GetAddresses,
         UDP6_OpenSocket, UDP_CloseSocket, UDP_Connect, UDP6_CheckNewConnections,
         UDP_Read, UDP_Write, UDP6_Broadcast, UDP_AddrToString,
         UDP6_StringToAddr, UDP_GetSocketAddr, UDP_GetNameFromAddr,
         UDP6_GetAddrFromName, UDP_AddrCompare, UDP_GetSocketPort,
-        UDP_SetSocketPort}};
+        UDP_SetSocketPort, 0, UDP_BeginSendBatch, UDP_FlushSendBatch,
+        UDP_PrintStats}};
 
 const int net_numlandrivers =
     (sizeof(net_landrivers) / sizeof(net_landrivers[0]));
@@ -155,12 +155,14 @@ typedef struct qsocket_s
     unsigned int sendSequence;
     unsigned int unreliableSendSequence;
     int sendMessageLength;
-    byte sendMessage[NET_MAXMESSAGE];
+    int sendMessageSize; // allocated, see NET_ReserveMessage
+    byte* sendMessage;
 
     unsigned int receiveSequence;
     unsigned int unreliableReceiveSequence;
     int receiveMessageLength;
-    byte receiveMessage[NET_MAXMESSAGE];
+    int receiveMessageSize; // allocated, see NET_ReserveMessage
+    byte* receiveMessage;
 
     struct qsockaddr addr;
     char address[NET_NAMELEN];
@@ -178,12 +180,21 @@ typedef struct qsocket_s
     // QSS
     int pending_max_datagram; // don't change the mtu if we're resending, as
                               // that would confuse the peer.
+
+    double nextCheckTime; // virtual sockets: pending timer wheel entry
 } qsocket_t;
 
 extern qsocket_t* net_activeSockets;
 extern qsocket_t* net_freeSockets;
 extern int net_numsockets;
 
+// qsocket message buffers come from a pool and are only held while a message
+// is in flight. NET_ReserveMessage makes *buf at least `size` bytes, keeping
+// its first `used` bytes; NET_ReleaseMessage gives it back.
+void NET_ReserveMessage(byte** buf, int* bufsize, int used, int size);
+void NET_ReleaseMessage(byte** buf, int* bufsize);
+void NET_PrintMessagePoolStats();
+
 typedef struct
 {
     const char* name;
@@ -212,6 +223,11 @@ typedef struct
     int (*SetSocketPort)(struct qsockaddr* addr, int port);
 
     sys_socket_t listeningSock; // QSS
+
+    // optional, may be null: queue Writes until FlushSendBatch
+    void (*BeginSendBatch)();
+    void (*FlushSendBatch)();
+    void (*PrintStats)();
 } net_landriver_t;
 
 #define MAX_NET_DRIVERS 8
@@ -47,6 +47,11 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "server.hpp"
 #include "zone.hpp"
 
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
 // these two macros are to make the code more readable
 #define sfunc net_landrivers[sock->landriver]
 #define dfunc net_landrivers[net_landriverlevel]
@@ -180,6 +185,8 @@ static void NET_Ban_f()
 #endif // BAN_TEST
 
 
+static void ScheduleCheck(qsocket_t* sock, double time);
+
 int Datagram_SendMessage(qsocket_t* sock, sizebuf_t* data)
 {
     unsigned int packetLen;
@@ -197,6 +204,8 @@ int Datagram_SendMessage(qsocket_t* sock, sizebuf_t* data)
         Sys_Error("SendMessage: called with canSend == false\n");
 #endif
 
+    NET_ReserveMessage(
+        &sock->sendMessage, &sock->sendMessageSize, 0, data->cursize);
     Q_memcpy(sock->sendMessage, data->data, data->cursize);
     sock->sendMessageLength = data->cursize;
 
@@ -225,6 +234,11 @@ int Datagram_SendMessage(qsocket_t* sock, sizebuf_t* data)
 
     sock->canSend = false;
 
+    if(sock->isvirtual)
+    {
+        ScheduleCheck(sock, net_time + 1.0);
+    }
+
     if(sfunc.Write(
            sock->socket, (byte*)&packetBuffer, packetLen, &sock->addr) == -1)
     {
@@ -443,10 +457,12 @@ bool Datagram_ProcessPacket(unsigned int length, qsocket_t* sock)
             memmove(sock->sendMessage, sock->sendMessage + sock->max_datagram,
                 sock->sendMessageLength);
             sock->sendNext = true;
+            ScheduleCheck(sock, net_time);
         }
         else
         {
             sock->sendMessageLength = 0;
+            NET_ReleaseMessage(&sock->sendMessage, &sock->sendMessageSize);
             sock->canSend = true;
         }
         return false;
@@ -481,16 +497,20 @@ bool Datagram_ProcessPacket(unsigned int length, qsocket_t* sock)
                 &net_message, sock->receiveMessage, sock->receiveMessageLength);
             SZ_Write(&net_message, packetBuffer.data, length);
             sock->receiveMessageLength = 0;
+            NET_ReleaseMessage(
+                &sock->receiveMessage, &sock->receiveMessageSize);
 
             messagesReceived++;
             return true; // parse this reliable!
         }
 
-        if(sock->receiveMessageLength + length > sizeof(sock->receiveMessage))
+        if(sock->receiveMessageLength + length > NET_MAXMESSAGE)
         {
             Con_Printf("Over-sized reliable\n");
             return -1;
         }
+        NET_ReserveMessage(&sock->receiveMessage, &sock->receiveMessageSize,
+            sock->receiveMessageLength, sock->receiveMessageLength + length);
         Q_memcpy(sock->receiveMessage + sock->receiveMessageLength,
             packetBuffer.data, length);
         sock->receiveMessageLength += length;
@@ -501,6 +521,212 @@ bool Datagram_ProcessPacket(unsigned int length, qsocket_t* sock)
     return false;
 }
 
+/*
+===============================================================================
+
+VIRTUAL SOCKET LOOKUP
+
+Every client of a listening server shares the listening socket, so incoming
+packets are matched to their qsocket by address. `virtualSockets` maps an
+address hash to the virtual qsockets, so a packet costs the same however
+many clients there are. The map is rebuilt after a connection is accepted;
+sockets that were closed since stay in it until then, so entries are still
+checked like the list walk used to.
+
+Resends, queued fragments and timeouts are driven by a timer wheel: each
+virtual socket has one pending entry for the earliest time it might need
+any of them. Entries are only hints, RunTimerWheel checks the real
+conditions and schedules the next one.
+
+===============================================================================
+*/
+
+static std::unordered_multimap<std::uint32_t, qsocket_t*> virtualSockets;
+static bool virtualSocketsDirty = true;
+
+#define WHEEL_TICK 0.05 // seconds per slot
+#define WHEEL_SLOTS 64  // power of two
+
+struct wheelentry_t
+{
+    qsocket_t* sock;
+    double time;
+};
+
+static std::vector<wheelentry_t> timerWheel[WHEEL_SLOTS];
+static std::vector<wheelentry_t> timerWheelDue;
+static long long timerWheelTick = -1; // last tick that was fully processed
+
+[[nodiscard]] static std::uint32_t Datagram_AddrHash(const qsockaddr* addr)
+{
+    std::uint32_t h = 2166136261u;
+
+    const auto mix = [&h](const void* data, const std::size_t size) {
+        const auto* bytes = static_cast<const unsigned char*>(data);
+        for(std::size_t i = 0; i < size; ++i)
+        {
+            h = (h ^ bytes[i]) * 16777619u;
+        }
+    };
+
+    const int family = addr->qsa_family;
+    mix(&family, sizeof(family));
+
+    // only the fields AddrCompare looks at, the rest may be garbage
+    if(family == AF_INET)
+    {
+        const auto* in = reinterpret_cast<const sockaddr_in*>(addr);
+        mix(&in->sin_addr, sizeof(in->sin_addr));
+        mix(&in->sin_port, sizeof(in->sin_port));
+    }
+#ifdef AF_INET6
+    else if(family == AF_INET6)
+    {
+        const auto* in6 = reinterpret_cast<const sockaddr_in6*>(addr);
+        mix(&in6->sin6_addr, sizeof(in6->sin6_addr));
+        mix(&in6->sin6_port, sizeof(in6->sin6_port));
+    }
+#endif
+
+    return h;
+}
+
+static void RebuildVirtualSockets()
+{
+    virtualSockets.clear();
+
+    for(qsocket_t* s = net_activeSockets; s; s = s->next)
+    {
+        if(s->isvirtual)
+        {
+            virtualSockets.emplace(Datagram_AddrHash(&s->addr), s);
+        }
+    }
+
+    virtualSocketsDirty = false;
+}
+
+[[nodiscard]] static long long WheelTick(const double time)
+{
+    return (long long)(time / WHEEL_TICK);
+}
+
+// Makes sure the timer wheel looks at `sock` no later than `time`.
+static void ScheduleCheck(qsocket_t* sock, const double time)
+{
+    if(sock->nextCheckTime != 0 && sock->nextCheckTime <= time)
+    {
+        return;
+    }
+
+    sock->nextCheckTime = time;
+    timerWheel[WheelTick(time) & (WHEEL_SLOTS - 1)].push_back({sock, time});
+}
+
+static void CheckVirtualSocket(qsocket_t* s)
+{
+    if(!s->canSend)
+    {
+        if((net_time - s->lastSendTime) > 1.0)
+        {
+            ReSendMessage(s);
+        }
+    }
+    if(s->sendNext)
+    {
+        SendMessageNext(s);
+    }
+
+    const double timeout =
+        (!s->ackSequence) ? net_connecttimeout.value : net_messagetimeout.value;
+
+    if(net_time - s->lastMessageTime > timeout)
+    { // timed out, kick them
+        // FIXME: add a proper challenge rather than assuming spoofers won't
+        // fake acks
+        int i;
+        for(i = 0; i < svs.maxclients; i++)
+        {
+            if(svs.clients[i].netconnection == s)
+            {
+                host_client = &svs.clients[i];
+                SV_DropClient(false);
+                break;
+            }
+        }
+    }
+
+    if(!s->isvirtual || s->disconnected)
+    {
+        return; // dropped
+    }
+
+    // earliest time any of the above can happen again
+    double next = s->lastMessageTime + timeout;
+    if(!s->canSend)
+    {
+        next = q_min(next, s->lastSendTime + 1.0);
+    }
+    if(s->sendNext)
+    {
+        next = net_time;
+    }
+
+    s->nextCheckTime = 0;
+    ScheduleCheck(s, q_max(next, net_time + WHEEL_TICK));
+}
+
+static void RunTimerWheel()
+{
+    const long long now = WheelTick(net_time);
+
+    if(timerWheelTick < 0 || now - timerWheelTick > WHEEL_SLOTS)
+    {
+        timerWheelTick = now - WHEEL_SLOTS;
+    }
+
+    // the current tick is only partly due, it gets visited again next time
+    timerWheelDue.clear();
+    for(long long tick = timerWheelTick + 1; tick <= now; ++tick)
+    {
+        std::vector<wheelentry_t>& slot = timerWheel[tick & (WHEEL_SLOTS - 1)];
+
+        auto keep = slot.begin();
+        for(const wheelentry_t& e : slot)
+        {
+            if(e.time > net_time)
+            {
+                *keep++ = e; // a later lap, or later in this tick
+            }
+            else if(e.sock->nextCheckTime == e.time)
+            {
+                timerWheelDue.push_back(e);
+            }
+        }
+        slot.erase(keep, slot.end());
+    }
+    timerWheelTick = now - 1;
+
+    for(const wheelentry_t& e : timerWheelDue)
+    {
+        qsocket_t* s = e.sock;
+
+        if(!s->isvirtual || s->disconnected || s->nextCheckTime != e.time)
+        {
+            continue;
+        }
+
+        if(s->driver != net_driverlevel)
+        {
+            s->nextCheckTime = 0;
+            ScheduleCheck(s, net_time + WHEEL_TICK);
+            continue;
+        }
+
+        CheckVirtualSocket(s);
+    }
+}
+
 qsocket_t* Datagram_GetAnyMessage()
 {
     qsocket_t* s;
@@ -542,8 +768,16 @@ qsocket_t* Datagram_GetAnyMessage()
             }
 
             // figure out which qsocket it was for
-            for(s = net_activeSockets; s; s = s->next)
+            if(virtualSocketsDirty)
             {
+                RebuildVirtualSockets();
+            }
+
+            const auto range =
+                virtualSockets.equal_range(Datagram_AddrHash(&addr));
+            for(auto it = range.first; it != range.second; ++it)
+            {
+                s = it->second;
                 if(s->driver != net_driverlevel)
                 {
                     continue;
@@ -570,47 +804,8 @@ qsocket_t* Datagram_GetAnyMessage()
             // stray packet... ignore it and just try the next
         }
     }
-    for(s = net_activeSockets; s; s = s->next)
-    {
-        if(s->driver != net_driverlevel)
-        {
-            continue;
-        }
-        if(!s->isvirtual)
-        {
-            continue;
-        }
 
-        if(!s->canSend)
-        {
-            if((net_time - s->lastSendTime) > 1.0)
-            {
-                ReSendMessage(s);
-            }
-        }
-        if(s->sendNext)
-        {
-            SendMessageNext(s);
-        }
-
-        if(net_time - s->lastMessageTime > ((!s->ackSequence)
-                                                   ? net_connecttimeout.value
-                                                   : net_messagetimeout.value))
-        { // timed out, kick them
-            // FIXME: add a proper challenge rather than assuming spoofers won't
-            // fake acks
-            int i;
-            for(i = 0; i < svs.maxclients; i++)
-            {
-                if(svs.clients[i].netconnection == s)
-                {
-                    host_client = &svs.clients[i];
-                    SV_DropClient(false);
-                    break;
-                }
-            }
-        }
-    }
+    RunTimerWheel();
 
     return nullptr;
 }
@@ -736,6 +931,7 @@ int Datagram_GetMessage(qsocket_t* sock)
             else
             {
                 sock->sendMessageLength = 0;
+                NET_ReleaseMessage(&sock->sendMessage, &sock->sendMessageSize);
                 sock->canSend = true;
             }
             continue;
@@ -772,19 +968,23 @@ int Datagram_GetMessage(qsocket_t* sock)
                     sock->receiveMessageLength);
                 SZ_Write(&net_message, packetBuffer.data, length);
                 sock->receiveMessageLength = 0;
+                NET_ReleaseMessage(
+                    &sock->receiveMessage, &sock->receiveMessageSize);
 
                 ret = 1;
                 break;
             }
 
             // QSS
-            if(sock->receiveMessageLength + length >
-                sizeof(sock->receiveMessage))
+            if(sock->receiveMessageLength + length > NET_MAXMESSAGE)
             {
                 Con_Printf("Over-sized reliable\n");
                 return -1;
             }
 
+            NET_ReserveMessage(&sock->receiveMessage,
+                &sock->receiveMessageSize, sock->receiveMessageLength,
+                sock->receiveMessageLength + length);
             Q_memcpy(sock->receiveMessage + sock->receiveMessageLength,
                 packetBuffer.data, length);
             sock->receiveMessageLength += length;
@@ -826,6 +1026,20 @@ static void NET_Stats_f()
         Con_Printf("receivedDuplicateCount     = %i\n", receivedDuplicateCount);
         Con_Printf("shortPacketCount           = %i\n", shortPacketCount);
         Con_Printf("droppedDatagrams           = %i\n", droppedDatagrams);
+
+        NET_PrintMessagePoolStats();
+
+        void (*printed)() = nullptr;
+        for(int i = 0; i < net_numlandrivers; i++)
+        {
+            // the UDP drivers share theirs
+            if(net_landrivers[i].initialized && net_landrivers[i].PrintStats &&
+                net_landrivers[i].PrintStats != printed)
+            {
+                printed = net_landrivers[i].PrintStats;
+                printed();
+            }
+        }
     }
     else if(Q_strcmp(Cmd_Argv(1), "*") == 0)
     {
@@ -1301,6 +1515,30 @@ void Datagram_Shutdown()
 }
 
 
+void Datagram_BeginSendBatch()
+{
+    for(int i = 0; i < net_numlandrivers; i++)
+    {
+        if(net_landrivers[i].initialized && net_landrivers[i].BeginSendBatch)
+        {
+            net_landrivers[i].BeginSendBatch();
+        }
+    }
+}
+
+
+void Datagram_FlushSendBatch()
+{
+    for(int i = 0; i < net_numlandrivers; i++)
+    {
+        if(net_landrivers[i].initialized && net_landrivers[i].FlushSendBatch)
+        {
+            net_landrivers[i].FlushSendBatch();
+        }
+    }
+}
+
+
 void Datagram_Close(qsocket_t* sock)
 {
     // QSS
@@ -1873,6 +2111,9 @@ static void _Datagram_ServerControlPacket(sys_socket_t acceptsock,
     sock->socket = acceptsock;
     sock->landriver = net_landriverlevel;
     sock->addr = *clientaddr;
+    sock->nextCheckTime = 0;
+    ScheduleCheck(sock, net_time);
+    virtualSocketsDirty = true;
     Q_strcpy(sock->trueaddress, dfunc.AddrToString(clientaddr, false));
     Q_strcpy(sock->maskedaddress, dfunc.AddrToString(clientaddr, true));
 
@@ -32,6 +32,8 @@ qsocket_t* Datagram_GetAnyMessage(); // QSS
 int Datagram_GetMessage(qsocket_t* sock);
 int Datagram_SendMessage(qsocket_t* sock, sizebuf_t* data);
 int Datagram_SendUnreliableMessage(qsocket_t* sock, sizebuf_t* data);
+void Datagram_BeginSendBatch();
+void Datagram_FlushSendBatch();
 bool Datagram_CanSendMessage(qsocket_t* sock);
 bool Datagram_CanSendUnreliableMessage(qsocket_t* sock);
 void Datagram_Close(qsocket_t* sock);
@@ -194,6 +194,10 @@ int Loop_GetMessage(qsocket_t* sock)
         memmove(sock->receiveMessage, &sock->receiveMessage[length],
             sock->receiveMessageLength);
     }
+    else
+    {
+        NET_ReleaseMessage(&sock->receiveMessage, &sock->receiveMessageSize);
+    }
 
     if(sock->driverdata && ret == 1)
     {
@@ -234,7 +238,10 @@ int Loop_SendMessage(qsocket_t* sock, sizebuf_t* data)
         Sys_Error("Loop_SendMessage: overflow");
     }
 
-    buffer = ((qsocket_t*)sock->driverdata)->receiveMessage + *bufferLength;
+    qsocket_t* peer = (qsocket_t*)sock->driverdata;
+    NET_ReserveMessage(&peer->receiveMessage, &peer->receiveMessageSize,
+        *bufferLength, IntAlign(*bufferLength + data->cursize + 4));
+    buffer = peer->receiveMessage + *bufferLength;
 
     // message type
     *buffer++ = 1;
@@ -274,7 +281,10 @@ int Loop_SendUnreliableMessage(qsocket_t* sock, sizebuf_t* data)
         return 0;
     }
 
-    buffer = ((qsocket_t*)sock->driverdata)->receiveMessage + *bufferLength;
+    qsocket_t* peer = (qsocket_t*)sock->driverdata;
+    NET_ReserveMessage(&peer->receiveMessage, &peer->receiveMessageSize,
+        *bufferLength, IntAlign(*bufferLength + data->cursize + 8));
+    buffer = peer->receiveMessage + *bufferLength;
 
     // message type
     *buffer++ = 2;
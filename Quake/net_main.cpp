@@ -32,6 +32,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "server.hpp"
 #include "sys.hpp"
 #include "client.hpp"
+#include "net_dgrm.hpp"
 
 qsocket_t* net_activeSockets = nullptr;
 qsocket_t* net_freeSockets = nullptr;
@@ -97,6 +98,158 @@ double SetNetTime()
 }
 
 
+/*
+===================
+Message buffer pool
+
+Reliable messages are rarely anywhere near NET_MAXMESSAGE, so the buffers
+come in power of two sizes from 1 KiB and are kept on a free list per size
+once released. Bigger than the largest class falls back to plain malloc.
+===================
+*/
+#define MSGPOOL_MINSHIFT 10 // 1 KiB
+#define MSGPOOL_CLASSES 8   // up to 128 KiB
+
+struct msgpoolblock_t
+{
+    msgpoolblock_t* next;
+};
+
+static struct
+{
+    msgpoolblock_t* free[MSGPOOL_CLASSES];
+    int numfree[MSGPOOL_CLASSES];
+    int numused[MSGPOOL_CLASSES];
+    int numoversized;
+    size_t oversizedbytes;
+} msgpool;
+
+static int NET_MessageClass(const int size)
+{
+    int c = 0;
+    while(c < MSGPOOL_CLASSES && (1 << (MSGPOOL_MINSHIFT + c)) < size)
+    {
+        ++c;
+    }
+    return c; // MSGPOOL_CLASSES if oversized
+}
+
+void NET_ReleaseMessage(byte** buf, int* bufsize)
+{
+    if(!*buf)
+    {
+        return;
+    }
+
+    const int c = NET_MessageClass(*bufsize);
+    if(c == MSGPOOL_CLASSES)
+    {
+        msgpool.numoversized--;
+        msgpool.oversizedbytes -= *bufsize;
+        free(*buf);
+    }
+    else
+    {
+        auto* block = (msgpoolblock_t*)*buf;
+        block->next = msgpool.free[c];
+        msgpool.free[c] = block;
+        msgpool.numfree[c]++;
+        msgpool.numused[c]--;
+    }
+
+    *buf = nullptr;
+    *bufsize = 0;
+}
+
+void NET_ReserveMessage(byte** buf, int* bufsize, int used, int size)
+{
+    if(size <= *bufsize)
+    {
+        return;
+    }
+
+    const int c = NET_MessageClass(size);
+
+    byte* newbuf;
+    int newsize;
+    if(c == MSGPOOL_CLASSES)
+    {
+        newsize = size;
+        newbuf = (byte*)malloc(newsize);
+        if(!newbuf)
+        {
+            Sys_Error("NET_ReserveMessage: failed on allocation of %i bytes",
+                newsize);
+        }
+        msgpool.numoversized++;
+        msgpool.oversizedbytes += newsize;
+    }
+    else
+    {
+        newsize = 1 << (MSGPOOL_MINSHIFT + c);
+        if(msgpool.free[c])
+        {
+            newbuf = (byte*)msgpool.free[c];
+            msgpool.free[c] = msgpool.free[c]->next;
+            msgpool.numfree[c]--;
+        }
+        else
+        {
+            newbuf = (byte*)malloc(newsize);
+            if(!newbuf)
+            {
+                Sys_Error(
+                    "NET_ReserveMessage: failed on allocation of %i bytes",
+                    newsize);
+            }
+        }
+        msgpool.numused[c]++;
+    }
+
+    if(used > 0)
+    {
+        memcpy(newbuf, *buf, used);
+    }
+
+    NET_ReleaseMessage(buf, bufsize);
+    *buf = newbuf;
+    *bufsize = newsize;
+}
+
+void NET_PrintMessagePoolStats()
+{
+    size_t usedbytes = msgpool.oversizedbytes;
+    size_t freebytes = 0;
+
+    for(int c = 0; c < MSGPOOL_CLASSES; c++)
+    {
+        const size_t size = (size_t)1 << (MSGPOOL_MINSHIFT + c);
+        usedbytes += msgpool.numused[c] * size;
+        freebytes += msgpool.numfree[c] * size;
+    }
+
+    Con_Printf("qsockets                   = %i x %u bytes\n", net_numsockets,
+        (unsigned int)sizeof(qsocket_t));
+    Con_Printf("message buffers            = %u KiB used, %u KiB free\n",
+        (unsigned int)(usedbytes / 1024), (unsigned int)(freebytes / 1024));
+
+    for(int c = 0; c < MSGPOOL_CLASSES; c++)
+    {
+        if(msgpool.numused[c] || msgpool.numfree[c])
+        {
+            Con_Printf("  %6u bytes               = %i used, %i free\n",
+                1u << (MSGPOOL_MINSHIFT + c), msgpool.numused[c],
+                msgpool.numfree[c]);
+        }
+    }
+
+    if(msgpool.numoversized)
+    {
+        Con_Printf("  oversized                  = %i used\n",
+            msgpool.numoversized);
+    }
+}
+
 /*
 ===================
 NET_NewQSocket
@@ -178,6 +331,9 @@ void NET_FreeQSocket(qsocket_t* sock)
         }
     }
 
+    NET_ReleaseMessage(&sock->sendMessage, &sock->sendMessageSize);
+    NET_ReleaseMessage(&sock->receiveMessage, &sock->receiveMessageSize);
+
     // add it to free list
     sock->next = net_freeSockets;
     net_freeSockets = sock;
@@ -663,6 +819,24 @@ qsocket_t* NET_CheckNewConnections()
     return nullptr;
 }
 
+/*
+===================
+NET_BeginSendBatch / NET_FlushSendBatch
+
+Let the lan drivers queue the datagrams sent in between and send them
+together, see UDP_BeginSendBatch.
+===================
+*/
+void NET_BeginSendBatch()
+{
+    Datagram_BeginSendBatch();
+}
+
+void NET_FlushSendBatch()
+{
+    Datagram_FlushSendBatch();
+}
+
 /*
 ===================
 NET_Close
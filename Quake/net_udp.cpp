@@ -31,6 +31,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "sys.hpp"
 
 #include <cstring>
+#include <vector>
 
 // QSS
 
@@ -200,8 +201,12 @@ ErrorReturn:
 
 //=============================================================================
 
+static void UDP_ForgetSocket(sys_socket_t socketid);
+
 int UDP_CloseSocket(sys_socket_t socketid)
 {
+    UDP_ForgetSocket(socketid);
+
     if(socketid == net_broadcastsocket4)
     {
         net_broadcastsocket4 = INVALID_SOCKET;
@@ -314,12 +319,278 @@ sys_socket_t UDP4_CheckNewConnections()
 
 //=============================================================================
 
+/*
+===============================================================================
+
+BATCHED I/O
+
+On Linux the accept sockets are drained with recvmmsg into a small ring that
+UDP_Read then serves packets from, and between UDP_BeginSendBatch and
+UDP_FlushSendBatch, UDP_Write only queues its packet so that the server can
+send a whole frame of client datagrams with a few sendmmsg calls. Other
+platforms keep one syscall per packet.
+
+===============================================================================
+*/
+
+#if defined(__linux__)
+#define UDP_BATCHED_IO 1
+#else
+#define UDP_BATCHED_IO 0
+#endif
+
+#define UDP_BATCH 32
+#define UDP_MAXPACKET 65536
+
+// shown by net_stats
+static struct
+{
+    unsigned long long recvCalls;
+    unsigned long long recvPackets;
+    unsigned long long sendCalls;
+    unsigned long long sendPackets;
+} udpstats;
+
+#if UDP_BATCHED_IO
+struct udprecvring_t
+{
+    sys_socket_t socketid = INVALID_SOCKET;
+    int count = 0;
+    int next = 0;
+    std::vector<byte> data; // UDP_BATCH packets of UDP_MAXPACKET bytes
+    mmsghdr msgs[UDP_BATCH];
+    iovec iovs[UDP_BATCH];
+    qsockaddr addrs[UDP_BATCH];
+};
+
+struct udpsendbatch_t
+{
+    bool active = false;
+    sys_socket_t socketid = INVALID_SOCKET;
+    int count = 0;
+    std::vector<byte> data;
+    std::size_t offsets[UDP_BATCH];
+    mmsghdr msgs[UDP_BATCH];
+    iovec iovs[UDP_BATCH];
+    qsockaddr addrs[UDP_BATCH];
+};
+
+static udprecvring_t udp_recvrings[2]; // net_acceptsocket4, net_acceptsocket6
+static udpsendbatch_t udp_sendbatch;
+
+static void UDP_PrintWriteError(int err, struct qsockaddr* addr)
+{
+    if(err == ENETUNREACH)
+    {
+        Con_SafePrintf("UDP_Write: %s (%s)\n", socketerror(err),
+            UDP_AddrToString(addr, false));
+    }
+    else
+    {
+        Con_SafePrintf("UDP_Write, sendmmsg: %s\n", socketerror(err));
+    }
+}
+
+static void UDP_FlushQueuedWrites()
+{
+    udpsendbatch_t& b = udp_sendbatch;
+
+    // `data` may have moved while the batch was filled
+    for(int i = 0; i < b.count; i++)
+    {
+        b.iovs[i].iov_base = b.data.data() + b.offsets[i];
+        b.msgs[i].msg_hdr.msg_iov = &b.iovs[i];
+        b.msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    for(int sent = 0; sent < b.count;)
+    {
+        const int ret =
+            sendmmsg(b.socketid, b.msgs + sent, b.count - sent, MSG_DONTWAIT);
+        ++udpstats.sendCalls;
+
+        if(ret == SOCKET_ERROR)
+        {
+            const int err = SOCKETERRNO;
+            if(err == NET_EWOULDBLOCK)
+            {
+                break; // same as a dropped packet
+            }
+
+            // skip the packet that failed and carry on with the others
+            UDP_PrintWriteError(err, &b.addrs[sent]);
+            ++sent;
+            continue;
+        }
+
+        udpstats.sendPackets += ret;
+        sent += ret;
+    }
+
+    b.count = 0;
+    b.data.clear();
+}
+
+static void UDP_QueueWrite(sys_socket_t socketid, byte* buf, int len,
+    struct qsockaddr* addr, socklen_t addrsize)
+{
+    udpsendbatch_t& b = udp_sendbatch;
+
+    if(b.count == UDP_BATCH || (b.count && b.socketid != socketid))
+    {
+        UDP_FlushQueuedWrites();
+    }
+
+    const int i = b.count++;
+    b.socketid = socketid;
+    b.offsets[i] = b.data.size();
+    b.data.insert(b.data.end(), buf, buf + len);
+    b.addrs[i] = *addr;
+    b.iovs[i].iov_len = len;
+
+    msghdr& hdr = b.msgs[i].msg_hdr;
+    hdr = {};
+    hdr.msg_name = &b.addrs[i];
+    hdr.msg_namelen = addrsize;
+}
+
+static int UDP_ReadBatched(udprecvring_t& ring, sys_socket_t socketid,
+    byte* buf, int len, struct qsockaddr* addr)
+{
+    if(ring.socketid != socketid)
+    {
+        ring.socketid = socketid;
+        ring.count = ring.next = 0;
+    }
+
+    if(ring.next == ring.count)
+    {
+        if(ring.data.empty())
+        {
+            ring.data.resize(UDP_BATCH * UDP_MAXPACKET);
+        }
+
+        for(int i = 0; i < UDP_BATCH; i++)
+        {
+            ring.iovs[i].iov_base = ring.data.data() + i * UDP_MAXPACKET;
+            ring.iovs[i].iov_len = UDP_MAXPACKET;
+
+            msghdr& hdr = ring.msgs[i].msg_hdr;
+            hdr = {};
+            hdr.msg_name = &ring.addrs[i];
+            hdr.msg_namelen = sizeof(struct qsockaddr);
+            hdr.msg_iov = &ring.iovs[i];
+            hdr.msg_iovlen = 1;
+        }
+
+        const int ret =
+            recvmmsg(socketid, ring.msgs, UDP_BATCH, MSG_DONTWAIT, nullptr);
+        ++udpstats.recvCalls;
+
+        ring.count = ring.next = 0;
+
+        if(ret == SOCKET_ERROR)
+        {
+            int err = SOCKETERRNO;
+            if(err == NET_EWOULDBLOCK || err == NET_ECONNREFUSED)
+            {
+                return 0;
+            }
+            Con_SafePrintf("UDP_Read, recvmmsg: %s\n", socketerror(err));
+            return -1;
+        }
+
+        ring.count = ret;
+        udpstats.recvPackets += ret;
+
+        if(ring.count == 0)
+        {
+            return 0;
+        }
+    }
+
+    const int i = ring.next++;
+
+    // recvfrom would have truncated the same way
+    const int size = q_min((int)ring.msgs[i].msg_len, len);
+    memcpy(buf, ring.data.data() + i * UDP_MAXPACKET, size);
+    memcpy(addr, &ring.addrs[i], sizeof(struct qsockaddr));
+    return size;
+}
+#endif
+
+static void UDP_ForgetSocket(sys_socket_t socketid)
+{
+#if UDP_BATCHED_IO
+    if(udp_sendbatch.count && udp_sendbatch.socketid == socketid)
+    {
+        UDP_FlushQueuedWrites();
+    }
+
+    for(udprecvring_t& ring : udp_recvrings)
+    {
+        if(ring.socketid == socketid)
+        {
+            ring.socketid = INVALID_SOCKET;
+            ring.count = ring.next = 0;
+        }
+    }
+#else
+    (void)socketid;
+#endif
+}
+
+void UDP_BeginSendBatch()
+{
+#if UDP_BATCHED_IO
+    udp_sendbatch.active = true;
+#endif
+}
+
+void UDP_FlushSendBatch()
+{
+#if UDP_BATCHED_IO
+    if(udp_sendbatch.count)
+    {
+        UDP_FlushQueuedWrites();
+    }
+    udp_sendbatch.active = false;
+#endif
+}
+
+void UDP_PrintStats()
+{
+    Con_Printf("UDP (%s I/O):\n", UDP_BATCHED_IO ? "batched" : "unbatched");
+    Con_Printf("  recv syscalls              = %llu\n", udpstats.recvCalls);
+    Con_Printf("  recv packets               = %llu\n", udpstats.recvPackets);
+    Con_Printf("  send syscalls              = %llu\n", udpstats.sendCalls);
+    Con_Printf("  send packets               = %llu\n", udpstats.sendPackets);
+}
+
+//=============================================================================
+
 int UDP_Read(sys_socket_t socketid, byte* buf, int len, struct qsockaddr* addr)
 {
+#if UDP_BATCHED_IO
+    if(socketid == net_acceptsocket4)
+    {
+        return UDP_ReadBatched(udp_recvrings[0], socketid, buf, len, addr);
+    }
+    if(socketid == net_acceptsocket6)
+    {
+        return UDP_ReadBatched(udp_recvrings[1], socketid, buf, len, addr);
+    }
+#endif
+
     socklen_t addrlen = sizeof(struct qsockaddr);
     int ret;
 
     ret = recvfrom(socketid, buf, len, 0, (struct sockaddr*)addr, &addrlen);
+    ++udpstats.recvCalls;
+    if(ret > 0)
+    {
+        ++udpstats.recvPackets;
+    }
     if(ret == SOCKET_ERROR)
     {
         int err = SOCKETERRNO;
@@ -395,7 +666,20 @@ int UDP_Write(sys_socket_t socketid, byte* buf, int len, struct qsockaddr* addr)
                    // doesn't exactly match the address family
     }
 
+#if UDP_BATCHED_IO
+    if(udp_sendbatch.active && len <= UDP_MAXPACKET)
+    {
+        UDP_QueueWrite(socketid, buf, len, addr, addrsize);
+        return len;
+    }
+#endif
+
     ret = sendto(socketid, buf, len, 0, (struct sockaddr*)addr, addrsize);
+    ++udpstats.sendCalls;
+    if(ret > 0)
+    {
+        ++udpstats.sendPackets;
+    }
     if(!addr->qsa_family)
     {
         Con_SafePrintf("UDP_Write: family was cleared\n");
@@ -65,4 +65,9 @@ int UDP_AddrCompare(struct qsockaddr* addr1, struct qsockaddr* addr2);
 int UDP_GetSocketPort(struct qsockaddr* addr);
 int UDP_SetSocketPort(struct qsockaddr* addr, int port);
 int UDP6_GetAddresses(qhostaddr_t* addresses, int maxaddresses);
+
+// batched I/O (recvmmsg/sendmmsg on Linux), shared by UDP and UDP6
+void UDP_BeginSendBatch();
+void UDP_FlushSendBatch();
+void UDP_PrintStats();
 // ---
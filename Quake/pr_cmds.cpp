@@ -42,7 +42,9 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "q_sound.hpp"
 #include "progs_utils.hpp"
 
+#include <algorithm>
 #include <cmath>
+#include <functional>
 #include <glm/gtx/rotate_vector.hpp>
 #include "quakeglm_qquat.hpp"
 
@@ -1440,6 +1442,10 @@ static void PF_redirectvector()
     returnVector(quake::util::redirectVector(input, exemplar));
 }
 
+// 1 scans every edict like the original findradius: slower, but also finds
+// entities whose origin was changed without calling setorigin
+cvar_t sv_findradius_compat = {"sv_findradius_compat", "0", CVAR_NONE};
+
 /*
 =================
 PF_findradius
@@ -1456,17 +1462,15 @@ static void PF_findradius()
     const auto org = extractVector(OFS_PARM0);
     float rad = G_FLOAT(OFS_PARM1);
 
-    edict_t* ent = NEXT_EDICT(qcvm->edicts);
-    for(int i = 1; i < qcvm->num_edicts; i++, ent = NEXT_EDICT(ent))
-    {
+    const auto tryChain = [&](edict_t* ent) {
         if(ent->free)
         {
-            continue;
+            return;
         }
 
         if(ent->v.solid == SOLID_NOT)
         {
-            continue;
+            return;
         }
 
         qvec3 eorg;
@@ -1478,13 +1482,47 @@ static void PF_findradius()
 
         if(glm::length(eorg) > rad)
         {
-            continue;
+            return;
         }
 
         ent->v.chain = EDICT_TO_PROG(chain);
         chain = ent;
+    };
+
+    // `!(rad >= 0)` also catches NaN, which the length test lets through
+    if(sv_findradius_compat.value || !(rad >= 0.f))
+    {
+        edict_t* ent = NEXT_EDICT(qcvm->edicts);
+        for(int i = 1; i < qcvm->num_edicts; i++, ent = NEXT_EDICT(ent))
+        {
+            tryChain(ent);
+        }
+
+        RETURN_EDICT(chain);
+        return;
     }
 
+    // The center of a linked entity is always inside its absmin/absmax, so
+    // every match is found by querying the area nodes with the sphere's box.
+    const int mark = Hunk_LowMark();
+
+    edict_t** list = (edict_t**)Hunk_Alloc(qcvm->num_edicts * sizeof(edict_t*));
+
+    const qvec3 radVec{rad, rad, rad};
+    const int listcount =
+        SV_AreaEdicts(org - radVec, org + radVec, list, qcvm->num_edicts);
+
+    // Edicts are contiguous, so sorting by address gives the same chain order
+    // as the linear scan.
+    std::sort(list, list + listcount, std::less<edict_t*>{});
+
+    for(int i = 0; i < listcount; i++)
+    {
+        tryChain(list[i]);
+    }
+
+    Hunk_FreeToLowMark(mark);
+
     RETURN_EDICT(chain);
 }
 
@@ -1554,6 +1592,24 @@ static void PF_Find()
         PR_RunError("PF_Find: bad search string");
     }
 
+    int count;
+    if(const int* nums = PR_FieldIndexFind(f, s, &count))
+    {
+        for(const int* it = std::upper_bound(nums, nums + count, e);
+            it != nums + count; ++it)
+        {
+            edict_t* ed = EDICT_NUM(*it);
+            if(!ed->free && !strcmp(E_STRING(ed, f), s))
+            {
+                RETURN_EDICT(ed);
+                return;
+            }
+        }
+
+        RETURN_EDICT(qcvm->edicts);
+        return;
+    }
+
     const char* t;
     edict_t* ed;
     for(e++; e < qcvm->num_edicts; e++)
@@ -36,7 +36,12 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "world.hpp"
 #include "qcvm.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 int type_size[8] = {
     1, // ev_void
@@ -63,6 +68,212 @@ cvar_t saved1 = {"saved1", "0", CVAR_ARCHIVE};
 cvar_t saved2 = {"saved2", "0", CVAR_ARCHIVE};
 cvar_t saved3 = {"saved3", "0", CVAR_ARCHIVE};
 cvar_t saved4 = {"saved4", "0", CVAR_ARCHIVE};
+cvar_t pr_findindex = {"pr_findindex", "0", CVAR_NONE};
+extern cvar_t pr_predecode; // pr_exec.cpp
+
+/*
+===============================================================================
+
+FIELD INDEX
+
+Opt-in index (pr_findindex 1) of the string fields that `find` is usually
+called with. Every indexed field maps a value to the sorted numbers of the
+edicts holding it. Writes only mark the edict as dirty, and dirty edicts are
+reindexed on the next lookup, so string stores in the VM stay cheap.
+
+===============================================================================
+*/
+
+struct pr_fieldindex_t
+{
+    struct Field
+    {
+        int ofs; // in floats, like E_STRING
+        std::unordered_map<std::string, std::vector<int>> edictsByValue;
+        std::vector<const std::string*> keyOf; // per edict, null if absent
+    };
+
+    Field fields[3];
+    std::vector<int> dirty;
+    std::vector<bool> isDirty; // per edict
+};
+
+static void PR_FieldIndexRemove(pr_fieldindex_t::Field& field, const int num)
+{
+    const std::string* key = field.keyOf[num];
+    if(!key)
+    {
+        return;
+    }
+
+    field.keyOf[num] = nullptr;
+
+    const auto it = field.edictsByValue.find(*key);
+    std::vector<int>& nums = it->second;
+    nums.erase(std::lower_bound(nums.begin(), nums.end(), num));
+
+    if(nums.empty())
+    {
+        field.edictsByValue.erase(it);
+    }
+}
+
+static void PR_FieldIndexInsert(
+    pr_fieldindex_t::Field& field, const int num, edict_t* ed)
+{
+    const auto it =
+        field.edictsByValue.try_emplace(E_STRING(ed, field.ofs)).first;
+
+    std::vector<int>& nums = it->second;
+    nums.insert(std::upper_bound(nums.begin(), nums.end(), num), num);
+
+    field.keyOf[num] = &it->first;
+}
+
+static void PR_FieldIndexUpdate(pr_fieldindex_t& index, const int num)
+{
+    const bool present = num < qcvm->num_edicts && !EDICT_NUM(num)->free;
+
+    for(pr_fieldindex_t::Field& field : index.fields)
+    {
+        PR_FieldIndexRemove(field, num);
+
+        if(present)
+        {
+            PR_FieldIndexInsert(field, num, EDICT_NUM(num));
+        }
+    }
+}
+
+/*
+=================
+PR_FieldIndexTouchNum
+
+Must be called whenever an indexed field of edict `num` may have changed.
+=================
+*/
+static void PR_FieldIndexTouchNum(const int num)
+{
+    pr_fieldindex_t* index = qcvm->fieldindex;
+
+    // the world is never returned by find
+    if(!index || num <= 0 || num >= qcvm->max_edicts || index->isDirty[num])
+    {
+        return;
+    }
+
+    index->isDirty[num] = true;
+    index->dirty.push_back(num);
+}
+
+void PR_FieldIndexTouch(edict_t* ed)
+{
+    if(qcvm->fieldindex)
+    {
+        PR_FieldIndexTouchNum(
+            ((byte*)ed - (byte*)qcvm->edicts) / qcvm->edict_size);
+    }
+}
+
+/*
+=================
+PR_FieldIndexStore
+
+Called by the VM before it stores a string through an entity field pointer.
+=================
+*/
+void PR_FieldIndexStore(const int ptrofs)
+{
+    const int num = ptrofs / qcvm->edict_size;
+    const int fieldbyte = ptrofs - num * qcvm->edict_size -
+                          (int)((byte*)&qcvm->edicts->v - (byte*)qcvm->edicts);
+
+    for(const pr_fieldindex_t::Field& field : qcvm->fieldindex->fields)
+    {
+        if(fieldbyte == field.ofs * 4)
+        {
+            PR_FieldIndexTouchNum(num);
+            return;
+        }
+    }
+}
+
+void PR_FieldIndexClear(qcvm_t* vm)
+{
+    delete vm->fieldindex;
+    vm->fieldindex = nullptr;
+}
+
+/*
+=================
+PR_FieldIndexFind
+
+Returns the ascending numbers of the edicts whose field `fld` equals `s`, or
+nullptr if that field is not indexed and the caller has to scan. The result
+is only valid until QC runs again.
+=================
+*/
+const int* PR_FieldIndexFind(const int fld, const char* s, int* count)
+{
+    if(!pr_findindex.value)
+    {
+        PR_FieldIndexClear(qcvm);
+        return nullptr;
+    }
+
+    if(!qcvm->fieldindex)
+    {
+        auto* index = new pr_fieldindex_t;
+        index->fields[0].ofs = offsetof(entvars_t, classname) / 4;
+        index->fields[1].ofs = offsetof(entvars_t, targetname) / 4;
+        index->fields[2].ofs = offsetof(entvars_t, target) / 4;
+
+        for(pr_fieldindex_t::Field& field : index->fields)
+        {
+            field.keyOf.resize(qcvm->max_edicts);
+        }
+
+        index->isDirty.resize(qcvm->max_edicts);
+        qcvm->fieldindex = index;
+
+        for(int i = 1; i < qcvm->num_edicts; i++)
+        {
+            PR_FieldIndexUpdate(*index, i);
+        }
+    }
+
+    pr_fieldindex_t& index = *qcvm->fieldindex;
+
+    for(const int num : index.dirty)
+    {
+        index.isDirty[num] = false;
+        PR_FieldIndexUpdate(index, num);
+    }
+
+    index.dirty.clear();
+
+    for(const pr_fieldindex_t::Field& field : index.fields)
+    {
+        if(field.ofs != fld)
+        {
+            continue;
+        }
+
+        const auto it = field.edictsByValue.find(s);
+        if(it == field.edictsByValue.end())
+        {
+            static const int none = 0;
+
+            *count = 0;
+            return &none;
+        }
+
+        *count = (int)it->second.size();
+        return it->second.data();
+    }
+
+    return nullptr;
+}
 
 /*
 =================
@@ -75,6 +286,7 @@ void ED_ClearEdict(edict_t* e)
 {
     memset(&e->v, 0, qcvm->progs->entityfields * 4);
     e->free = false;
+    PR_FieldIndexTouch(e);
 }
 
 /*
@@ -119,6 +331,7 @@ edict_t* ED_Alloc()
         e, 0, qcvm->edict_size); // ericw -- switched sv.edicts to malloc(), so
                                  // we are accessing uninitialized memory and
                                  // must fully zero it, not just ED_ClearEdict
+    PR_FieldIndexTouch(e);
 
     return e;
 }
@@ -150,6 +363,7 @@ void ED_Free(edict_t* ed)
     ed->alpha = ENTALPHA_DEFAULT; // johnfitz -- reset alpha for next entity
 
     ed->freetime = qcvm->time;
+    PR_FieldIndexTouch(ed);
 }
 
 //===========================================================================
@@ -871,7 +1085,14 @@ bool ED_ParseEpair(void* base, ddef_t* key, const char* s)
 
     switch(key->type & ~DEF_SAVEGLOBAL)
     {
-        case ev_string: *(string_t*)d = ED_NewString(s); break;
+        case ev_string:
+            if(qcvm->fieldindex && base != qcvm->globals)
+            {
+                PR_FieldIndexStore((byte*)d - (byte*)qcvm->edicts);
+            }
+
+            *(string_t*)d = ED_NewString(s);
+            break;
 
         case ev_float: *(float*)d = atof(s); break;
 
@@ -966,6 +1187,7 @@ const char* ED_ParseEdict(const char* data, edict_t* ent)
     {
         // hack
         memset(&ent->v, 0, qcvm->progs->entityfields * 4);
+        PR_FieldIndexTouch(ent);
     }
 
     // go through all the dictionary pairs
@@ -1264,6 +1486,7 @@ void PR_ClearProgs(qcvm_t* vm)
         Z_Free((void*)qcvm->knownstrings);
     }
     free(qcvm->edicts); // ericw -- sv.edicts switched to use malloc()
+    PR_FieldIndexClear(qcvm);
     memset(qcvm, 0, sizeof(*qcvm));
 }
 
@@ -1476,6 +1699,7 @@ bool PR_LoadProgs(
 
     PR_SetEngineString("");
     PR_EnableExtensions(qcvm->globaldefs);
+    PR_DecodeStatements();
 
     return true;
 }
@@ -1493,6 +1717,7 @@ void PR_Init()
     Cmd_AddCommand("edictcount", ED_Count);
     Cmd_AddCommand("profile", PR_Profile_f);
     Cmd_AddCommand("pr_dumpplatform", PR_DumpPlatform_f);
+    Cmd_AddCommand("pr_benchmark", PR_Benchmark_f);
     Cvar_RegisterVariable(&nomonsters);
     Cvar_RegisterVariable(&gamecfg);
     Cvar_RegisterVariable(&scratch1);
@@ -1504,6 +1729,8 @@ void PR_Init()
     Cvar_RegisterVariable(&saved2);
     Cvar_RegisterVariable(&saved3);
     Cvar_RegisterVariable(&saved4);
+    Cvar_RegisterVariable(&pr_findindex);
+    Cvar_RegisterVariable(&pr_predecode);
 
     PR_InitExtensions();
 }
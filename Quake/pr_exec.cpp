@@ -27,6 +27,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "progs.hpp"
 #include "server.hpp"
 #include "qcvm.hpp"
+#include "zone.hpp"
+#include "cmd.hpp"
+#include "sys.hpp"
+#include "sv_bench.hpp"
 
 static const char* pr_opnames[] = {"DONE",
 
@@ -322,6 +326,8 @@ static int PR_LeaveFunction()
 }
 
 
+static void PR_ExecuteDecoded(dfunction_t* f, const void* const** labels);
+
 /*
 ====================
 PR_ExecuteProgram
@@ -344,6 +350,9 @@ void PR_ExecuteProgram(func_t fnum)
     edict_t* ed;
     int exitdepth;
 
+    const quake::bench::Timer benchTimer =
+        quake::svbench::startTimer(quake::svbench::Phase::QC);
+
     if(!fnum || fnum >= qcvm->progs->numfunctions)
     {
         if(pr_global_struct->self)
@@ -359,6 +368,13 @@ void PR_ExecuteProgram(func_t fnum)
 
     qcvm->trace = false;
 
+    if(qcvm->predecoded && qcvm->decodedstatements)
+    {
+        PR_ExecuteDecoded(f, nullptr);
+        quake::svbench::stopTimer(benchTimer);
+        return;
+    }
+
     // make a stack frame
     exitdepth = qcvm->depth;
 
@@ -482,10 +498,15 @@ void PR_ExecuteProgram(func_t fnum)
                 OPB->vector[2] = OPA->vector[2];
                 break;
 
+            case OP_STOREP_S:
+                if(qcvm->fieldindex)
+                {
+                    PR_FieldIndexStore(OPB->_int);
+                }
+                [[fallthrough]];
             case OP_STOREP_F:
             case OP_STOREP_ENT:
             case OP_STOREP_FLD: // integers
-            case OP_STOREP_S:
             case OP_STOREP_FNC: // pointers
                 ptr = (eval_t*)((byte*)qcvm->edicts + OPB->_int);
                 ptr->_int = OPA->_int;
@@ -597,6 +618,7 @@ void PR_ExecuteProgram(func_t fnum)
                 if(qcvm->depth == exitdepth)
                 {
                     // Done
+                    quake::svbench::stopTimer(benchTimer);
                     return;
                 }
                 break;
@@ -619,3 +641,542 @@ void PR_ExecuteProgram(func_t fnum)
 #undef OPA
 #undef OPB
 #undef OPC
+
+/*
+===============================================================================
+
+PRE-DECODED EXECUTION
+
+PR_DecodeStatements translates the statements once at load time: operands
+become pointers into the globals and jumps become plain offsets.
+PR_ExecuteDecoded then runs them with computed goto, so every handler jumps
+straight to the next one, or with a switch on compilers without it. The
+results match the interpreter above, except that the runaway check only
+runs on jumps and calls and that traceon needs pr_predecode 0.
+
+===============================================================================
+*/
+
+#if defined(__GNUC__) || defined(__clang__)
+#define PR_COMPUTED_GOTO 1
+#else
+#define PR_COMPUTED_GOTO 0
+#endif
+
+// in enum order, see pr_comp.hpp
+#define PR_OPCODES(X)                                                    \
+    X(OP_DONE)                                                           \
+    X(OP_MUL_F) X(OP_MUL_V) X(OP_MUL_FV) X(OP_MUL_VF) X(OP_DIV_F)        \
+    X(OP_ADD_F) X(OP_ADD_V) X(OP_SUB_F) X(OP_SUB_V)                      \
+    X(OP_EQ_F) X(OP_EQ_V) X(OP_EQ_S) X(OP_EQ_E) X(OP_EQ_FNC)             \
+    X(OP_NE_F) X(OP_NE_V) X(OP_NE_S) X(OP_NE_E) X(OP_NE_FNC)             \
+    X(OP_LE) X(OP_GE) X(OP_LT) X(OP_GT)                                  \
+    X(OP_LOAD_F) X(OP_LOAD_V) X(OP_LOAD_S) X(OP_LOAD_ENT)                \
+    X(OP_LOAD_FLD) X(OP_LOAD_FNC) X(OP_ADDRESS)                          \
+    X(OP_STORE_F) X(OP_STORE_V) X(OP_STORE_S) X(OP_STORE_ENT)            \
+    X(OP_STORE_FLD) X(OP_STORE_FNC)                                      \
+    X(OP_STOREP_F) X(OP_STOREP_V) X(OP_STOREP_S) X(OP_STOREP_ENT)        \
+    X(OP_STOREP_FLD) X(OP_STOREP_FNC) X(OP_RETURN)                       \
+    X(OP_NOT_F) X(OP_NOT_V) X(OP_NOT_S) X(OP_NOT_ENT) X(OP_NOT_FNC)      \
+    X(OP_IF) X(OP_IFNOT)                                                 \
+    X(OP_CALL0) X(OP_CALL1) X(OP_CALL2) X(OP_CALL3) X(OP_CALL4)          \
+    X(OP_CALL5) X(OP_CALL6) X(OP_CALL7) X(OP_CALL8)                      \
+    X(OP_STATE) X(OP_GOTO) X(OP_AND) X(OP_OR) X(OP_BITAND) X(OP_BITOR)
+
+#define PR_NUMOPS (OP_BITOR + 1)
+
+struct pr_decodedstatement_t
+{
+#if PR_COMPUTED_GOTO
+    const void* label; // handler for `op`
+#endif
+    eval_t* a;
+    eval_t* b;
+    eval_t* c;
+    int op;
+    int jump; // statement offset for OP_IF, OP_IFNOT and OP_GOTO
+};
+
+cvar_t pr_predecode = {"pr_predecode", "1", CVAR_NONE};
+
+/*
+====================
+PR_DecodeStatements
+
+Called by PR_LoadProgs once the statements and globals are byte swapped.
+====================
+*/
+void PR_DecodeStatements()
+{
+    const int num = qcvm->progs->numstatements;
+
+    auto* decoded = Hunk_AllocName<pr_decodedstatement_t>(num, "qcdecode");
+
+#if PR_COMPUTED_GOTO
+    const void* const* labels;
+    PR_ExecuteDecoded(nullptr, &labels);
+#endif
+
+    for(int i = 0; i < num; i++)
+    {
+        const dstatement_t& st = qcvm->statements[i];
+        pr_decodedstatement_t& ds = decoded[i];
+
+        ds.op = st.op;
+        ds.a = (eval_t*)&qcvm->globals[(unsigned short)st.a];
+        ds.b = (eval_t*)&qcvm->globals[(unsigned short)st.b];
+        ds.c = (eval_t*)&qcvm->globals[(unsigned short)st.c];
+        ds.jump = st.op == OP_GOTO ? st.a : st.b;
+
+#if PR_COMPUTED_GOTO
+        // the last label reports the bad opcode
+        ds.label = labels[st.op < PR_NUMOPS ? st.op : PR_NUMOPS];
+#endif
+    }
+
+    qcvm->decodedstatements = decoded;
+
+    // only read at load time, takes effect on the next map
+    qcvm->predecoded = pr_predecode.value != 0.f;
+}
+
+/*
+====================
+PR_ExecuteDecoded
+
+Same as the loop in PR_ExecuteProgram, on decoded statements. When `labels`
+is not null, only returns the handler table for PR_DecodeStatements.
+====================
+*/
+static void PR_ExecuteDecoded(dfunction_t* f, const void* const** labels)
+{
+#if PR_COMPUTED_GOTO
+#define PR_LABEL(op) &&L_##op,
+    static const void* const table[] = {PR_OPCODES(PR_LABEL) &&L_BAD};
+#undef PR_LABEL
+
+    static_assert(sizeof(table) / sizeof(table[0]) == PR_NUMOPS + 1);
+
+    if(labels)
+    {
+        *labels = table;
+        return;
+    }
+
+#define PR_OP(op) L_##op:
+#define PR_BADOP L_BAD:
+#define PR_FALLTHROUGH
+#define PR_NEXT()       \
+    ++profile;          \
+    ++ds;               \
+    goto* ds->label
+#else
+    (void)labels;
+
+#define PR_OP(op) case op:
+#define PR_BADOP default:
+#define PR_FALLTHROUGH [[fallthrough]]
+#define PR_NEXT() \
+    ++profile;    \
+    ++ds;         \
+    continue
+#endif
+
+#define PR_CHECKRUNAWAY()                            \
+    if(profile > 0x10000000)                         \
+    {                                                \
+        qcvm->xstatement = ds - base;                \
+        PR_RunError("runaway loop error");           \
+    }
+
+    pr_decodedstatement_t* const base = qcvm->decodedstatements;
+    const int exitdepth = qcvm->depth;
+    int profile = 0;
+    int startprofile = 0;
+    eval_t* ptr;
+    edict_t* ed;
+    dfunction_t* newf;
+
+    pr_decodedstatement_t* ds = &base[PR_EnterFunction(f)];
+
+    // same accounting as the interpreter: the first statement counts too
+    ++profile;
+    ++ds;
+
+#if PR_COMPUTED_GOTO
+    goto* ds->label;
+#else
+    while(true)
+    {
+        switch(ds->op)
+        {
+#endif
+            PR_OP(OP_ADD_F)
+            ds->c->_float = ds->a->_float + ds->b->_float;
+            PR_NEXT();
+
+            PR_OP(OP_ADD_V)
+            ds->c->vector[0] = ds->a->vector[0] + ds->b->vector[0];
+            ds->c->vector[1] = ds->a->vector[1] + ds->b->vector[1];
+            ds->c->vector[2] = ds->a->vector[2] + ds->b->vector[2];
+            PR_NEXT();
+
+            PR_OP(OP_SUB_F)
+            ds->c->_float = ds->a->_float - ds->b->_float;
+            PR_NEXT();
+
+            PR_OP(OP_SUB_V)
+            ds->c->vector[0] = ds->a->vector[0] - ds->b->vector[0];
+            ds->c->vector[1] = ds->a->vector[1] - ds->b->vector[1];
+            ds->c->vector[2] = ds->a->vector[2] - ds->b->vector[2];
+            PR_NEXT();
+
+            PR_OP(OP_MUL_F)
+            ds->c->_float = ds->a->_float * ds->b->_float;
+            PR_NEXT();
+
+            PR_OP(OP_MUL_V)
+            ds->c->_float = ds->a->vector[0] * ds->b->vector[0] +
+                            ds->a->vector[1] * ds->b->vector[1] +
+                            ds->a->vector[2] * ds->b->vector[2];
+            PR_NEXT();
+
+            PR_OP(OP_MUL_FV)
+            ds->c->vector[0] = ds->a->_float * ds->b->vector[0];
+            ds->c->vector[1] = ds->a->_float * ds->b->vector[1];
+            ds->c->vector[2] = ds->a->_float * ds->b->vector[2];
+            PR_NEXT();
+
+            PR_OP(OP_MUL_VF)
+            ds->c->vector[0] = ds->b->_float * ds->a->vector[0];
+            ds->c->vector[1] = ds->b->_float * ds->a->vector[1];
+            ds->c->vector[2] = ds->b->_float * ds->a->vector[2];
+            PR_NEXT();
+
+            PR_OP(OP_DIV_F)
+            ds->c->_float = ds->a->_float / ds->b->_float;
+            PR_NEXT();
+
+            PR_OP(OP_BITAND)
+            ds->c->_float = (int)ds->a->_float & (int)ds->b->_float;
+            PR_NEXT();
+
+            PR_OP(OP_BITOR)
+            ds->c->_float = (int)ds->a->_float | (int)ds->b->_float;
+            PR_NEXT();
+
+            PR_OP(OP_GE)
+            ds->c->_float = ds->a->_float >= ds->b->_float;
+            PR_NEXT();
+
+            PR_OP(OP_LE)
+            ds->c->_float = ds->a->_float <= ds->b->_float;
+            PR_NEXT();
+
+            PR_OP(OP_GT)
+            ds->c->_float = ds->a->_float > ds->b->_float;
+            PR_NEXT();
+
+            PR_OP(OP_LT)
+            ds->c->_float = ds->a->_float < ds->b->_float;
+            PR_NEXT();
+
+            PR_OP(OP_AND)
+            ds->c->_float = ds->a->_float && ds->b->_float;
+            PR_NEXT();
+
+            PR_OP(OP_OR)
+            ds->c->_float = ds->a->_float || ds->b->_float;
+            PR_NEXT();
+
+            PR_OP(OP_NOT_F)
+            ds->c->_float = !ds->a->_float;
+            PR_NEXT();
+
+            PR_OP(OP_NOT_V)
+            ds->c->_float =
+                !ds->a->vector[0] && !ds->a->vector[1] && !ds->a->vector[2];
+            PR_NEXT();
+
+            PR_OP(OP_NOT_S)
+            ds->c->_float = !ds->a->string || !*PR_GetString(ds->a->string);
+            PR_NEXT();
+
+            PR_OP(OP_NOT_FNC)
+            ds->c->_float = !ds->a->function;
+            PR_NEXT();
+
+            PR_OP(OP_NOT_ENT)
+            ds->c->_float = (PROG_TO_EDICT(ds->a->edict) == qcvm->edicts);
+            PR_NEXT();
+
+            PR_OP(OP_EQ_F)
+            ds->c->_float = ds->a->_float == ds->b->_float;
+            PR_NEXT();
+
+            PR_OP(OP_EQ_V)
+            ds->c->_float = (ds->a->vector[0] == ds->b->vector[0]) &&
+                            (ds->a->vector[1] == ds->b->vector[1]) &&
+                            (ds->a->vector[2] == ds->b->vector[2]);
+            PR_NEXT();
+
+            PR_OP(OP_EQ_S)
+            ds->c->_float = !strcmp(
+                PR_GetString(ds->a->string), PR_GetString(ds->b->string));
+            PR_NEXT();
+
+            PR_OP(OP_EQ_E)
+            ds->c->_float = ds->a->_int == ds->b->_int;
+            PR_NEXT();
+
+            PR_OP(OP_EQ_FNC)
+            ds->c->_float = ds->a->function == ds->b->function;
+            PR_NEXT();
+
+            PR_OP(OP_NE_F)
+            ds->c->_float = ds->a->_float != ds->b->_float;
+            PR_NEXT();
+
+            PR_OP(OP_NE_V)
+            ds->c->_float = (ds->a->vector[0] != ds->b->vector[0]) ||
+                            (ds->a->vector[1] != ds->b->vector[1]) ||
+                            (ds->a->vector[2] != ds->b->vector[2]);
+            PR_NEXT();
+
+            PR_OP(OP_NE_S)
+            ds->c->_float = strcmp(
+                PR_GetString(ds->a->string), PR_GetString(ds->b->string));
+            PR_NEXT();
+
+            PR_OP(OP_NE_E)
+            ds->c->_float = ds->a->_int != ds->b->_int;
+            PR_NEXT();
+
+            PR_OP(OP_NE_FNC)
+            ds->c->_float = ds->a->function != ds->b->function;
+            PR_NEXT();
+
+            PR_OP(OP_STORE_F)
+            PR_OP(OP_STORE_ENT)
+            PR_OP(OP_STORE_FLD) // integers
+            PR_OP(OP_STORE_S)
+            PR_OP(OP_STORE_FNC) // pointers
+            ds->b->_int = ds->a->_int;
+            PR_NEXT();
+
+            PR_OP(OP_STORE_V)
+            ds->b->vector[0] = ds->a->vector[0];
+            ds->b->vector[1] = ds->a->vector[1];
+            ds->b->vector[2] = ds->a->vector[2];
+            PR_NEXT();
+
+            PR_OP(OP_STOREP_S)
+            if(qcvm->fieldindex)
+            {
+                PR_FieldIndexStore(ds->b->_int);
+            }
+            PR_FALLTHROUGH;
+            PR_OP(OP_STOREP_F)
+            PR_OP(OP_STOREP_ENT)
+            PR_OP(OP_STOREP_FLD) // integers
+            PR_OP(OP_STOREP_FNC) // pointers
+            ptr = (eval_t*)((byte*)qcvm->edicts + ds->b->_int);
+            ptr->_int = ds->a->_int;
+            PR_NEXT();
+
+            PR_OP(OP_STOREP_V)
+            ptr = (eval_t*)((byte*)qcvm->edicts + ds->b->_int);
+            ptr->vector[0] = ds->a->vector[0];
+            ptr->vector[1] = ds->a->vector[1];
+            ptr->vector[2] = ds->a->vector[2];
+            PR_NEXT();
+
+            PR_OP(OP_ADDRESS)
+            ed = PROG_TO_EDICT(ds->a->edict);
+#ifdef PARANOID
+            NUM_FOR_EDICT(ed); // Make sure it's in range
+#endif
+            if(ed == (edict_t*)qcvm->edicts && sv.state == ss_active)
+            {
+                qcvm->xstatement = ds - base;
+                PR_RunError("assignment to world entity");
+            }
+            ds->c->_int =
+                (byte*)((int*)&ed->v + ds->b->_int) - (byte*)qcvm->edicts;
+            PR_NEXT();
+
+            PR_OP(OP_LOAD_F)
+            PR_OP(OP_LOAD_FLD)
+            PR_OP(OP_LOAD_ENT)
+            PR_OP(OP_LOAD_S)
+            PR_OP(OP_LOAD_FNC)
+            ed = PROG_TO_EDICT(ds->a->edict);
+#ifdef PARANOID
+            NUM_FOR_EDICT(ed); // Make sure it's in range
+#endif
+            ds->c->_int = ((eval_t*)((int*)&ed->v + ds->b->_int))->_int;
+            PR_NEXT();
+
+            PR_OP(OP_LOAD_V)
+            ed = PROG_TO_EDICT(ds->a->edict);
+#ifdef PARANOID
+            NUM_FOR_EDICT(ed); // Make sure it's in range
+#endif
+            ptr = (eval_t*)((int*)&ed->v + ds->b->_int);
+            ds->c->vector[0] = ptr->vector[0];
+            ds->c->vector[1] = ptr->vector[1];
+            ds->c->vector[2] = ptr->vector[2];
+            PR_NEXT();
+
+            PR_OP(OP_IFNOT)
+            if(!ds->a->_int)
+            {
+                PR_CHECKRUNAWAY();
+                ds += ds->jump - 1; /* -1 to offset PR_NEXT */
+            }
+            PR_NEXT();
+
+            PR_OP(OP_IF)
+            if(ds->a->_int)
+            {
+                PR_CHECKRUNAWAY();
+                ds += ds->jump - 1; /* -1 to offset PR_NEXT */
+            }
+            PR_NEXT();
+
+            PR_OP(OP_GOTO)
+            PR_CHECKRUNAWAY();
+            ds += ds->jump - 1; /* -1 to offset PR_NEXT */
+            PR_NEXT();
+
+            PR_OP(OP_CALL0)
+            PR_OP(OP_CALL1)
+            PR_OP(OP_CALL2)
+            PR_OP(OP_CALL3)
+            PR_OP(OP_CALL4)
+            PR_OP(OP_CALL5)
+            PR_OP(OP_CALL6)
+            PR_OP(OP_CALL7)
+            PR_OP(OP_CALL8)
+            PR_CHECKRUNAWAY();
+            qcvm->xfunction->profile += profile - startprofile;
+            startprofile = profile;
+            qcvm->xstatement = ds - base;
+            qcvm->argc = ds->op - OP_CALL0;
+            if(!ds->a->function)
+            {
+                PR_RunError("NULL function");
+            }
+            newf = &qcvm->functions[ds->a->function];
+            if(newf->first_statement < 0)
+            {
+                // Built-in function
+                int i = -newf->first_statement;
+                if(i >= qcvm->numbuiltins)
+                {
+                    i = 0; // just invoke the fixme builtin.
+                }
+                qcvm->builtins[i]();
+                PR_NEXT();
+            }
+            // Normal function
+            ds = &base[PR_EnterFunction(newf)];
+            PR_NEXT();
+
+            PR_OP(OP_DONE)
+            PR_OP(OP_RETURN)
+            qcvm->xfunction->profile += profile - startprofile;
+            startprofile = profile;
+            qcvm->xstatement = ds - base;
+            qcvm->globals[OFS_RETURN] = ds->a->vector[0];
+            qcvm->globals[OFS_RETURN + 1] = ds->a->vector[1];
+            qcvm->globals[OFS_RETURN + 2] = ds->a->vector[2];
+            ds = &base[PR_LeaveFunction()];
+            if(qcvm->depth == exitdepth)
+            {
+                // Done
+                return;
+            }
+            PR_NEXT();
+
+            PR_OP(OP_STATE)
+            ed = PROG_TO_EDICT(pr_global_struct->self);
+            ed->v.nextthink = pr_global_struct->time + 0.1;
+            ed->v.frame = ds->a->_float;
+            ed->v.think = ds->b->function;
+            PR_NEXT();
+
+            PR_BADOP
+            qcvm->xstatement = ds - base;
+            PR_RunError("Bad opcode %i", ds->op);
+#if !PR_COMPUTED_GOTO
+        }
+    }
+#endif
+
+#undef PR_OP
+#undef PR_BADOP
+#undef PR_FALLTHROUGH
+#undef PR_NEXT
+#undef PR_CHECKRUNAWAY
+}
+
+/*
+============
+PR_Benchmark_f
+
+Runs the server physics for a number of frames, alternating between the
+interpreter and the pre-decoded statements every frame so that both see
+the same kind of world, and prints how long each took.
+============
+*/
+void PR_Benchmark_f()
+{
+    if(!sv.active)
+    {
+        Con_Printf("pr_benchmark: no server running\n");
+        return;
+    }
+
+    const int frames = Cmd_Argc() > 1 ? q_max(Q_atoi(Cmd_Argv(1)), 2) : 600;
+
+    QCVMGuard qg{&sv.qcvm};
+
+    if(!qcvm->decodedstatements)
+    {
+        PR_DecodeStatements();
+    }
+
+    const bool oldpredecoded = qcvm->predecoded;
+    double elapsed[2] = {0, 0};
+
+    for(int i = 0; i < frames; i++)
+    {
+        qcvm->predecoded = i & 1;
+
+        SV_ClearDatagram();
+        for(int j = 0; j < svs.maxclients; j++)
+        {
+            SZ_Clear(&svs.clients[j].datagram);
+        }
+
+        pr_global_struct->frametime = host_frametime;
+
+        const double start = Sys_DoubleTime();
+        SV_Physics();
+        elapsed[i & 1] += Sys_DoubleTime() - start;
+    }
+
+    qcvm->predecoded = oldpredecoded;
+
+    const int perMode = frames / 2;
+    Con_Printf("%d frames per mode\n", perMode);
+    Con_Printf("  interpreter: %8.3f ms/frame\n", elapsed[0] * 1000 / perMode);
+    Con_Printf("  pre-decoded: %8.3f ms/frame (%s dispatch)\n",
+        elapsed[1] * 1000 / perMode, PR_COMPUTED_GOTO ? "computed goto" : "switch");
+
+    if(elapsed[1] > 0)
+    {
+        Con_Printf("  speedup:     %8.2fx\n", elapsed[0] / elapsed[1]);
+    }
+}
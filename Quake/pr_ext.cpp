@@ -2771,6 +2771,7 @@ static void PF_spawnclient()
                 svs.clients[i].spawned = true;
                 ent = svs.clients[i].edict;
                 memset(&ent->v, 0, qcvm->progs->entityfields * 4);
+                PR_FieldIndexTouch(ent);
                 ent->v.colormap = NUM_FOR_EDICT(ent);
                 ent->v.team = (svs.clients[i].colors & 15) + 1;
                 ent->v.netname = PR_SetEngineString(svs.clients[i].name);
@@ -3278,6 +3279,11 @@ static void PF_fopen()
         return;
     }
 
+    if(fmode != 0)
+    {
+        COM_InvalidateFileCache();
+    }
+
     for(i = 0;; i++)
     {
         if(i == qcfiles_max)
@@ -4346,6 +4352,7 @@ static void PF_copyentity()
         Con_Printf("PF_copyentity: entity is free\n");
     }
     memcpy(&dst->v, &src->v, qcvm->edict_size - sizeof(edict_t));
+    PR_FieldIndexTouch(dst);
     dst->alpha = src->alpha;
     dst->sendinterval = src->sendinterval;
     SV_LinkEdict(dst, false);
@@ -4370,6 +4377,24 @@ static void PF_findchain()
     s = G_STRING(OFS_PARM1);
     // FIXME: cfld = G_INT(OFS_PARM2);
 
+    int count;
+    if(const int* nums = PR_FieldIndexFind(f, s, &count))
+    {
+        for(i = 0; i < count; i++)
+        {
+            ent = EDICT_NUM(nums[i]);
+            if(ent->free || strcmp(s, E_STRING(ent, f)))
+            {
+                continue;
+            }
+            ent->v.chain = EDICT_TO_PROG(chain);
+            chain = ent;
+        }
+
+        RETURN_EDICT(chain);
+        return;
+    }
+
     ent = NEXT_EDICT(qcvm->edicts);
     for(i = 1; i < qcvm->num_edicts; i++, ent = NEXT_EDICT(ent))
     {
@@ -4892,13 +4917,12 @@ static void SV_Multicast(
             break;
         case MULTICAST_PHS_R:
         case MULTICAST_PHS_U:
+            // only available when the map fit in mod_vismatrix, otherwise
+            // nullptr sends it to everyone
             PF_multicast_internal(to == MULTICAST_PHS_R,
-                nullptr /*Mod_LeafPHS(Mod_PointInLeaf(org, qcvm->worldmodel),
-                        qcvm->worldmodel)*/
-                ,
-                requireext2); // we don't support phs, that would require lots
-                              // of pvs decompression+merging stuff, and many
-                              // q1bsps have a LOT of leafs.
+                Mod_LeafPHS(
+                    Mod_PointInLeaf(org, qcvm->worldmodel), qcvm->worldmodel),
+                requireext2);
             break;
         case MULTICAST_PVS_R:
         case MULTICAST_PVS_U:
@@ -46,6 +46,8 @@ struct qcvm_t;
 void PR_Init();
 
 void PR_ExecuteProgram(func_t fnum);
+void PR_DecodeStatements();
+void PR_Benchmark_f();
 void PR_ClearProgs(qcvm_t* vm);
 bool PR_LoadProgs(
     const char* filename, bool fatal, builtin_t* builtins, size_t numbuiltins);
@@ -84,6 +86,12 @@ void PR_Profile_f();
 edict_t* ED_Alloc();
 void ED_Free(edict_t* ed);
 
+// string field index used by find/findchain, see pr_edict.cpp
+void PR_FieldIndexTouch(edict_t* ed); // after writing fields outside the VM
+void PR_FieldIndexStore(int ptrofs);  // before OP_STOREP_S
+void PR_FieldIndexClear(qcvm_t* vm);
+const int* PR_FieldIndexFind(int fld, const char* s, int* count);
+
 void ED_Print(edict_t* ed);
 void ED_Write(FILE* f, edict_t* ed);
 const char* ED_ParseEdict(const char* data, edict_t* ent);
@@ -31,6 +31,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "quakedef_macros.hpp"
 #include "cvar.hpp"
 
+#include <atomic>
+
 /* !!! if this is changed, it must be changed in asm_i386.h too !!! */
 typedef struct
 {
@@ -81,8 +83,36 @@ typedef struct
     qvec3 origin;    /* origin of sound effect			*/
     float dist_mult; /* distance multiplier (attenuation/clipK)	*/
     int master_vol;  /* 0-255 master volume				*/
+    sfx_t* mixsfx;   /* sound last sent to the mixer			*/
+    int mixleftvol;  /* volumes last sent to the mixer		*/
+    int mixrightvol;
 } channel_t;
 
+/* Commands from the game side of the sound system to the mixer. The game side
+ * owns snd_channels; the mixer keeps its own position and end time for each
+ * of them, and only learns about changes through these commands, which it
+ * applies in order before painting. The mixer only holds on to the sfx_t,
+ * and looks up its cached data with Cache_Mutex held each time it paints. */
+typedef enum
+{
+    SND_CMD_START,  /* play sfx from pos, with leftvol/rightvol	*/
+    SND_CMD_SOUND,  /* play sfx from the start, unless already playing */
+    SND_CMD_VOLUME, /* new leftvol/rightvol				*/
+    SND_CMD_SHIFT,  /* pos += pos (streamed voice chat), never queued	*/
+    SND_CMD_STOP,
+    SND_CMD_STOPALL
+} sndcmdtype_t;
+
+typedef struct
+{
+    sndcmdtype_t type;
+    int channel; /* index in snd_channels				*/
+    sfx_t* sfx;
+    int pos;
+    int leftvol;
+    int rightvol;
+} sndcmd_t;
+
 #define WAV_FORMAT_PCM 1
 
 typedef struct
@@ -115,6 +145,13 @@ void S_UnblockSound();
 sfx_t* S_PrecacheSound(const char* sample);
 void S_TouchSound(const char* sample);
 void S_PaintChannels(int endtime);
+
+/* queues a command for the mixer, false if the queue is full */
+bool SND_PushCommand(const sndcmd_t& cmd);
+
+/* applies the queued commands, with Cache_Mutex held while there is a mixer
+ * thread */
+void SND_ApplyCommands();
 void S_InitPaintChannels();
 
 /* picks a channel based on priorities, empty slots, number of channels */
@@ -123,6 +160,12 @@ channel_t* SND_PickChannel(int entnum, int entchannel);
 /* spatializes a channel */
 void SND_Spatialize(channel_t* ch);
 
+/* for streamed sounds, which rewrite their data with Cache_Mutex held: the
+ * mixer's position in a channel, or -1 once it's done with it, and moving
+ * that position, which returns the channel's new end time */
+int SND_ChannelPos(const channel_t* ch);
+int SND_ShiftChannel(const channel_t* ch, int pos);
+
 /* music stream support */
 void S_RawSamples(
     int samples, int rate, int width, int channels, byte* data, float volume);
@@ -157,7 +200,7 @@ void SNDDMA_UnblockSound();
 //#define	MAX_CHANNELS		1024 // spike -- made this obsolete. ericw --
 // was 512
 ///* johnfitz -- was 128 */
-#define MAX_DYNAMIC_CHANNELS 128 /* johnfitz -- was 8   */
+#define MAX_DYNAMIC_CHANNELS 256 /* johnfitz -- was 8   */
 
 extern channel_t* snd_channels;
 /* 0 to MAX_DYNAMIC_CHANNELS-1	= normal entity sounds
@@ -170,8 +213,10 @@ extern volatile dma_t* shm;
 extern int max_channels;
 extern int total_channels;
 extern int soundtime;
-extern int paintedtime;
-extern int s_rawend;
+/* written by the mixer, which may run on its own thread */
+extern std::atomic<int> paintedtime;
+/* written by the music stream, read by the mixer */
+extern std::atomic<int> s_rawend;
 
 extern float voicevolumescale;
 
@@ -182,6 +227,8 @@ extern qvec3 listener_up;
 
 extern cvar_t sndspeed;
 extern cvar_t snd_mixspeed;
+extern cvar_t snd_mix_simd;
+extern cvar_t snd_mixthread;
 extern cvar_t snd_filterquality;
 extern cvar_t sfxvolume;
 extern cvar_t loadas8bit;
@@ -65,6 +65,14 @@ struct qcvm_t
     // originally from world.c
     areanode_t areanodes[AREA_NODES];
     int numareanodes;
+    int areadepth;
+
+    // built on demand by PR_FieldIndexFind when pr_findindex is set
+    struct pr_fieldindex_t* fieldindex;
+
+    // built by PR_LoadProgs, see PR_DecodeStatements
+    struct pr_decodedstatement_t* decodedstatements;
+    bool predecoded;
 };
 
 extern qcvm_t* qcvm;
@@ -108,6 +108,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define MAX_SOUNDS 2048 // johnfitz -- was 256
 
 #define SAVEGAME_COMMENT_LENGTH 39
+#define SAVEGAME_VERSION 5
 
 #define MAX_STYLESTRING 64
 
@@ -34,6 +34,11 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "gl_texmgr.hpp"
 #include "sys.hpp"
 #include "console.hpp"
+#include "jobs.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <vector>
 
 extern cvar_t gl_fullbrights, r_drawflat, gl_overbright, r_oldwater; // johnfitz
 extern cvar_t gl_zfix; // QuakeSpasm z-fighting fix
@@ -47,10 +52,26 @@ int lightmap_count;
 int last_lightmap_allocated;
 int allocated[LMBLOCK_WIDTH];
 
-unsigned blocklights[LMBLOCK_WIDTH * LMBLOCK_HEIGHT *
-                     3]; // johnfitz -- was 18*18, added lit support (*3) and
-                         // loosened surface extents maximum
-                         // (LMBLOCK_WIDTH*LMBLOCK_HEIGHT)
+// surfaces queued by R_RenderDynamicLightmaps for R_BuildDynamicLightmaps
+static std::vector<msurface_t*> dirty_lightmaps;
+
+/*
+===============
+R_BlockLights
+
+Scratch buffer for R_BuildLightMap, one per thread since dynamic lightmaps are
+built on the job threads.
+===============
+*/
+static unsigned* R_BlockLights()
+{
+    // johnfitz -- was 18*18, added lit support (*3) and loosened surface
+    // extents maximum (LMBLOCK_WIDTH*LMBLOCK_HEIGHT)
+    thread_local std::vector<unsigned> blocklights(
+        LMBLOCK_WIDTH * LMBLOCK_HEIGHT * 3);
+
+    return blocklights.data();
+}
 
 
 /*
@@ -733,12 +754,12 @@ void R_DrawBrushModel_ShowTris(entity_t* e)
 /*
 ================
 R_RenderDynamicLightmaps
-called during rendering
+called during rendering; queues the lightmap for R_BuildDynamicLightmaps if
+it needs rebuilding
 ================
 */
-void R_RenderDynamicLightmaps(qmodel_t* model, msurface_t* fa)
+void R_RenderDynamicLightmaps(msurface_t* fa)
 {
-    byte* base;
     int maps;
     glRect_t* theRect;
     int smax;
@@ -799,14 +820,58 @@ void R_RenderDynamicLightmaps(qmodel_t* model, msurface_t* fa)
             {
                 theRect->h = (fa->light_t - theRect->t) + tmax;
             }
-            base = lm->data;
-            base += fa->light_t * LMBLOCK_WIDTH * lightmap_bytes +
-                    fa->light_s * lightmap_bytes;
-            R_BuildLightMap(model, fa, base, LMBLOCK_WIDTH * lightmap_bytes);
+            dirty_lightmaps.push_back(fa);
         }
     }
 }
 
+/*
+================
+R_BuildDynamicLightmaps
+
+builds the lightmaps queued by R_RenderDynamicLightmaps on the job threads.
+surfaces never share texels, so they can be built in any order; sorting them
+by page keeps each thread writing to few pages.
+================
+*/
+void R_BuildDynamicLightmaps(qmodel_t* model)
+{
+    if(dirty_lightmaps.empty())
+    {
+        return;
+    }
+
+    // R_BuildLightMap can't report errors from the job threads
+    if(gl_lightmap_format != GL_RGBA && gl_lightmap_format != GL_BGRA)
+    {
+        Sys_Error("R_BuildDynamicLightmaps: bad lightmap format");
+    }
+
+    std::sort(dirty_lightmaps.begin(), dirty_lightmaps.end(),
+        [](const msurface_t* a, const msurface_t* b) {
+            if(a->lightmaptexturenum != b->lightmaptexturenum)
+            {
+                return a->lightmaptexturenum < b->lightmaptexturenum;
+            }
+            return a->light_t < b->light_t;
+        });
+
+    quake::jobs::parallelFor(dirty_lightmaps.size(), 16,
+        [&](const std::size_t begin, const std::size_t end) {
+            for(std::size_t i = begin; i < end; ++i)
+            {
+                msurface_t* fa = dirty_lightmaps[i];
+                byte* base = lightmap[fa->lightmaptexturenum].data;
+                base += fa->light_t * LMBLOCK_WIDTH * lightmap_bytes +
+                        fa->light_s * lightmap_bytes;
+                R_BuildLightMap(
+                    model, fa, base, LMBLOCK_WIDTH * lightmap_bytes);
+            }
+        });
+
+    dirty_lightmaps.clear();
+}
+
 /*
 ========================
 AllocBlock -- returns a texture number and the position inside it
@@ -1192,7 +1257,7 @@ void GL_BuildBModelVertexBuffer()
 R_AddDynamicLights
 ===============
 */
-void R_AddDynamicLights(msurface_t* surf)
+static void R_AddDynamicLights(msurface_t* surf, unsigned* blocklights)
 {
     int lnum;
     int sd;
@@ -1298,27 +1363,227 @@ void R_AddDynamicLights(msurface_t* surf)
 }
 
 
+/*
+===============
+R_AccumulateLightmap
+
+bl[i] += samples[i] * scale, with scalar, SSE2 and AVX2 versions giving the
+same results
+===============
+*/
+static void R_AccumulateLightmapScalar(
+    unsigned* bl, const byte* samples, int i, int count, unsigned scale)
+{
+    for(; i < count; i++)
+    {
+        bl[i] += samples[i] * scale;
+    }
+}
+
+#if QUAKE_SIMD_X86
+static void R_AccumulateLightmapSSE2(
+    unsigned* bl, const byte* samples, int count, unsigned scale)
+{
+    int i = 0;
+
+    // 16x16 bit multiplies, whose high and low halves make the exact 32 bit
+    // product as long as the scale fits in 16 bits (lightstyles peak at 'z')
+    if(scale <= 0xFFFF)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i vscale = _mm_set1_epi16((short)scale);
+
+        for(; i + 16 <= count; i += 16)
+        {
+            const __m128i s8 =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+
+            for(int half = 0; half < 2; half++)
+            {
+                const __m128i s16 = half ? _mm_unpackhi_epi8(s8, zero)
+                                         : _mm_unpacklo_epi8(s8, zero);
+                const __m128i lo = _mm_mullo_epi16(s16, vscale);
+                const __m128i hi = _mm_mulhi_epu16(s16, vscale);
+
+                auto* dst = reinterpret_cast<__m128i*>(bl + i + half * 8);
+                _mm_storeu_si128(dst, _mm_add_epi32(_mm_loadu_si128(dst),
+                                          _mm_unpacklo_epi16(lo, hi)));
+                _mm_storeu_si128(dst + 1,
+                    _mm_add_epi32(_mm_loadu_si128(dst + 1),
+                        _mm_unpackhi_epi16(lo, hi)));
+            }
+        }
+    }
+
+    R_AccumulateLightmapScalar(bl, samples, i, count, scale);
+}
+
+QUAKE_TARGET_AVX2 static void R_AccumulateLightmapAVX2(
+    unsigned* bl, const byte* samples, int count, unsigned scale)
+{
+    const __m256i vscale = _mm256_set1_epi32((int)scale);
+    int i = 0;
+
+    for(; i + 8 <= count; i += 8)
+    {
+        const __m256i s = _mm256_cvtepu8_epi32(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(samples + i)));
+
+        auto* dst = reinterpret_cast<__m256i*>(bl + i);
+        _mm256_storeu_si256(dst, _mm256_add_epi32(_mm256_loadu_si256(dst),
+                                     _mm256_mullo_epi32(s, vscale)));
+    }
+
+    R_AccumulateLightmapScalar(bl, samples, i, count, scale);
+}
+#endif
+
+static void R_AccumulateLightmap(quake::simd::Level level, unsigned* bl,
+    const byte* samples, int count, unsigned scale)
+{
+    switch(level)
+    {
+#if QUAKE_SIMD_X86
+        case quake::simd::Level::AVX2:
+            R_AccumulateLightmapAVX2(bl, samples, count, scale);
+            return;
+        case quake::simd::Level::SSE2:
+            R_AccumulateLightmapSSE2(bl, samples, count, scale);
+            return;
+#endif
+        default: R_AccumulateLightmapScalar(bl, samples, 0, count, scale);
+    }
+}
+
+/*
+===============
+R_StoreLightmap
+
+bound, shift and store one row of blocklights as RGBA or BGRA texels
+===============
+*/
+static void R_StoreLightmapScalar(const unsigned* bl, byte* dest, int j,
+    int smax, int shift, bool bgra)
+{
+    for(bl += j * 3, dest += j * 4; j < smax; j++, bl += 3, dest += 4)
+    {
+        const unsigned r = bl[0] >> shift;
+        const unsigned g = bl[1] >> shift;
+        const unsigned b = bl[2] >> shift;
+
+        dest[bgra ? 2 : 0] = (r > 255) ? 255 : r;
+        dest[1] = (g > 255) ? 255 : g;
+        dest[bgra ? 0 : 2] = (b > 255) ? 255 : b;
+        dest[3] = 255;
+    }
+}
+
+#if QUAKE_SIMD_X86
+// Shifts and saturates four texels, leaving them packed as 12 bytes of RGB.
+// After the logical shift every value fits in 25 bits, so the signed 32 to
+// 16 bit saturation can only clamp values that were above 255 anyway.
+[[nodiscard]] static __m128i R_PackLightmapTexels(
+    const unsigned* bl, const __m128i shift)
+{
+    const __m128i a = _mm_srl_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(bl)), shift);
+    const __m128i b = _mm_srl_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(bl + 4)), shift);
+    const __m128i c = _mm_srl_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(bl + 8)), shift);
+
+    return _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, c));
+}
+
+static void R_StoreLightmapSSE2(
+    const unsigned* bl, byte* dest, int smax, int shift, bool bgra)
+{
+    const __m128i vshift = _mm_cvtsi32_si128(shift);
+    const int rc = bgra ? 2 : 0;
+    const int bc = bgra ? 0 : 2;
+    int j = 0;
+
+    // no byte shuffles in SSE2, so only the clamping is vectorized
+    for(; j + 4 <= smax; j += 4)
+    {
+        alignas(16) byte rgb[16];
+        _mm_store_si128(reinterpret_cast<__m128i*>(rgb),
+            R_PackLightmapTexels(bl + j * 3, vshift));
+
+        for(int k = 0; k < 4; k++)
+        {
+            byte* texel = dest + (j + k) * 4;
+            texel[rc] = rgb[k * 3];
+            texel[1] = rgb[k * 3 + 1];
+            texel[bc] = rgb[k * 3 + 2];
+            texel[3] = 255;
+        }
+    }
+
+    R_StoreLightmapScalar(bl, dest, j, smax, shift, bgra);
+}
+
+QUAKE_TARGET_AVX2 static void R_StoreLightmapAVX2(
+    const unsigned* bl, byte* dest, int smax, int shift, bool bgra)
+{
+    const __m128i vshift = _mm_cvtsi32_si128(shift);
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+    const __m128i order =
+        bgra ? _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1)
+             : _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    int j = 0;
+
+    for(; j + 4 <= smax; j += 4)
+    {
+        const __m128i rgb = R_PackLightmapTexels(bl + j * 3, vshift);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + j * 4),
+            _mm_or_si128(_mm_shuffle_epi8(rgb, order), alpha));
+    }
+
+    R_StoreLightmapScalar(bl, dest, j, smax, shift, bgra);
+}
+#endif
+
+static void R_StoreLightmap(quake::simd::Level level, const unsigned* bl,
+    byte* dest, int smax, int shift, bool bgra)
+{
+    switch(level)
+    {
+#if QUAKE_SIMD_X86
+        case quake::simd::Level::AVX2:
+            R_StoreLightmapAVX2(bl, dest, smax, shift, bgra);
+            return;
+        case quake::simd::Level::SSE2:
+            R_StoreLightmapSSE2(bl, dest, smax, shift, bgra);
+            return;
+#endif
+        default: R_StoreLightmapScalar(bl, dest, 0, smax, shift, bgra);
+    }
+}
+
 /*
 ===============
 R_BuildLightMap -- johnfitz -- revised for lit support via lordhavoc
 
 Combine and scale multiple lightmaps into the 8.8 format in blocklights
+
+Safe to call from the job threads, as long as no two threads build the same
+surface. Never fails: the lightmap format is checked on the main thread, by
+GL_BuildLightmaps and before dispatching R_BuildDynamicLightmaps.
 ===============
 */
 void R_BuildLightMap(qmodel_t* model, msurface_t* surf, byte* dest, int stride)
 {
     int smax;
     int tmax;
-    int r;
-    int g;
-    int b;
     int i;
-    int j;
     int size;
     byte* lightmap;
     unsigned scale;
     int maps;
-    unsigned* bl;
+    unsigned* blocklights = R_BlockLights();
+    const quake::simd::Level level =
+        quake::simd::clampLevel(r_lightmap_simd.value);
 
     surf->cached_dlight = (surf->dlightframe == r_framecount);
 
@@ -1344,13 +1609,9 @@ void R_BuildLightMap(qmodel_t* model, msurface_t* surf, byte* dest, int stride)
                 scale = d_lightstylevalue[surf->styles[maps]];
                 surf->cached_light[maps] = scale; // 8.8 fraction
                 // johnfitz -- lit support via lordhavoc
-                bl = blocklights;
-                for(i = 0; i < size; i++)
-                {
-                    *bl++ += *lightmap++ * scale;
-                    *bl++ += *lightmap++ * scale;
-                    *bl++ += *lightmap++ * scale;
-                }
+                R_AccumulateLightmap(
+                    level, blocklights, lightmap, size * 3, scale);
+                lightmap += size * 3;
                 // johnfitz
             }
         }
@@ -1358,7 +1619,7 @@ void R_BuildLightMap(qmodel_t* model, msurface_t* surf, byte* dest, int stride)
         // add all the dynamic lights
         if(surf->dlightframe == r_framecount)
         {
-            R_AddDynamicLights(surf);
+            R_AddDynamicLights(surf, blocklights);
         }
     }
     else
@@ -1371,61 +1632,13 @@ void R_BuildLightMap(qmodel_t* model, msurface_t* surf, byte* dest, int stride)
 
     // bound, invert, and shift
     // store:
-    switch(gl_lightmap_format)
+    const int shift = gl_overbright.value ? 8 : 7;
+    const bool bgra = gl_lightmap_format == GL_BGRA;
+
+    for(i = 0; i < tmax; i++, dest += stride)
     {
-        case GL_RGBA:
-            stride -= smax * 4;
-            bl = blocklights;
-            for(i = 0; i < tmax; i++, dest += stride)
-            {
-                for(j = 0; j < smax; j++)
-                {
-                    if(gl_overbright.value)
-                    {
-                        r = *bl++ >> 8;
-                        g = *bl++ >> 8;
-                        b = *bl++ >> 8;
-                    }
-                    else
-                    {
-                        r = *bl++ >> 7;
-                        g = *bl++ >> 7;
-                        b = *bl++ >> 7;
-                    }
-                    *dest++ = (r > 255) ? 255 : r;
-                    *dest++ = (g > 255) ? 255 : g;
-                    *dest++ = (b > 255) ? 255 : b;
-                    *dest++ = 255;
-                }
-            }
-            break;
-        case GL_BGRA:
-            stride -= smax * 4;
-            bl = blocklights;
-            for(i = 0; i < tmax; i++, dest += stride)
-            {
-                for(j = 0; j < smax; j++)
-                {
-                    if(gl_overbright.value)
-                    {
-                        r = *bl++ >> 8;
-                        g = *bl++ >> 8;
-                        b = *bl++ >> 8;
-                    }
-                    else
-                    {
-                        r = *bl++ >> 7;
-                        g = *bl++ >> 7;
-                        b = *bl++ >> 7;
-                    }
-                    *dest++ = (b > 255) ? 255 : b;
-                    *dest++ = (g > 255) ? 255 : g;
-                    *dest++ = (r > 255) ? 255 : r;
-                    *dest++ = 255;
-                }
-            }
-            break;
-        default: Sys_Error("R_BuildLightMap: bad lightmap format");
+        R_StoreLightmap(
+            level, blocklights + i * smax * 3, dest, smax, shift, bgra);
     }
 }
 
@@ -1434,7 +1647,8 @@ void R_BuildLightMap(qmodel_t* model, msurface_t* surf, byte* dest, int stride)
 R_UploadLightmap -- johnfitz -- uploads the modified lightmap to opengl
 if necessary
 
-assumes lightmap texture is already bound
+assumes lightmap texture is already bound, and GL_UNPACK_ROW_LENGTH set to
+LMBLOCK_WIDTH
 ===============
 */
 static void R_UploadLightmap(int lmap)
@@ -1448,9 +1662,13 @@ static void R_UploadLightmap(int lmap)
 
     lm->modified = false;
 
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, lm->rectchange.t, LMBLOCK_WIDTH,
-        lm->rectchange.h, gl_lightmap_format, GL_UNSIGNED_BYTE,
-        lm->data + lm->rectchange.t * LMBLOCK_WIDTH * lightmap_bytes);
+    // only the modified rectangle; GL_UNPACK_ROW_LENGTH steps over the rest of
+    // each row of the page
+    glTexSubImage2D(GL_TEXTURE_2D, 0, lm->rectchange.l, lm->rectchange.t,
+        lm->rectchange.w, lm->rectchange.h, gl_lightmap_format,
+        GL_UNSIGNED_BYTE,
+        lm->data + (lm->rectchange.t * LMBLOCK_WIDTH + lm->rectchange.l) *
+                       lightmap_bytes);
     lm->rectchange.l = LMBLOCK_WIDTH;
     lm->rectchange.t = LMBLOCK_HEIGHT;
     lm->rectchange.h = 0;
@@ -1463,6 +1681,8 @@ void R_UploadLightmaps()
 {
     int lmap;
 
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, LMBLOCK_WIDTH);
+
     for(lmap = 0; lmap < lightmap_count; lmap++)
     {
         if(!lightmap[lmap].modified)
@@ -1473,6 +1693,8 @@ void R_UploadLightmaps()
         GL_Bind(lightmap[lmap].texture);
         R_UploadLightmap(lmap);
     }
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
 }
 
 /*
@@ -37,6 +37,9 @@ Foundation, Inc., 59 Temple Place - Suite 430, Boston, MA  02111-1307, USA.
 #include "zone.hpp"
 #include "client.hpp"
 #include "gl_texmgr.hpp"
+#include "jobs.hpp"
+#include "simd.hpp"
+#include "cl_bench.hpp"
 
 
 #include <algorithm>
@@ -44,6 +47,7 @@ Foundation, Inc., 59 Temple Place - Suite 430, Boston, MA  02111-1307, USA.
 #include <string_view>
 #include <utility>
 #include <array>
+#include <vector>
 
 #define MAX_PARTICLES 4096 * 100 // default max # of particles at once
 // time, per texture (TODO VR: (P2) should it be per texture?, cvar)
@@ -81,24 +85,95 @@ enum ptype_t : std::uint8_t
     pt_txbigsmoke,
 };
 
+// Every particle attribute lives in its own stream, including each axis of
+// origin, velocity and acceleration, so the update kernels below can process
+// several particles per SIMD instruction.
 struct ParticleSOA
 {
-    struct Data
-    {
-        float _ramp;
-        float _die;
-        ptype_t _type;
-        std::uint8_t _param0;
-    };
-
-    qvec3* _orgs;
-    qvec3* _vels;
-    qvec3* _accs;
-    qvec4* _colors;
+    float* _org[3];
+    float* _vel[3];
+    float* _acc[3];
+    qvec3* _colors;
+    float* _alphas;
     float* _angles;
     float* _scales;
+    float* _ramps;
+    float* _dies;
     int* _atlasIdxs;
-    Data* _datas;
+    ptype_t* _types;
+    std::uint8_t* _params0;
+
+    template <typename F>
+    void forEachStream(F&& f)
+    {
+        f(_org[0], "psoa_orgx");
+        f(_org[1], "psoa_orgy");
+        f(_org[2], "psoa_orgz");
+        f(_vel[0], "psoa_velx");
+        f(_vel[1], "psoa_vely");
+        f(_vel[2], "psoa_velz");
+        f(_acc[0], "psoa_accx");
+        f(_acc[1], "psoa_accy");
+        f(_acc[2], "psoa_accz");
+        f(_colors, "psoa_colors");
+        f(_alphas, "psoa_alphas");
+        f(_angles, "psoa_angles");
+        f(_scales, "psoa_scales");
+        f(_ramps, "psoa_ramps");
+        f(_dies, "psoa_dies");
+        f(_atlasIdxs, "psoa_atlasIdxs");
+        f(_types, "psoa_types");
+        f(_params0, "psoa_params0");
+    }
+};
+
+// Reference to one particle's origin, velocity or acceleration, spread over
+// three streams. Behaves like a `qvec3&` for the particle setup code.
+class ParticleVec3Ref
+{
+private:
+    float* _x;
+    float* _y;
+    float* _z;
+
+public:
+    QUAKE_FORCEINLINE ParticleVec3Ref(
+        float* const* streams, const std::size_t idx) noexcept
+        : _x{streams[0] + idx}, _y{streams[1] + idx}, _z{streams[2] + idx}
+    {
+    }
+
+    [[nodiscard]] QUAKE_FORCEINLINE float& operator[](const int i) noexcept
+    {
+        return i == 0 ? *_x : i == 1 ? *_y : *_z;
+    }
+
+    [[nodiscard]] QUAKE_FORCEINLINE operator qvec3() const noexcept
+    {
+        return {*_x, *_y, *_z};
+    }
+
+    QUAKE_FORCEINLINE ParticleVec3Ref& operator=(const qvec3& v) noexcept
+    {
+        *_x = v[0];
+        *_y = v[1];
+        *_z = v[2];
+        return *this;
+    }
+
+    QUAKE_FORCEINLINE ParticleVec3Ref& operator+=(const qvec3& v) noexcept
+    {
+        *_x += v[0];
+        *_y += v[1];
+        *_z += v[2];
+        return *this;
+    }
+
+    [[nodiscard]] QUAKE_FORCEINLINE qvec3 operator*(
+        const float x) const noexcept
+    {
+        return qvec3{*_x, *_y, *_z} * x;
+    }
 };
 
 struct ParticleHandleSOA
@@ -106,37 +181,36 @@ struct ParticleHandleSOA
     ParticleSOA* _soa;
     std::size_t _idx;
 
-    [[nodiscard]] QUAKE_FORCEINLINE qvec3& org() noexcept
+    [[nodiscard]] QUAKE_FORCEINLINE ParticleVec3Ref org() noexcept
     {
-        return _soa->_orgs[_idx];
+        return {_soa->_org, _idx};
     }
 
-    [[nodiscard]] QUAKE_FORCEINLINE qvec3& vel() noexcept
+    [[nodiscard]] QUAKE_FORCEINLINE ParticleVec3Ref vel() noexcept
     {
-        return _soa->_vels[_idx];
+        return {_soa->_vel, _idx};
     }
 
-    [[nodiscard]] QUAKE_FORCEINLINE qvec3& acc() noexcept
+    [[nodiscard]] QUAKE_FORCEINLINE ParticleVec3Ref acc() noexcept
     {
-        return _soa->_accs[_idx];
+        return {_soa->_acc, _idx};
     }
 
     QUAKE_FORCEINLINE void setColor(const float x) noexcept
     {
         GLubyte* c = (GLubyte*)&d_8to24table[(int)x];
 
-        _soa->_colors[_idx].rgb =
-            qvec3{c[0] / 255.f, c[1] / 255.f, c[2] / 255.f};
+        _soa->_colors[_idx] = qvec3{c[0] / 255.f, c[1] / 255.f, c[2] / 255.f};
     }
 
     [[nodiscard]] QUAKE_FORCEINLINE float& ramp() noexcept
     {
-        return _soa->_datas[_idx]._ramp;
+        return _soa->_ramps[_idx];
     }
 
     [[nodiscard]] QUAKE_FORCEINLINE float& die() noexcept
     {
-        return _soa->_datas[_idx]._die;
+        return _soa->_dies[_idx];
     }
 
     [[nodiscard]] QUAKE_FORCEINLINE float& scale() noexcept
@@ -146,12 +220,12 @@ struct ParticleHandleSOA
 
     QUAKE_FORCEINLINE void setAlpha(const float x) noexcept
     {
-        _soa->_colors[_idx].a = x / 255.f;
+        _soa->_alphas[_idx] = x / 255.f;
     }
 
     QUAKE_FORCEINLINE void addAlpha(const float x, const float ft) noexcept
     {
-        _soa->_colors[_idx].a += (x / 255.f) * ft;
+        _soa->_alphas[_idx] += (x / 255.f) * ft;
     }
 
     [[nodiscard]] QUAKE_FORCEINLINE float& angle() noexcept
@@ -166,12 +240,12 @@ struct ParticleHandleSOA
 
     [[nodiscard]] QUAKE_FORCEINLINE ptype_t& type() noexcept
     {
-        return _soa->_datas[_idx]._type;
+        return _soa->_types[_idx];
     }
 
     [[nodiscard]] QUAKE_FORCEINLINE std::uint8_t& param0() noexcept
     {
-        return _soa->_datas[_idx]._param0;
+        return _soa->_params0[_idx];
     }
 };
 
@@ -211,12 +285,47 @@ template <class UnaryPredicate, class F>
     return first;
 }
 
+// Particles per job when updating or compacting a buffer in parallel.
+constexpr std::size_t particleChunkSize = 4096;
+
+extern cvar_t r_particles_mt;
+
 class ParticleBufferSOA
 {
 private:
     ParticleSOA _pSOA;
     std::size_t _aliveCount;
     std::size_t _maxParticles;
+    std::vector<std::size_t> _chunkAliveCounts;
+
+    // Compacts `[first, last)` in place, returns the number of survivors.
+    [[nodiscard]] std::size_t cleanupRange(
+        const std::size_t first, const std::size_t last) noexcept
+    {
+        const std::size_t newLast = index_remove_if(
+            first, last,
+            [&](const std::size_t i) {
+                return _pSOA._alphas[i] <= 0.f    //
+                       || _pSOA._scales[i] <= 0.f //
+                       || cl.time >= _pSOA._dies[i];
+            },
+            [&](const std::size_t targetIdx, const std::size_t srcIdx) {
+                _pSOA.forEachStream([&](auto* field, const char*) {
+                    field[targetIdx] = std::move(field[srcIdx]);
+                });
+            });
+
+        return newLast - first;
+    }
+
+    // Moves `n` particles from `srcIdx` down to `targetIdx <= srcIdx`.
+    void moveRange(const std::size_t srcIdx, const std::size_t n,
+        const std::size_t targetIdx) noexcept
+    {
+        _pSOA.forEachStream([&](auto* field, const char*) {
+            std::move(field + srcIdx, field + srcIdx + n, field + targetIdx);
+        });
+    }
 
 public:
     void initialize(const std::size_t maxParticles) noexcept
@@ -224,41 +333,53 @@ public:
         _aliveCount = 0;
         _maxParticles = maxParticles;
 
-        const auto alloc = [&](auto& field, const char* name) {
+        _pSOA.forEachStream([&](auto*& field, const char* name) {
             using Type = std::remove_pointer_t<std::decay_t<decltype(field)>>;
             field = Hunk_AllocName<Type>(_maxParticles, name);
-        };
-
-        alloc(_pSOA._orgs, "psoa_orgs");
-        alloc(_pSOA._vels, "psoa_vels");
-        alloc(_pSOA._accs, "psoa_accs");
-        alloc(_pSOA._colors, "psoa_colors");
-        alloc(_pSOA._angles, "psoa_angles");
-        alloc(_pSOA._scales, "psoa_scales");
-        alloc(_pSOA._atlasIdxs, "psoa_atlasIdxs");
-        alloc(_pSOA._datas, "psoa_datas");
+        });
     }
 
     void cleanup() noexcept
     {
-        _aliveCount = index_remove_if(
-            0, _aliveCount,
-            [&](const std::size_t i) {
-                return _pSOA._colors[i].a <= 0.f  //
-                       || _pSOA._scales[i] <= 0.f //
-                       || cl.time >= _pSOA._datas[i]._die;
-            },
-            [&](const std::size_t targetIdx, const std::size_t srcIdx) {
-                _pSOA._orgs[targetIdx] = std::move(_pSOA._orgs[srcIdx]);
-                _pSOA._vels[targetIdx] = std::move(_pSOA._vels[srcIdx]);
-                _pSOA._accs[targetIdx] = std::move(_pSOA._accs[srcIdx]);
-                _pSOA._colors[targetIdx] = std::move(_pSOA._colors[srcIdx]);
-                _pSOA._angles[targetIdx] = std::move(_pSOA._angles[srcIdx]);
-                _pSOA._scales[targetIdx] = std::move(_pSOA._scales[srcIdx]);
-                _pSOA._atlasIdxs[targetIdx] =
-                    std::move(_pSOA._atlasIdxs[srcIdx]);
-                _pSOA._datas[targetIdx] = std::move(_pSOA._datas[srcIdx]);
+        if(!r_particles_mt.value)
+        {
+            _aliveCount = cleanupRange(0, _aliveCount);
+            return;
+        }
+
+        // Every chunk compacts itself in parallel, then the surviving runs
+        // are slid down in chunk order. The result is identical to a single
+        // serial pass, so particle order stays deterministic.
+        const std::size_t numChunks =
+            (_aliveCount + particleChunkSize - 1) / particleChunkSize;
+
+        _chunkAliveCounts.resize(numChunks);
+
+        quake::jobs::parallelFor(numChunks, 1,
+            [&](const std::size_t begin, const std::size_t end) {
+                for(std::size_t c = begin; c < end; ++c)
+                {
+                    const std::size_t first = c * particleChunkSize;
+                    const std::size_t last =
+                        std::min(first + particleChunkSize, _aliveCount);
+
+                    _chunkAliveCounts[c] = cleanupRange(first, last);
+                }
             });
+
+        std::size_t targetIdx = 0;
+        for(std::size_t c = 0; c < numChunks; ++c)
+        {
+            const std::size_t first = c * particleChunkSize;
+            if(targetIdx != first)
+            {
+                moveRange(first, _chunkAliveCounts[c], targetIdx);
+            }
+
+            targetIdx += _chunkAliveCounts[c];
+        }
+
+        _aliveCount = targetIdx;
     }
 
     [[nodiscard]] QUAKE_FORCEINLINE ParticleHandleSOA create() noexcept
@@ -269,7 +390,14 @@ public:
     template <typename F>
     QUAKE_FORCEINLINE void forActive(F&& f) noexcept
     {
-        for(std::size_t i = 0; i < _aliveCount; ++i)
+        forActiveRange(0, _aliveCount, f);
+    }
+
+    template <typename F>
+    QUAKE_FORCEINLINE void forActiveRange(
+        const std::size_t begin, const std::size_t end, F&& f) noexcept
+    {
+        for(std::size_t i = begin; i < end; ++i)
         {
             f(ParticleHandleSOA{&_pSOA, i});
         }
@@ -534,6 +662,8 @@ std::mt19937 mt(rd());
 
 cvar_t r_particles = {"r_particles", "1", CVAR_ARCHIVE}; // johnfitz
 cvar_t r_particle_mult = {"r_particle_mult", "1", CVAR_ARCHIVE};
+cvar_t r_particles_mt = {"r_particles_mt", "1", CVAR_ARCHIVE};
+cvar_t r_particles_simd = {"r_particles_simd", "2", CVAR_ARCHIVE};
 
 template <typename F>
 QUAKE_FORCEINLINE void makeNParticlesI(
@@ -589,10 +719,26 @@ constexpr int aiGunSmoke = 10;
 template <typename F>
 QUAKE_FORCEINLINE void forActiveParticles(F&& f) noexcept
 {
-    // TODO VR: (P2) parallelize with thread pool
     pMgr.forActive(std::forward<F>(f));
 }
 
+// Splits every buffer into chunks of `particleChunkSize` that are processed
+// on the job system. `f(pBuffer, begin, end)` must only touch the particles
+// in `[begin, end)`.
+template <typename F>
+QUAKE_FORCEINLINE void forActiveParticleRangesParallel(F&& f) noexcept
+{
+    pMgr.forBuffers([&](gltexture_t*, const ImageData&, PBuffer& pBuffer) {
+        const std::size_t pCount = pBuffer.aliveCount();
+
+        quake::jobs::parallelFor(pCount,
+            r_particles_mt.value ? particleChunkSize : pCount,
+            [&](const std::size_t begin, const std::size_t end) {
+                f(pBuffer, begin, end);
+            });
+    });
+}
+
 /*
 ===============
 R_ParticleTextureLookup -- johnfitz -- generate nice antialiased 32x32 circle
@@ -756,6 +902,8 @@ static void R_InitParticleCVars()
 {
     Cvar_RegisterVariable(&r_particles); // johnfitz
     Cvar_RegisterVariable(&r_particle_mult);
+    Cvar_RegisterVariable(&r_particles_mt);
+    Cvar_RegisterVariable(&r_particles_simd);
 }
 
 /*
@@ -828,6 +976,18 @@ void R_EntityParticles(entity_t* ent)
     }
 }
 
+/*
+===============
+R_SeedParticles
+
+makes the particle effects repeatable, for benchmarks
+===============
+*/
+void R_SeedParticles(unsigned int seed)
+{
+    mt.seed(seed);
+}
+
 /*
 ===============
 R_ClearParticles
@@ -1947,6 +2107,206 @@ void R_RocketTrail(qvec3 start, const qvec3& end, int type)
     }
 }
 
+//
+// Particle update kernels. Every kernel has a scalar version and x86 SSE2
+// and AVX2 versions producing identical results; `r_particles_simd` caps
+// which one is used (0 scalar, 1 SSE2, 2 AVX2).
+//
+
+// Per-type fade rates: alpha (in 0..1 units) and scale change per second.
+struct ParticleFadeRates
+{
+    std::array<float, 256> alpha{};
+    std::array<float, 256> scale{};
+
+    constexpr ParticleFadeRates() noexcept
+    {
+        const auto set = [&](const ptype_t type, const float a, const float s) {
+            alpha[type] = a / 255.f;
+            scale[type] = s;
+        };
+
+        set(pt_txexplode, -345.f, 135.f);
+        set(pt_txsmoke, -70.f, 47.f);
+        set(pt_txbigsmoke, -35.f, 37.f);
+        set(pt_lightning, -84.f, -32.f);
+        set(pt_teleport, -85.f, -0.1f);
+        set(pt_gunsmoke, -110.f, 69.f);
+        set(pt_gunpickup, -120.f, -0.2f);
+    }
+};
+
+constexpr ParticleFadeRates particleFadeRates{};
+
+static void integrateParticlesScalar(ParticleSOA& soa, const std::size_t begin,
+    const std::size_t end, const float dt) noexcept
+{
+    for(int a = 0; a < 3; ++a)
+    {
+        float* const org = soa._org[a];
+        float* const vel = soa._vel[a];
+        const float* const acc = soa._acc[a];
+
+        for(std::size_t i = begin; i < end; ++i)
+        {
+            vel[i] += acc[i] * dt;
+            org[i] += vel[i] * dt;
+        }
+    }
+}
+
+static void fadeParticlesScalar(ParticleSOA& soa, const std::size_t begin,
+    const std::size_t end, const float dt) noexcept
+{
+    for(std::size_t i = begin; i < end; ++i)
+    {
+        soa._alphas[i] += particleFadeRates.alpha[soa._types[i]] * dt;
+        soa._scales[i] += particleFadeRates.scale[soa._types[i]] * dt;
+    }
+}
+
+#if QUAKE_SIMD_X86
+static void integrateParticlesSSE2(ParticleSOA& soa, const std::size_t begin,
+    const std::size_t end, const float dt) noexcept
+{
+    const __m128 vdt = _mm_set1_ps(dt);
+    const std::size_t simdEnd = begin + ((end - begin) & ~std::size_t(3));
+
+    for(int a = 0; a < 3; ++a)
+    {
+        float* const org = soa._org[a];
+        float* const vel = soa._vel[a];
+        const float* const acc = soa._acc[a];
+
+        for(std::size_t i = begin; i < simdEnd; i += 4)
+        {
+            const __m128 v = _mm_add_ps(_mm_loadu_ps(vel + i),
+                _mm_mul_ps(_mm_loadu_ps(acc + i), vdt));
+            _mm_storeu_ps(vel + i, v);
+            _mm_storeu_ps(org + i,
+                _mm_add_ps(_mm_loadu_ps(org + i), _mm_mul_ps(v, vdt)));
+        }
+    }
+
+    integrateParticlesScalar(soa, simdEnd, end, dt);
+}
+
+static void fadeParticlesSSE2(ParticleSOA& soa, const std::size_t begin,
+    const std::size_t end, const float dt) noexcept
+{
+    const __m128 vdt = _mm_set1_ps(dt);
+    const std::size_t simdEnd = begin + ((end - begin) & ~std::size_t(3));
+
+    const float* const ar = particleFadeRates.alpha.data();
+    const float* const sr = particleFadeRates.scale.data();
+    const ptype_t* const t = soa._types;
+
+    for(std::size_t i = begin; i < simdEnd; i += 4)
+    {
+        const __m128 alphaRate =
+            _mm_setr_ps(ar[t[i]], ar[t[i + 1]], ar[t[i + 2]], ar[t[i + 3]]);
+        const __m128 scaleRate =
+            _mm_setr_ps(sr[t[i]], sr[t[i + 1]], sr[t[i + 2]], sr[t[i + 3]]);
+
+        _mm_storeu_ps(soa._alphas + i, _mm_add_ps(_mm_loadu_ps(soa._alphas + i),
+                                           _mm_mul_ps(alphaRate, vdt)));
+        _mm_storeu_ps(soa._scales + i, _mm_add_ps(_mm_loadu_ps(soa._scales + i),
+                                           _mm_mul_ps(scaleRate, vdt)));
+    }
+
+    fadeParticlesScalar(soa, simdEnd, end, dt);
+}
+
+QUAKE_TARGET_AVX2 static void integrateParticlesAVX2(ParticleSOA& soa,
+    const std::size_t begin, const std::size_t end, const float dt) noexcept
+{
+    const __m256 vdt = _mm256_set1_ps(dt);
+    const std::size_t simdEnd = begin + ((end - begin) & ~std::size_t(7));
+
+    for(int a = 0; a < 3; ++a)
+    {
+        float* const org = soa._org[a];
+        float* const vel = soa._vel[a];
+        const float* const acc = soa._acc[a];
+
+        for(std::size_t i = begin; i < simdEnd; i += 8)
+        {
+            const __m256 v = _mm256_add_ps(_mm256_loadu_ps(vel + i),
+                _mm256_mul_ps(_mm256_loadu_ps(acc + i), vdt));
+            _mm256_storeu_ps(vel + i, v);
+            _mm256_storeu_ps(org + i,
+                _mm256_add_ps(_mm256_loadu_ps(org + i), _mm256_mul_ps(v, vdt)));
+        }
+    }
+
+    integrateParticlesScalar(soa, simdEnd, end, dt);
+}
+
+QUAKE_TARGET_AVX2 static void fadeParticlesAVX2(ParticleSOA& soa,
+    const std::size_t begin, const std::size_t end, const float dt) noexcept
+{
+    const __m256 vdt = _mm256_set1_ps(dt);
+    const std::size_t simdEnd = begin + ((end - begin) & ~std::size_t(7));
+
+    for(std::size_t i = begin; i < simdEnd; i += 8)
+    {
+        const __m256i types = _mm256_cvtepu8_epi32(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(soa._types + i)));
+
+        const __m256 alphaRate =
+            _mm256_i32gather_ps(particleFadeRates.alpha.data(), types, 4);
+        const __m256 scaleRate =
+            _mm256_i32gather_ps(particleFadeRates.scale.data(), types, 4);
+
+        _mm256_storeu_ps(soa._alphas + i,
+            _mm256_add_ps(_mm256_loadu_ps(soa._alphas + i),
+                _mm256_mul_ps(alphaRate, vdt)));
+        _mm256_storeu_ps(soa._scales + i,
+            _mm256_add_ps(_mm256_loadu_ps(soa._scales + i),
+                _mm256_mul_ps(scaleRate, vdt)));
+    }
+
+    fadeParticlesScalar(soa, simdEnd, end, dt);
+}
+#endif
+
+// Applies acceleration (gravity) to velocity and velocity to origin.
+static void integrateParticles(const quake::simd::Level level,
+    ParticleSOA& soa, const std::size_t begin, const std::size_t end,
+    const float dt) noexcept
+{
+    switch(level)
+    {
+#if QUAKE_SIMD_X86
+        case quake::simd::Level::AVX2:
+            integrateParticlesAVX2(soa, begin, end, dt);
+            return;
+        case quake::simd::Level::SSE2:
+            integrateParticlesSSE2(soa, begin, end, dt);
+            return;
+#endif
+        default: integrateParticlesScalar(soa, begin, end, dt); return;
+    }
+}
+
+// Applies the per-type alpha and scale fade.
+static void fadeParticles(const quake::simd::Level level, ParticleSOA& soa,
+    const std::size_t begin, const std::size_t end, const float dt) noexcept
+{
+    switch(level)
+    {
+#if QUAKE_SIMD_X86
+        case quake::simd::Level::AVX2:
+            fadeParticlesAVX2(soa, begin, end, dt);
+            return;
+        case quake::simd::Level::SSE2:
+            fadeParticlesSSE2(soa, begin, end, dt);
+            return;
+#endif
+        default: fadeParticlesScalar(soa, begin, end, dt); return;
+    }
+}
+
 /*
 ===============
 CL_RunParticles -- johnfitz -- all the particle behavior, separated from
@@ -1955,8 +2315,12 @@ R_DrawParticles
 */
 void CL_RunParticles()
 {
+    const quake::bench::Timer benchTimer =
+        quake::clbench::startTimer(quake::clbench::Phase::Particles);
+
     if(!r_particles.value)
     {
+        quake::clbench::stopTimer(benchTimer);
         return;
     }
 
@@ -1969,18 +2333,7 @@ void CL_RunParticles()
 
     pMgr.cleanup();
 
-    pMgr.forBuffers([&](gltexture_t*, const ImageData&, PBuffer& pBuffer) {
-        ParticleSOA& soa = pBuffer.soa();
-        const auto pCount = pBuffer.aliveCount();
-
-        for(std::size_t i = 0; i < pCount; ++i)
-        {
-            soa._vels[i] += soa._accs[i] * frametime;
-            soa._orgs[i] += soa._vels[i] * frametime;
-        }
-    });
-
-    forActiveParticles([&](PHandle p) {
+    const auto updateParticle = [&](PHandle p) {
         switch(p.type())
         {
             case pt_static:
@@ -2064,45 +2417,11 @@ void CL_RunParticles()
 
             case pt_txexplode:
             {
-                p.addAlpha(-345.f, frametime);
-                p.scale() += 135.f * frametime;
                 p.angle() += 0.75f * frametime * (p.param0() == 0 ? 1.f : -1.f);
 
                 break;
             }
 
-            case pt_txsmoke:
-            {
-                p.addAlpha(-70.f, frametime);
-                p.scale() += 47.f * frametime;
-
-                break;
-            }
-
-            case pt_txbigsmoke:
-            {
-                p.addAlpha(-35.f, frametime);
-                p.scale() += 37.f * frametime;
-
-                break;
-            }
-
-            case pt_lightning:
-            {
-                p.addAlpha(-84.f, frametime);
-                p.scale() -= 32.f * frametime;
-
-                break;
-            }
-
-            case pt_teleport:
-            {
-                p.addAlpha(-85.f, frametime);
-                p.scale() -= 0.1f * frametime;
-
-                break;
-            }
-
             case pt_rock:
             {
                 p.angle() += 25.f * frametime * (p.param0() == 0 ? 1.f : -1.f);
@@ -2112,27 +2431,32 @@ void CL_RunParticles()
 
             case pt_gunsmoke:
             {
-                p.addAlpha(-110.f, frametime);
-                p.scale() += 69.f * frametime;
                 p.org()[2] += 18.f * frametime;
 
                 break;
             }
 
-            case pt_gunpickup:
-            {
-                p.addAlpha(-120.f, frametime);
-                p.scale() -= 0.2f * frametime;
-
-                break;
-            }
-
             default:
             {
                 break;
             }
         }
-    });
+    };
+
+    const quake::simd::Level simdLevel =
+        quake::simd::clampLevel(r_particles_simd.value);
+
+    // Particles are independent of each other, so integration and the
+    // per-type update run in parallel chunks.
+    forActiveParticleRangesParallel(
+        [&](PBuffer& pBuffer, const std::size_t begin, const std::size_t end) {
+            ParticleSOA& soa = pBuffer.soa();
+
+            integrateParticles(simdLevel, soa, begin, end, frametime);
+            fadeParticles(simdLevel, soa, begin, end, frametime);
+            pBuffer.forActiveRange(begin, end, updateParticle);
+        });
+    quake::clbench::stopTimer(benchTimer);
 }
 
 static GLuint makeParticleShaders()
@@ -2142,11 +2466,14 @@ static GLuint makeParticleShaders()
     constexpr auto vertexShader = R"glsl(
 #version 430 core
 
-layout(location = 0) in vec3  pOrg;
+layout(location = 0) in float pOrgX;
 layout(location = 1) in float pAngle;
 layout(location = 2) in float pScale;
-layout(location = 3) in vec4  pColor;
+layout(location = 3) in vec3  pColor;
 layout(location = 4) in int   pAtlasIdx;
+layout(location = 5) in float pOrgY;
+layout(location = 6) in float pOrgZ;
+layout(location = 7) in float pAlpha;
 
 out VS_OUT {
     float opAngle;
@@ -2157,10 +2484,10 @@ out VS_OUT {
 
 void main()
 {
-    gl_Position = vec4(pOrg, 1.0);
+    gl_Position = vec4(pOrgX, pOrgY, pOrgZ, 1.0);
     vs_out.opAngle = pAngle;
     vs_out.opScale = pScale;
-    vs_out.opColor = pColor;
+    vs_out.opColor = vec4(pColor, pAlpha);
     vs_out.opAtlasIdx = pAtlasIdx;
 }
 )glsl"sv;
@@ -2298,11 +2625,15 @@ void R_DrawParticles()
     static GLuint pScaleVboId;
     static GLuint pColorVboId;
     static GLuint pAtlasIdxVboId;
+    static GLuint pAlphaVboId;
 
-    static GLint pOrgLocation;
+    static GLint pOrgXLocation;
+    static GLint pOrgYLocation;
+    static GLint pOrgZLocation;
     static GLint pAngleLocation;
     static GLint pScaleLocation;
     static GLint pColorLocation;
+    static GLint pAlphaLocation;
     static GLint pAtlasIdxLocation;
     static GLint rOriginLocation;
     static GLint rUpLocation;
@@ -2322,12 +2653,16 @@ void R_DrawParticles()
         glGenBuffers(1, &pScaleVboId);
         glGenBuffers(1, &pColorVboId);
         glGenBuffers(1, &pAtlasIdxVboId);
+        glGenBuffers(1, &pAlphaVboId);
 
-        pOrgLocation = 0;
+        pOrgXLocation = 0;
         pAngleLocation = 1;
         pScaleLocation = 2;
         pColorLocation = 3;
         pAtlasIdxLocation = 4;
+        pOrgYLocation = 5;
+        pOrgZLocation = 6;
+        pAlphaLocation = 7;
         rOriginLocation = 5;
         rUpLocation = 6;
         rRightLocation = 7;
@@ -2354,10 +2689,13 @@ void R_DrawParticles()
 
     glBindVertexArray(vaoId);
 
-    glEnableVertexAttribArray(pOrgLocation);
+    glEnableVertexAttribArray(pOrgXLocation);
+    glEnableVertexAttribArray(pOrgYLocation);
+    glEnableVertexAttribArray(pOrgZLocation);
     glEnableVertexAttribArray(pAngleLocation);
     glEnableVertexAttribArray(pScaleLocation);
     glEnableVertexAttribArray(pColorLocation);
+    glEnableVertexAttribArray(pAlphaLocation);
     glEnableVertexAttribArray(pAtlasIdxLocation);
 
     glUniform3f(         //
@@ -2410,17 +2748,29 @@ void R_DrawParticles()
         //
         // Setup
 
+        // The three origin streams go back to back in one buffer.
+        const auto orgStreamSize = sizeof(float) * pCount;
+
         glBindBuffer(GL_ARRAY_BUFFER, pOrgVboId);
         glBufferData(
-            GL_ARRAY_BUFFER, sizeof(qvec3) * pCount, soa._orgs, GL_STATIC_DRAW);
-        glVertexAttribPointer( //
-            pOrgLocation,      // location
-            3,                 // number of components (vec3 = 3)
-            GL_FLOAT,          // type of each component
-            GL_FALSE,          // normalized
-            0,                 // stride
-            (void*)0           // array buffer offset
-        );
+            GL_ARRAY_BUFFER, orgStreamSize * 3, nullptr, GL_STATIC_DRAW);
+
+        const GLint orgLocations[3]{
+            pOrgXLocation, pOrgYLocation, pOrgZLocation};
+
+        for(int a = 0; a < 3; ++a)
+        {
+            glBufferSubData(GL_ARRAY_BUFFER, orgStreamSize * a, orgStreamSize,
+                soa._org[a]);
+            glVertexAttribPointer(         //
+                orgLocations[a],           // location
+                1,                         // number of components
+                GL_FLOAT,                  // type of each component
+                GL_FALSE,                  // normalized
+                0,                         // stride
+                (void*)(orgStreamSize * a) // array buffer offset
+            );
+        }
 
         glBindBuffer(GL_ARRAY_BUFFER, pAngleVboId);
         glBufferData(GL_ARRAY_BUFFER, sizeof(float) * pCount, soa._angles,
@@ -2447,11 +2797,23 @@ void R_DrawParticles()
         );
 
         glBindBuffer(GL_ARRAY_BUFFER, pColorVboId);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(qvec4) * pCount, soa._colors,
+        glBufferData(GL_ARRAY_BUFFER, sizeof(qvec3) * pCount, soa._colors,
             GL_STATIC_DRAW);
         glVertexAttribPointer( //
             pColorLocation,    // location
-            4,                 // number of components
+            3,                 // number of components
+            GL_FLOAT,          // type of each component
+            GL_FALSE,          // normalized
+            0,                 // stride
+            (void*)0           // array buffer offset
+        );
+
+        glBindBuffer(GL_ARRAY_BUFFER, pAlphaVboId);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * pCount, soa._alphas,
+            GL_STATIC_DRAW);
+        glVertexAttribPointer( //
+            pAlphaLocation,    // location
+            1,                 // number of components
             GL_FLOAT,          // type of each component
             GL_FALSE,          // normalized
             0,                 // stride
@@ -2484,10 +2846,13 @@ void R_DrawParticles()
     //
     // Cleanup
     glDisableVertexAttribArray(pAtlasIdxLocation);
+    glDisableVertexAttribArray(pAlphaLocation);
     glDisableVertexAttribArray(pColorLocation);
     glDisableVertexAttribArray(pScaleLocation);
     glDisableVertexAttribArray(pAngleLocation);
-    glDisableVertexAttribArray(pOrgLocation);
+    glDisableVertexAttribArray(pOrgZLocation);
+    glDisableVertexAttribArray(pOrgYLocation);
+    glDisableVertexAttribArray(pOrgXLocation);
 
     glBindVertexArray(0);
 
@@ -306,6 +306,9 @@ R_BuildLightmapChains -- johnfitz -- used for r_lightmap 1
 
 ericw -- now always used at the start of R_DrawTextureChains for the
 mh dynamic lighting speedup
+
+the lightmaps that need rebuilding are collected first and then built
+together on the job threads
 ================
 */
 void R_BuildLightmapChains(qmodel_t* model, texchain_t chain)
@@ -331,10 +334,12 @@ void R_BuildLightmapChains(qmodel_t* model, texchain_t chain)
         {
             if(!s->culled)
             {
-                R_RenderDynamicLightmaps(model, s);
+                R_RenderDynamicLightmaps(s);
             }
         }
     }
+
+    R_BuildDynamicLightmaps(model);
 }
 
 //==============================================================================
@@ -1,14 +1,20 @@
 #include "saveutil.hpp"
 
 #include "quakedef_macros.hpp"
+#include "quakedef.hpp"
 #include "q_stdinc.hpp"
 #include "common.hpp"
 #include "console.hpp"
 #include "vr_cvars.hpp"
 #include "host.hpp"
+#include "qcvm.hpp"
+#include "protocol.hpp"
 
 #include <algorithm>
 #include <cassert>
+#include <cstdarg>
+#include <future>
+#include <iterator>
 
 namespace quake::saveutil
 {
@@ -85,8 +91,28 @@ namespace quake::saveutil
     return res;
 }
 
+[[nodiscard]] static std::string& scannedGamedir() noexcept
+{
+    static std::string res;
+    return res;
+}
+
+// `scanSaves` parses timestamps with `mktime` from the UTC text written by
+// `captureSaveSnapshot`; this converts a fresh timestamp the same way so that
+// in-memory and scanned slots compare consistently.
+[[nodiscard]] static std::time_t toScannedTimestamp(
+    const std::time_t& t) noexcept
+{
+    std::tm tm = *std::gmtime(&t);
+    tm.tm_isdst = 0;
+    return std::mktime(&tm);
+}
+
 void scanSaves()
 {
+    finishPendingSave();
+    scannedGamedir() = com_gamedir;
+
     const auto doScan = [&](auto& filenamesArray, auto& loadableArray,
                             const int max, const char* naming,
                             const char* unusedSlot,
@@ -159,7 +185,12 @@ void scanSaves()
 
 [[nodiscard]] static int getNextAutosaveSlot() noexcept
 {
-    scanSaves();
+    // The slot table is kept up to date by `reportPendingSave`, so only scan
+    // the save files the first time or after a gamedir change.
+    if(scannedGamedir() != com_gamedir)
+    {
+        scanSaves();
+    }
 
     for(std::size_t i = 0; i < MAX_AUTOSAVES; ++i)
     {
@@ -179,8 +210,409 @@ void scanSaves()
     return it - std::begin(autosaveTimestamps());
 }
 
+void captureSaveSnapshot(
+    SaveSnapshot& out, const std::time_t* timestamp, const char* comment)
+{
+    out.hasTimestamp = timestamp != nullptr;
+    out.timestamp = timestamp != nullptr ? *timestamp : std::time_t{};
+    q_strlcpy(out.comment, comment, sizeof(out.comment));
+
+    std::copy(std::begin(svs.clients->spawn_parms),
+        std::end(svs.clients->spawn_parms), std::begin(out.spawnParms));
+
+    out.skill = current_skill;
+    out.mapName = sv.name;
+    out.time = qcvm->time;
+
+    out.lightStyles.clear();
+    for(int i = 0; i < MAX_LIGHTSTYLES; i++)
+    {
+        out.lightStyles.emplace_back(
+            sv.lightstyles[i] ? sv.lightstyles[i] : "");
+    }
+
+    out.precaches.clear();
+    const auto capturePrecaches = [&](const char* kind, const char** list,
+                                      const int max) {
+        for(int i = 1; i < max; i++)
+        {
+            if(list[i])
+            {
+                out.precaches.push_back({kind, i, list[i]});
+            }
+        }
+    };
+
+    capturePrecaches("sv.model_precache", sv.model_precache, MAX_MODELS);
+    capturePrecaches("sv.sound_precache", sv.sound_precache, MAX_SOUNDS);
+    capturePrecaches(
+        "sv.particle_precache", sv.particle_precache, MAX_PARTICLETYPES);
+
+    // Field and global names, indexed by def number.
+    const int numfielddefs = qcvm->progs->numfielddefs;
+    const int numglobaldefs = qcvm->progs->numglobaldefs;
+
+    out.names.clear();
+    out.names.reserve(numfielddefs + numglobaldefs);
+
+    const auto captureValue = [](SaveSnapshot::Value& v, const int type,
+                                  eval_t* val) {
+        v.type = type;
+
+        switch(type)
+        {
+            case ev_float: [[fallthrough]];
+            case ev_ext_integer: [[fallthrough]];
+            case ev_vector: v.raw = *val; break;
+            default: v.text = PR_UglyValueString(type, val); break;
+        }
+    };
+
+    out.globals.clear();
+    for(int i = 0; i < numglobaldefs; i++)
+    {
+        ddef_t* def = &qcvm->globaldefs[i];
+        if(!(def->type & DEF_SAVEGLOBAL))
+        {
+            continue;
+        }
+
+        const int type = def->type & ~DEF_SAVEGLOBAL;
+        if(type != ev_string && type != ev_float && type != ev_ext_integer &&
+            type != ev_entity)
+        {
+            continue;
+        }
+
+        out.names.emplace_back(PR_GetString(def->s_name));
+
+        SaveSnapshot::Value& v = out.globals.emplace_back();
+        v.name = out.names.size() - 1;
+        captureValue(v, type, (eval_t*)&qcvm->globals[def->ofs]);
+    }
+
+    // Skip _x, _y, _z vars once rather than per edict.
+    std::vector<std::size_t> fieldNames(numfielddefs, std::size_t(-1));
+    for(int i = 1; i < numfielddefs; i++)
+    {
+        const char* name = PR_GetString(qcvm->fielddefs[i].s_name);
+        const std::size_t len = strlen(name);
+        if(len > 1 && name[len - 2] == '_')
+        {
+            continue;
+        }
+
+        out.names.emplace_back(name);
+        fieldNames[i] = out.names.size() - 1;
+    }
+
+    out.values.clear();
+    out.edicts.clear();
+    out.edicts.reserve(qcvm->num_edicts);
+
+    for(int e = 0; e < qcvm->num_edicts; e++) // QSS
+    {
+        edict_t* ed = EDICT_NUM(e);
+
+        SaveSnapshot::Edict& se = out.edicts.emplace_back();
+        se.free = ed->free;
+        se.firstValue = out.values.size();
+        se.numValues = 0;
+        se.hasAlpha = false;
+        se.alpha = 0.f;
+
+        if(ed->free)
+        {
+            continue;
+        }
+
+        for(int i = 1; i < numfielddefs; i++)
+        {
+            if(fieldNames[i] == std::size_t(-1))
+            {
+                continue;
+            }
+
+            ddef_t* d = &qcvm->fielddefs[i];
+            int* v = (int*)((char*)&ed->v + d->ofs * 4);
+
+            // if the value is still all 0, skip the field
+            const int type = d->type & ~DEF_SAVEGLOBAL;
+            int j;
+            for(j = 0; j < type_size[type]; j++)
+            {
+                if(v[j])
+                {
+                    break;
+                }
+            }
+            if(j == type_size[type])
+            {
+                continue;
+            }
+
+            SaveSnapshot::Value& sv = out.values.emplace_back();
+            sv.name = fieldNames[i];
+            captureValue(sv, type, (eval_t*)v);
+            ++se.numValues;
+        }
+
+        // johnfitz -- save entity alpha manually when progs.dat doesn't know
+        // about alpha
+        if(qcvm->extfields.alpha < 0 && ed->alpha != ENTALPHA_DEFAULT)
+        {
+            se.hasAlpha = true;
+            se.alpha = ENTALPHA_TOSAVE(ed->alpha);
+        }
+        // johnfitz
+    }
+}
+
+static void appendf(std::string& out, const char* format, ...)
+    FUNC_PRINTF(2, 3);
+
+static void appendf(std::string& out, const char* format, ...)
+{
+    char buf[1024];
+
+    va_list argptr;
+    va_start(argptr, format);
+    const int len = q_vsnprintf(buf, sizeof(buf), format, argptr);
+    va_end(argptr);
+
+    if(len < 0)
+    {
+        return;
+    }
+
+    if(static_cast<std::size_t>(len) < sizeof(buf))
+    {
+        out.append(buf, len);
+        return;
+    }
+
+    // long string values only
+    std::string big(len + 1, '\0');
+    va_start(argptr, format);
+    q_vsnprintf(big.data(), big.size(), format, argptr);
+    va_end(argptr);
+    out.append(big.data(), len);
+}
+
+// Mirrors `PR_UglyValueString` for the values kept raw in the snapshot.
+static void appendValue(std::string& out, const SaveSnapshot& snapshot,
+    const SaveSnapshot::Value& v)
+{
+    appendf(out, "\"%s\" ", snapshot.names[v.name].c_str());
+
+    switch(v.type)
+    {
+        case ev_float: appendf(out, "\"%f\"\n", v.raw._float); break;
+        case ev_ext_integer: appendf(out, "\"%i\"\n", v.raw._int); break;
+        case ev_vector:
+            appendf(out, "\"%f %f %f\"\n", v.raw.vector[0], v.raw.vector[1],
+                v.raw.vector[2]);
+            break;
+        default: appendf(out, "\"%s\"\n", v.text.c_str()); break;
+    }
+}
+
+[[nodiscard]] bool writeSaveSnapshot(
+    const char* path, const SaveSnapshot& snapshot)
+{
+    std::string out;
+    out.reserve(snapshot.values.size() * 32 + 4096);
+
+    if(snapshot.hasTimestamp)
+    {
+        std::tm tm = *std::gmtime(&snapshot.timestamp);
+
+        char buf[256];
+        std::strftime(buf, sizeof(buf), "%F %T", &tm);
+
+        appendf(out, "%s\n", buf);
+    }
+
+    appendf(out, "%i\n", SAVEGAME_VERSION);
+    appendf(out, "%s\n", snapshot.comment);
+
+    for(int i = 0; i < NUM_BASIC_SPAWN_PARMS; i++) // QSS
+    {
+        appendf(out, "%f\n", snapshot.spawnParms[i]);
+    }
+
+    appendf(out, "%d\n", snapshot.skill);
+    appendf(out, "%s\n", snapshot.mapName.c_str());
+    appendf(out, "%f\n", snapshot.time); // QSS
+
+    // write the light styles
+    for(int i = 0; i < MAX_LIGHTSTYLES_VANILLA; i++) // QSS
+    {
+        const std::string& style = snapshot.lightStyles[i];
+        appendf(out, "%s\n", style.empty() ? "m" : style.c_str());
+    }
+
+    out += "{\n";
+    for(const SaveSnapshot::Value& v : snapshot.globals)
+    {
+        appendValue(out, snapshot, v);
+    }
+    out += "}\n";
+
+    for(const SaveSnapshot::Edict& e : snapshot.edicts)
+    {
+        out += "{\n";
+
+        for(std::size_t i = 0; i < e.numValues; i++)
+        {
+            appendValue(out, snapshot, snapshot.values[e.firstValue + i]);
+        }
+
+        if(e.hasAlpha)
+        {
+            appendf(out, "\"alpha\" \"%f\"\n", e.alpha);
+        }
+
+        out += "}\n";
+    }
+
+    // QSS
+    // add extra info (lightstyles, precaches, etc) in a way that's supposed to
+    // be compatible with DP. sidenote - this provides extended lightstyles and
+    // support for late precaches it does NOT protect against spawnfunc
+    // precache changes - we would need to include makestatics here too (and
+    // optionally baselines, or just recalculate those).
+    out += "/*\n";
+    out += "// QuakeSpasm extended savegame\n";
+    for(int i = MAX_LIGHTSTYLES_VANILLA; i < MAX_LIGHTSTYLES; i++)
+    {
+        if(!snapshot.lightStyles[i].empty())
+        {
+            appendf(out, "sv.lightstyles %i \"%s\"\n", i,
+                snapshot.lightStyles[i].c_str());
+        }
+    }
+
+    for(const SaveSnapshot::Precache& p : snapshot.precaches)
+    {
+        appendf(out, "%s %i \"%s\"\n", p.kind, p.index, p.name.c_str());
+    }
+
+    for(int i = NUM_BASIC_SPAWN_PARMS; i < NUM_TOTAL_SPAWN_PARMS; i++)
+    {
+        if(snapshot.spawnParms[i])
+        {
+            appendf(out, "spawnparm %i \"%f\"\n", i + 1,
+                snapshot.spawnParms[i]);
+        }
+    }
+
+    out += "*/\n";
+
+    FILE* f = fopen(path, "w");
+    if(!f)
+    {
+        return false;
+    }
+
+    const bool written = fwrite(out.data(), 1, out.size(), f) == out.size();
+    return (fclose(f) == 0) && written;
+}
+
+struct PendingSave
+{
+    std::future<bool> result;
+    std::string path;
+    bool autosaveMessage;
+
+    // Slot table entry to fill in once the write succeeded, for autosaves.
+    int autosaveSlot;
+    char comment[SAVEGAME_COMMENT_LENGTH + 1];
+    std::time_t timestamp;
+};
+
+[[nodiscard]] static PendingSave& pendingSave() noexcept
+{
+    static PendingSave res;
+    return res;
+}
+
+static void reportPendingSave() noexcept
+{
+    PendingSave& p = pendingSave();
+    const bool ok = p.result.get();
+
+    if(!ok)
+    {
+        Con_Printf("ERROR: couldn't write %s.\n", p.path.c_str());
+    }
+
+    if(p.autosaveMessage)
+    {
+        Con_Printf(ok ? "Successfully created autosave.\n"
+                      : "Failed to created autosave.\n");
+    }
+
+    // Update the slot table instead of rescanning every save file next time.
+    if(ok && p.autosaveSlot != -1)
+    {
+        for(char& c : p.comment)
+        {
+            if(c == '_')
+            {
+                c = ' ';
+            }
+        }
+
+        q_strlcpy(autosaveFilenames()[p.autosaveSlot], p.comment,
+            SAVEGAME_COMMENT_LENGTH + 1);
+        autosaveLoadables()[p.autosaveSlot] = true;
+        autosaveTimestamps()[p.autosaveSlot] =
+            toScannedTimestamp(p.timestamp);
+    }
+}
+
+void writeSaveSnapshotAsync(
+    std::string path, SaveSnapshot&& snapshot, bool autosaveMessage)
+{
+    finishPendingSave();
+
+    PendingSave& p = pendingSave();
+    p.path = std::move(path);
+    p.autosaveMessage = autosaveMessage;
+    p.autosaveSlot = -1;
+    q_strlcpy(p.comment, snapshot.comment, sizeof(p.comment));
+    p.timestamp = snapshot.timestamp;
+    p.result = std::async(std::launch::async,
+        [path = p.path, snapshot = std::move(snapshot)] {
+            return writeSaveSnapshot(path.c_str(), snapshot);
+        });
+}
+
+void finishPendingSave() noexcept
+{
+    if(pendingSave().result.valid())
+    {
+        reportPendingSave();
+    }
+}
+
+void pollPendingSave() noexcept
+{
+    auto& result = pendingSave().result;
+    if(result.valid() && result.wait_for(std::chrono::seconds(0)) ==
+                             std::future_status::ready)
+    {
+        reportPendingSave();
+    }
+}
+
 void doAutosave() noexcept
 {
+    // The slot an autosave still being written goes to only counts as taken
+    // once it's done, so it must be done before picking the next one.
+    finishPendingSave();
+
     if(vr_autosave_show_message.value)
     {
         Con_Printf("Creating autosave...\n");
@@ -192,12 +624,11 @@ void doAutosave() noexcept
     char name[64];
     q_snprintf(name, sizeof(name), "auto%d", idx);
 
-    if(Host_MakeSavegame(name, &now, vr_autosave_show_message.value))
+    if(Host_MakeSavegame(name, &now, vr_autosave_show_message.value,
+           true /* background */))
     {
-        if(vr_autosave_show_message.value)
-        {
-            Con_Printf("Successfully created autosave.\n");
-        }
+        // The outcome is reported once the background write is done.
+        pendingSave().autosaveSlot = idx;
     }
     else
     {
@@ -210,6 +641,8 @@ void doAutosave() noexcept
 
 void doAutomaticAutosave() noexcept
 {
+    pollPendingSave();
+
     const std::time_t now = std::time(nullptr);
 
     const int secondDiff = quake::saveutil::timeDiffInSeconds(
@@ -1,6 +1,12 @@
 #pragma once
 
+#include "progs.hpp"
+#include "quakedef_macros.hpp"
+#include "server.hpp"
+
 #include <ctime>
+#include <string>
+#include <vector>
 
 inline constexpr std::size_t MAX_SAVEGAMES = 20;
 inline constexpr std::size_t MAX_AUTOSAVES = 12;
@@ -10,6 +16,71 @@ namespace quake
 namespace saveutil
 {
 
+// Copy of everything `Host_MakeSavegame` writes, detached from the QCVM so
+// that formatting and writing the `.sav` file can happen on another thread.
+// Strings, functions, fields and entities are resolved to text at capture
+// time, numeric values are copied raw and formatted later.
+struct SaveSnapshot
+{
+    struct Value
+    {
+        std::size_t name; // index into `names`
+        int type;
+        eval_t raw;
+        std::string text;
+    };
+
+    struct Edict
+    {
+        bool free;
+        bool hasAlpha;
+        float alpha;
+        std::size_t firstValue;
+        std::size_t numValues;
+    };
+
+    struct Precache
+    {
+        const char* kind;
+        int index;
+        std::string name;
+    };
+
+    bool hasTimestamp;
+    std::time_t timestamp;
+    char comment[SAVEGAME_COMMENT_LENGTH + 1];
+    float spawnParms[NUM_TOTAL_SPAWN_PARMS];
+    int skill;
+    std::string mapName;
+    float time;
+
+    std::vector<std::string> lightStyles; // empty means unset
+    std::vector<Precache> precaches;
+
+    std::vector<std::string> names;
+    std::vector<Value> globals;
+    std::vector<Value> values;
+    std::vector<Edict> edicts;
+};
+
+// Must be called with `sv.qcvm` active.
+void captureSaveSnapshot(
+    SaveSnapshot& out, const std::time_t* timestamp, const char* comment);
+
+[[nodiscard]] bool writeSaveSnapshot(
+    const char* path, const SaveSnapshot& snapshot);
+
+// Formats and writes the snapshot on a background thread. Only one save is
+// in flight at a time; a new one waits for the previous to finish.
+void writeSaveSnapshotAsync(
+    std::string path, SaveSnapshot&& snapshot, bool autosaveMessage);
+
+// Blocks until the in-flight save, if any, has been written.
+void finishPendingSave() noexcept;
+
+// Reports the in-flight save if it has completed, without blocking.
+void pollPendingSave() noexcept;
+
 void doAutosave() noexcept;
 void doAutomaticAutosave() noexcept;
 void doChangelevelAutosave() noexcept;
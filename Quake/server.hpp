@@ -363,6 +363,7 @@ void SVFTE_Ack(client_t* client, int sequence);
 void SVFTE_DestroyFrames(client_t* client);
 void SV_BuildEntityState(edict_t* ent, entity_state_t* state);
 void SV_SendClientMessages();
+void SV_InvalidateClientSnapshots();
 void SV_ClearDatagram();
 
 int SV_ModelIndex(const char* name);
@@ -0,0 +1,88 @@
+#include "simd.hpp"
+
+#if QUAKE_SIMD_X86 && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace quake::simd
+{
+
+[[nodiscard]] static Level computeLevel() noexcept
+{
+#if !QUAKE_SIMD_X86
+    return Level::Scalar;
+#elif defined(_MSC_VER)
+    int info[4];
+
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    const bool sse2 = (info[3] & (1 << 26)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+
+    if(!sse2)
+    {
+        return Level::Scalar;
+    }
+
+    if(maxLeaf < 7 || !osxsave || !avx)
+    {
+        return Level::SSE2;
+    }
+
+    // the OS must save the YMM registers
+    if((_xgetbv(0) & 0x6) != 0x6)
+    {
+        return Level::SSE2;
+    }
+
+    __cpuidex(info, 7, 0);
+    const bool avx2 = (info[1] & (1 << 5)) != 0;
+
+    return avx2 ? Level::AVX2 : Level::SSE2;
+#else
+    __builtin_cpu_init();
+
+    if(__builtin_cpu_supports("avx2"))
+    {
+        return Level::AVX2;
+    }
+
+    if(__builtin_cpu_supports("sse2"))
+    {
+        return Level::SSE2;
+    }
+
+    return Level::Scalar;
+#endif
+}
+
+[[nodiscard]] Level detectedLevel() noexcept
+{
+    static const Level res = computeLevel();
+    return res;
+}
+
+[[nodiscard]] Level clampLevel(const float requested) noexcept
+{
+    const int detected = static_cast<int>(detectedLevel());
+    const int clamped = requested < 0.f ? 0 : static_cast<int>(requested);
+
+    return static_cast<Level>(clamped < detected ? clamped : detected);
+}
+
+[[nodiscard]] const char* levelName(const Level level) noexcept
+{
+    switch(level)
+    {
+        case Level::Scalar: return "scalar";
+        case Level::SSE2: return "SSE2";
+        case Level::AVX2: return "AVX2";
+    }
+
+    return "unknown";
+}
+
+} // namespace quake::simd
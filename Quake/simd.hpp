@@ -0,0 +1,40 @@
+#pragma once
+
+// Runtime CPU feature detection for the hand-written SIMD kernels. Kernels
+// are compiled for every level the compiler can target and picked at runtime
+// with `quake::simd::clampLevel`, so the executable still runs on CPUs
+// without AVX2.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || \
+    defined(_M_IX86)
+#define QUAKE_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define QUAKE_SIMD_X86 0
+#endif
+
+#if QUAKE_SIMD_X86 && (defined(__GNUC__) || defined(__clang__))
+#define QUAKE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define QUAKE_TARGET_AVX2
+#endif
+
+namespace quake::simd
+{
+
+enum class Level : int
+{
+    Scalar = 0,
+    SSE2 = 1,
+    AVX2 = 2
+};
+
+// Best level supported by the CPU running the executable.
+[[nodiscard]] Level detectedLevel() noexcept;
+
+// `requested` is usually a cvar value: the lower of it and `detectedLevel`.
+[[nodiscard]] Level clampLevel(float requested) noexcept;
+
+[[nodiscard]] const char* levelName(Level level) noexcept;
+
+} // namespace quake::simd
@@ -65,12 +65,17 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "client.hpp"
 #include "snd_voip.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+
 static void S_Play();
 static void S_PlayVol();
 static void S_SoundList();
 static void S_Update_();
 void S_StopAllSounds(bool clear);
 static void S_StopAllSoundsC();
+static void S_MixStats_f();
 
 // =======================================================================
 // Internal sound data & structures
@@ -80,7 +85,7 @@ channel_t* snd_channels;
 int total_channels;
 int max_channels;
 
-static int snd_blocked = 0;
+static std::atomic<int> snd_blocked = 0;
 static bool snd_initialized = false;
 
 static dma_t sn;
@@ -94,10 +99,10 @@ float voicevolumescale = 1; // for audio ducking while speaking
 
 #define sound_nominal_clip_dist 1000.0
 
-int soundtime;   // sample PAIRS
-int paintedtime; // sample PAIRS
+int soundtime;                // sample PAIRS
+std::atomic<int> paintedtime; // sample PAIRS
 
-int s_rawend;
+std::atomic<int> s_rawend;
 portable_samplepair_t s_rawsamples[MAX_RAW_SAMPLES];
 
 
@@ -117,6 +122,8 @@ cvar_t loadas8bit = {"loadas8bit", "0", CVAR_NONE};
 
 cvar_t sndspeed = {"sndspeed", "11025", CVAR_NONE};
 cvar_t snd_mixspeed = {"snd_mixspeed", "44100", CVAR_NONE};
+cvar_t snd_mix_simd = {"snd_mix_simd", "2", CVAR_ARCHIVE};
+cvar_t snd_mixthread = {"snd_mixthread", "1", CVAR_ARCHIVE};
 
 #if defined(_WIN32)
 #define SND_FILTERQUALITY_DEFAULT "5"
@@ -134,6 +141,201 @@ static cvar_t snd_noextraupdate = {"snd_noextraupdate", "0", CVAR_NONE};
 static cvar_t snd_show = {"snd_show", "0", CVAR_NONE};
 static cvar_t _snd_mixahead = {"_snd_mixahead", "0.1", CVAR_ARCHIVE};
 
+// =======================================================================
+// Mixer thread
+// =======================================================================
+
+// how long the mixer thread sleeps between mixes, well under _snd_mixahead
+#define SND_MIXTHREAD_INTERVAL_MS 5
+
+static std::thread snd_mixer;
+static std::atomic<bool> snd_mixerquit = false;
+
+// set by the mixer when paintedtime is chopped off to avoid 32 bit limits;
+// the game side then stops all sounds, as their end times are now wrong
+static std::atomic<bool> snd_timewrapped = false;
+
+// mixer statistics, printed by snd_mixstats
+static std::atomic<int> snd_underruns = 0;
+static std::atomic<int> snd_latency = 0; // samples mixed ahead of playback
+static std::atomic<int> snd_mixes = 0;
+static std::atomic<long long> snd_mixtime = 0; // microseconds, all mixes
+static std::atomic<int> snd_maxmixtime = 0;    // microseconds
+static std::atomic<int> snd_commandstalls = 0;
+
+static void S_MixerThread()
+{
+    while(!snd_mixerquit)
+    {
+        S_Update_();
+        std::this_thread::sleep_for(
+            std::chrono::milliseconds(SND_MIXTHREAD_INTERVAL_MS));
+    }
+}
+
+static void S_StartMixerThread()
+{
+    if(snd_mixer.joinable() || !sound_started)
+    {
+        return;
+    }
+
+    snd_mixerquit = false;
+    snd_mixer = std::thread{S_MixerThread};
+}
+
+static void S_StopMixerThread()
+{
+    if(!snd_mixer.joinable())
+    {
+        return;
+    }
+
+    snd_mixerquit = true;
+    snd_mixer.join();
+}
+
+/*
+=================
+S_SendCommand
+
+queues a command for the mixer. when the queue is full, waits for the mixer
+thread to catch up, or applies the queue here if there is no mixer thread.
+=================
+*/
+static void S_SendCommand(const sndcmd_t& cmd)
+{
+    while(!SND_PushCommand(cmd))
+    {
+        if(!snd_mixer.joinable())
+        {
+            SND_ApplyCommands();
+            continue;
+        }
+
+        snd_commandstalls++;
+        std::this_thread::yield();
+    }
+}
+
+static void S_SendStop(channel_t* ch)
+{
+    if(!ch->mixsfx)
+    {
+        return;
+    }
+
+    sndcmd_t cmd{};
+    cmd.type = SND_CMD_STOP;
+    cmd.channel = ch - snd_channels;
+    S_SendCommand(cmd);
+
+    ch->mixsfx = nullptr;
+}
+
+static void S_SendStart(channel_t* ch)
+{
+    sndcmd_t cmd{};
+    cmd.type = SND_CMD_START;
+    cmd.channel = ch - snd_channels;
+    cmd.sfx = ch->sfx;
+    cmd.pos = ch->pos;
+    cmd.leftvol = ch->leftvol;
+    cmd.rightvol = ch->rightvol;
+    S_SendCommand(cmd);
+
+    ch->mixsfx = ch->sfx;
+    ch->mixleftvol = ch->leftvol;
+    ch->mixrightvol = ch->rightvol;
+}
+
+/*
+=================
+S_SyncChannel
+
+sends the mixer whatever changed on a channel since it was last told. also
+loads the sound again if the cache evicted it; the mixer skips the channel
+while its data is gone.
+=================
+*/
+static void S_SyncChannel(channel_t* ch)
+{
+    sfxcache_t* sc = ch->sfx ? S_LoadSound(ch->sfx) : nullptr;
+
+    if(!sc)
+    {
+        ch->sfx = nullptr;
+        S_SendStop(ch);
+        return;
+    }
+
+    sndcmd_t cmd{};
+    cmd.channel = ch - snd_channels;
+
+    if(ch->sfx != ch->mixsfx)
+    {
+        cmd.type = SND_CMD_SOUND;
+        cmd.sfx = ch->sfx;
+        S_SendCommand(cmd);
+        ch->mixsfx = ch->sfx;
+    }
+
+    if(ch->leftvol != ch->mixleftvol || ch->rightvol != ch->mixrightvol)
+    {
+        cmd.type = SND_CMD_VOLUME;
+        cmd.leftvol = ch->leftvol;
+        cmd.rightvol = ch->rightvol;
+        S_SendCommand(cmd);
+        ch->mixleftvol = ch->leftvol;
+        ch->mixrightvol = ch->rightvol;
+    }
+}
+
+/*
+=================
+S_ChannelPlaying
+
+the game side doesn't see the mixer's positions, so it follows each sound's
+end time itself: looped sounds move their end time forward, the others are
+done once it has been mixed
+=================
+*/
+static bool S_ChannelPlaying(channel_t* ch)
+{
+    sfxcache_t* sc = (sfxcache_t*)Cache_Check(&ch->sfx->cache);
+
+    if(!sc || ch->end > paintedtime)
+    {
+        return true;
+    }
+
+    if(sc->loopstart >= 0 && sc->length > sc->loopstart)
+    {
+        while(ch->end <= paintedtime)
+        {
+            ch->end += sc->length - sc->loopstart;
+        }
+        return true;
+    }
+
+    // the mixer stops it on its own
+    ch->sfx = nullptr;
+    ch->mixsfx = nullptr;
+    return false;
+}
+
+static void SND_Callback_snd_mixthread(cvar_t* var)
+{
+    if(var->value)
+    {
+        S_StartMixerThread();
+    }
+    else
+    {
+        S_StopMixerThread();
+    }
+}
+
 
 static void S_SoundInfo_f()
 {
@@ -224,6 +426,8 @@ void S_Init()
     Cvar_RegisterVariable(&_snd_mixahead);
     Cvar_RegisterVariable(&sndspeed);
     Cvar_RegisterVariable(&snd_mixspeed);
+    Cvar_RegisterVariable(&snd_mix_simd);
+    Cvar_RegisterVariable(&snd_mixthread);
     Cvar_RegisterVariable(&snd_filterquality);
 
     S_Voip_Init();
@@ -241,6 +445,7 @@ void S_Init()
     Cmd_AddCommand("stopsound", S_StopAllSoundsC);
     Cmd_AddCommand("soundlist", S_SoundList);
     Cmd_AddCommand("soundinfo", S_SoundInfo_f);
+    Cmd_AddCommand("snd_mixstats", S_MixStats_f);
 
     i = COM_CheckParm("-sndspeed");
     if(i && i < com_argc - 1)
@@ -263,6 +468,7 @@ void S_Init()
 
     Cvar_SetCallback(&sfxvolume, SND_Callback_sfxvolume);
     Cvar_SetCallback(&snd_filterquality, &SND_Callback_snd_filterquality);
+    Cvar_SetCallback(&snd_mixthread, &SND_Callback_snd_mixthread);
 
     SND_InitScaletable();
 
@@ -287,6 +493,11 @@ void S_Init()
     S_CodecInit();
 
     S_StopAllSounds(true);
+
+    if(snd_mixthread.value)
+    {
+        S_StartMixerThread();
+    }
 }
 
 
@@ -300,6 +511,8 @@ void S_Shutdown()
         return;
     }
 
+    S_StopMixerThread();
+
     sound_started = 0;
     snd_blocked = 0;
 
@@ -561,6 +774,10 @@ void S_StartSound(int entnum, int entchannel, sfx_t* sfx, const qvec3& origin,
         return;
     }
 
+    // the mixer stops whatever it was playing here, even if the new sound
+    // turns out to be inaudible
+    S_SendStop(target_chan);
+
     // spatialize
     memset(target_chan, 0, sizeof(*target_chan));
     target_chan->origin = origin;
@@ -597,7 +814,10 @@ void S_StartSound(int entnum, int entchannel, sfx_t* sfx, const qvec3& origin,
         {
             continue;
         }
-        if(check->sfx == sfx && !check->pos)
+        // the game side never sees pos advance; a sound the mixer hasn't
+        // started on yet still has its whole length ahead of paintedtime
+        if(check->sfx == sfx && !check->pos &&
+            check->end - paintedtime >= sc->length)
         {
             /*
             skip = rand () % (int)(0.1 * shm->speed);
@@ -619,6 +839,8 @@ void S_StartSound(int entnum, int entchannel, sfx_t* sfx, const qvec3& origin,
             break;
         }
     }
+
+    S_SendStart(target_chan);
 }
 
 void S_StopSound(int entnum, int entchannel)
@@ -632,6 +854,7 @@ void S_StopSound(int entnum, int entchannel)
         {
             snd_channels[i].end = 0;
             snd_channels[i].sfx = nullptr;
+            S_SendStop(&snd_channels[i]);
             return;
         }
     }
@@ -653,6 +876,13 @@ void S_StopAllSounds(bool clear)
     }
     memset(snd_channels, 0, max_channels * sizeof(channel_t));
 
+    // queued before the buffer is cleared under the buffer lock, which the
+    // mixer applies its commands under, so nothing it paints afterwards
+    // still has the old channels in it
+    sndcmd_t cmd{};
+    cmd.type = SND_CMD_STOPALL;
+    S_SendCommand(cmd);
+
     if(clear)
     {
         S_ClearBuffer();
@@ -676,6 +906,7 @@ void S_ClearBuffer()
     SNDDMA_LockBuffer();
     if(!shm->buffer)
     {
+        SNDDMA_Submit();
         return;
     }
 
@@ -749,6 +980,7 @@ void S_StaticSound(
     ss->end = paintedtime + sc->length;
 
     SND_Spatialize(ss);
+    S_SendStart(ss);
 }
 
 
@@ -847,7 +1079,7 @@ void S_RawSamples(
 
     if(s_rawend < paintedtime)
     {
-        s_rawend = paintedtime;
+        s_rawend = paintedtime.load();
     }
 
     scale = (float)rate / shm->speed;
@@ -949,6 +1181,11 @@ void S_Update(const qvec3& origin, const qvec3& forward, const qvec3& right,
         return;
     }
 
+    if(snd_timewrapped.exchange(false))
+    {
+        S_StopAllSounds(true);
+    }
+
     listener_origin = origin;
     listener_forward = forward;
     listener_right = right;
@@ -963,7 +1200,7 @@ void S_Update(const qvec3& origin, const qvec3& forward, const qvec3& right,
     ch = snd_channels + NUM_AMBIENTS;
     for(i = NUM_AMBIENTS; i < total_channels; i++, ch++)
     {
-        if(!ch->sfx)
+        if(!ch->sfx || !S_ChannelPlaying(ch))
         {
             continue;
         }
@@ -1033,11 +1270,20 @@ void S_Update(const qvec3& origin, const qvec3& forward, const qvec3& right,
         Con_Printf("----(%i)----\n", total);
     }
 
+    // tell the mixer about new volumes, and ambient sounds coming and going
+    for(i = 0; i < total_channels; i++)
+    {
+        S_SyncChannel(&snd_channels[i]);
+    }
+
     // add raw data from streamed samples
     //	BGM_Update();	// moved to the main loop just before S_Update ()
 
-    // mix some sound
-    S_Update_();
+    // mix some sound, unless the mixer thread does
+    if(!snd_mixer.joinable())
+    {
+        S_Update_();
+    }
 }
 
 static void GetSoundtime()
@@ -1062,7 +1308,7 @@ static void GetSoundtime()
             // time to chop things off to avoid 32 bit limits
             buffers = 0;
             paintedtime = fullsamples;
-            S_StopAllSounds(true);
+            snd_timewrapped = true;
         }
     }
     oldsamplepos = samplepos;
@@ -1072,7 +1318,7 @@ static void GetSoundtime()
 
 void S_ExtraUpdate()
 {
-    if(snd_noextraupdate.value)
+    if(snd_noextraupdate.value || snd_mixer.joinable())
     {
         return; // don't pollute timings
     }
@@ -1086,15 +1332,26 @@ static void S_Update_()
 
     if(!sound_started || (snd_blocked > 0))
     {
+        // keep the command queue moving even while nothing is mixed
+        std::lock_guard cacheLock{Cache_Mutex()};
+        SND_ApplyCommands();
         return;
     }
 
     SNDDMA_LockBuffer();
     if(!shm->buffer)
     {
+        SNDDMA_Submit();
         return;
     }
 
+    // the cache can't move or free sound data while this is held. commands
+    // are applied under the buffer lock so that a stop queued before
+    // S_ClearBuffer is seen before anything is painted over the cleared
+    // buffer.
+    std::lock_guard cacheLock{Cache_Mutex()};
+    SND_ApplyCommands();
+
     // Updates DMA time
     GetSoundtime();
 
@@ -1103,6 +1360,7 @@ static void S_Update_()
     {
         //	Con_Printf ("S_Update_ : overflow\n");
         paintedtime = soundtime;
+        snd_underruns++;
     }
 
     // mix ahead of current position
@@ -1110,7 +1368,20 @@ static void S_Update_()
     samps = shm->samples >> (shm->channels - 1);
     endtime = q_min(endtime, (unsigned int)(soundtime + samps));
 
+    using clock = std::chrono::steady_clock;
+    const clock::time_point start = clock::now();
     S_PaintChannels(endtime);
+    const auto elapsed = clock::now() - start;
+    const int us =
+        std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+
+    snd_latency = paintedtime - soundtime;
+    snd_mixes++;
+    snd_mixtime += us;
+    if(us > snd_maxmixtime)
+    {
+        snd_maxmixtime = us;
+    }
 
     SNDDMA_Submit();
 }
@@ -1153,6 +1424,27 @@ console functions
 ===============================================================================
 */
 
+static void S_MixStats_f()
+{
+    if(!sound_started)
+    {
+        Con_Printf("sound not started\n");
+        return;
+    }
+
+    const int mixes = snd_mixes;
+
+    Con_Printf("mixing on the %s\n",
+        snd_mixer.joinable() ? "mixer thread" : "main thread");
+    Con_Printf("latency: %.1f ms mixed ahead of playback\n",
+        snd_latency * 1000.0 / shm->speed);
+    Con_Printf("underruns: %d\n", (int)snd_underruns);
+    Con_Printf("mix time: %.3f ms average, %.3f ms max, %d mixes\n",
+        mixes ? snd_mixtime / 1000.0 / mixes : 0.0, snd_maxmixtime / 1000.0,
+        mixes);
+    Con_Printf("command queue stalls: %d\n", (int)snd_commandstalls);
+}
+
 static void S_Play()
 {
     static int hash = 345;
@@ -27,49 +27,278 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "common.hpp"
 #include "q_sound.hpp"
 #include "mathlib.hpp"
+#include "simd.hpp"
+
+#include <atomic>
+#include <vector>
+
+// the channels are mixed in floating point, in the same 24 bit range as the
+// integer mixer they replace (a full scale 16 bit sample is +/- 32768 * 256)
+typedef struct
+{
+    float left;
+    float right;
+} paintsample_t;
 
 #define PAINTBUFFER_SIZE 2048
-portable_samplepair_t paintbuffer[PAINTBUFFER_SIZE];
-int snd_scaletable[32][256];
-int *snd_p, snd_linear_count;
-short* snd_out;
+alignas(32) static paintsample_t paintbuffer[PAINTBUFFER_SIZE];
+static float snd_scaletable[32];
 
 static int snd_vol;
 
-static void Snd_WriteLinearBlastStereo16()
+// level of the SIMD kernels used by the current S_PaintChannels call
+static quake::simd::Level snd_level;
+
+/*
+===============================================================================
+
+MIXER COMMANDS
+
+single producer, single consumer ring: the game side pushes, whoever is mixing
+(the mixer thread, or the main thread when it has none) applies
+
+===============================================================================
+*/
+
+// the mixer's view of a channel of snd_channels, at the same index. the cache
+// may move or evict the sound's data between mixes, so it's looked up again
+// each time, with Cache_Mutex held.
+typedef struct
 {
-    int i;
-    int val;
+    sfx_t* sfx;     // nullptr when not playing
+    int pos;        // sample position in sc
+    int end;        // end time in global paintsamples
+    int leftvol;    // 0-255 volume
+    int rightvol;   // 0-255 volume
+} mixchannel_t;
+
+static std::vector<mixchannel_t> mix_channels;
+
+#define SND_MAXCOMMANDS 4096 // must be a power of two
+static sndcmd_t snd_commands[SND_MAXCOMMANDS];
+static std::atomic<unsigned int> snd_commandhead; // next to push
+static std::atomic<unsigned int> snd_commandtail; // next to apply
 
-    for(i = 0; i < snd_linear_count; i += 2)
+bool SND_PushCommand(const sndcmd_t& cmd)
+{
+    const unsigned int head = snd_commandhead.load(std::memory_order_relaxed);
+
+    if(head - snd_commandtail.load(std::memory_order_acquire) ==
+        SND_MAXCOMMANDS)
     {
-        val = snd_p[i] / 256;
-        if(val > 0x7fff)
-        {
-            snd_out[i] = 0x7fff;
-        }
-        else if(val < (short)0x8000)
-        {
-            snd_out[i] = (short)0x8000;
-        }
-        else
-        {
-            snd_out[i] = val;
-        }
+        return false;
+    }
 
-        val = snd_p[i + 1] / 256;
-        if(val > 0x7fff)
-        {
-            snd_out[i + 1] = 0x7fff;
-        }
-        else if(val < (short)0x8000)
-        {
-            snd_out[i + 1] = (short)0x8000;
-        }
-        else
-        {
-            snd_out[i + 1] = val;
-        }
+    snd_commands[head & (SND_MAXCOMMANDS - 1)] = cmd;
+    snd_commandhead.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+static void SND_ApplyCommand(const sndcmd_t& cmd)
+{
+    if(cmd.type == SND_CMD_STOPALL)
+    {
+        mix_channels.clear();
+        return;
+    }
+
+    if(cmd.channel >= (int)mix_channels.size())
+    {
+        mix_channels.resize(cmd.channel + 1, mixchannel_t{});
+    }
+
+    mixchannel_t* ch = &mix_channels[cmd.channel];
+
+    // may be evicted by now; the channel then waits for the game side to
+    // load it again, and catches up with paintedtime from its end time
+    const auto* sc = cmd.sfx ? (const sfxcache_t*)cmd.sfx->cache.data
+                             : nullptr;
+
+    switch(cmd.type)
+    {
+        case SND_CMD_START:
+            ch->sfx = cmd.sfx;
+            ch->pos = cmd.pos;
+            ch->end = paintedtime + (sc ? sc->length : 0) - cmd.pos;
+            ch->leftvol = cmd.leftvol;
+            ch->rightvol = cmd.rightvol;
+            break;
+        case SND_CMD_SOUND:
+            if(!ch->sfx)
+            {
+                ch->pos = 0;
+                ch->end = paintedtime + (sc ? sc->length : 0);
+            }
+            ch->sfx = cmd.sfx;
+            break;
+        case SND_CMD_VOLUME:
+            ch->leftvol = cmd.leftvol;
+            ch->rightvol = cmd.rightvol;
+            break;
+        case SND_CMD_SHIFT:
+            // starts over if the mixer already played all there was
+            ch->pos = ch->sfx == cmd.sfx ? q_max(ch->pos + cmd.pos, 0) : 0;
+            ch->sfx = cmd.sfx;
+            ch->end = paintedtime + (sc ? sc->length : 0) - ch->pos;
+            break;
+        case SND_CMD_STOP: ch->sfx = nullptr; break;
+        case SND_CMD_STOPALL: break;
+    }
+}
+
+/*
+================
+SND_ApplyCommands
+
+must be called with Cache_Mutex held while there is a mixer thread
+================
+*/
+void SND_ApplyCommands()
+{
+    const unsigned int head = snd_commandhead.load(std::memory_order_acquire);
+    unsigned int tail = snd_commandtail.load(std::memory_order_relaxed);
+
+    for(; tail != head; tail++)
+    {
+        SND_ApplyCommand(snd_commands[tail & (SND_MAXCOMMANDS - 1)]);
+    }
+
+    snd_commandtail.store(tail, std::memory_order_release);
+}
+
+/*
+================
+SND_ChannelPos
+
+the mixer's position in a channel's sound once the queued commands are
+applied, or -1 if it's done with the sound. must be called with Cache_Mutex
+held.
+================
+*/
+int SND_ChannelPos(const channel_t* ch)
+{
+    SND_ApplyCommands();
+
+    const int channel = ch - snd_channels;
+    if(channel >= (int)mix_channels.size() ||
+        mix_channels[channel].sfx != ch->sfx)
+    {
+        return -1;
+    }
+
+    return mix_channels[channel].pos;
+}
+
+/*
+================
+SND_ShiftChannel
+
+moves the mixer's position in a streamed sound after the stream discarded or
+appended samples, and returns the channel's new end time. applied right away
+rather than queued, so that it must be called with Cache_Mutex held, in the
+same critical section that rewrote the data: the mixer never paints the new
+data at the old position.
+================
+*/
+int SND_ShiftChannel(const channel_t* ch, int pos)
+{
+    SND_ApplyCommands();
+
+    sndcmd_t cmd{};
+    cmd.type = SND_CMD_SHIFT;
+    cmd.channel = ch - snd_channels;
+    cmd.sfx = ch->sfx;
+    cmd.pos = pos;
+    SND_ApplyCommand(cmd);
+
+    return mix_channels[cmd.channel].end;
+}
+
+/*
+===============================================================================
+
+STEREO 16 BIT TRANSFER
+
+bounds and converts the float paintbuffer to 16 bit samples in one pass, with
+scalar, SSE2 and AVX2 versions producing the same output
+
+===============================================================================
+*/
+
+static void Snd_WriteLinearBlastStereo16Scalar(
+    const float* in, short* out, int i, int count)
+{
+    for(; i < count; i++)
+    {
+        out[i] = (short)CLAMP(-32768.f, in[i] * (1.f / 256.f), 32767.f);
+    }
+}
+
+#if QUAKE_SIMD_X86
+static void Snd_WriteLinearBlastStereo16SSE2(
+    const float* in, short* out, int count)
+{
+    const __m128 scale = _mm_set1_ps(1.f / 256.f);
+    const __m128 lo = _mm_set1_ps(-32768.f);
+    const __m128 hi = _mm_set1_ps(32767.f);
+    int i = 0;
+
+    for(; i + 8 <= count; i += 8)
+    {
+        const __m128 a = _mm_min_ps(
+            _mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i), scale), lo), hi);
+        const __m128 b = _mm_min_ps(
+            _mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i + 4), scale), lo), hi);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+            _mm_packs_epi32(_mm_cvttps_epi32(a), _mm_cvttps_epi32(b)));
+    }
+
+    Snd_WriteLinearBlastStereo16Scalar(in, out, i, count);
+}
+
+QUAKE_TARGET_AVX2 static void Snd_WriteLinearBlastStereo16AVX2(
+    const float* in, short* out, int count)
+{
+    const __m256 scale = _mm256_set1_ps(1.f / 256.f);
+    const __m256 lo = _mm256_set1_ps(-32768.f);
+    const __m256 hi = _mm256_set1_ps(32767.f);
+    int i = 0;
+
+    for(; i + 16 <= count; i += 16)
+    {
+        const __m256i a = _mm256_cvttps_epi32(_mm256_min_ps(
+            _mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(in + i), scale), lo),
+            hi));
+        const __m256i b = _mm256_cvttps_epi32(_mm256_min_ps(
+            _mm256_max_ps(
+                _mm256_mul_ps(_mm256_loadu_ps(in + i + 8), scale), lo),
+            hi));
+
+        // the pack works within 128 bit lanes, put the quarters back in order
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+            _mm256_permute4x64_epi64(
+                _mm256_packs_epi32(a, b), _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+
+    Snd_WriteLinearBlastStereo16Scalar(in, out, i, count);
+}
+#endif
+
+static void Snd_WriteLinearBlastStereo16(
+    const float* in, short* out, int count)
+{
+    switch(snd_level)
+    {
+#if QUAKE_SIMD_X86
+        case quake::simd::Level::AVX2:
+            Snd_WriteLinearBlastStereo16AVX2(in, out, count);
+            return;
+        case quake::simd::Level::SSE2:
+            Snd_WriteLinearBlastStereo16SSE2(in, out, count);
+            return;
+#endif
+        default: Snd_WriteLinearBlastStereo16Scalar(in, out, 0, count);
     }
 }
 
@@ -77,8 +306,11 @@ static void S_TransferStereo16(int endtime)
 {
     int lpos;
     int lpaintedtime;
+    int linear_count;
+    const float* p;
+    short* out;
 
-    snd_p = (int*)paintbuffer;
+    p = (const float*)paintbuffer;
     lpaintedtime = paintedtime;
 
     while(lpaintedtime < endtime)
@@ -86,21 +318,21 @@ static void S_TransferStereo16(int endtime)
         // handle recirculating buffer issues
         lpos = lpaintedtime & ((shm->samples >> 1) - 1);
 
-        snd_out = (short*)shm->buffer + (lpos << 1);
+        out = (short*)shm->buffer + (lpos << 1);
 
-        snd_linear_count = (shm->samples >> 1) - lpos;
-        if(lpaintedtime + snd_linear_count > endtime)
+        linear_count = (shm->samples >> 1) - lpos;
+        if(lpaintedtime + linear_count > endtime)
         {
-            snd_linear_count = endtime - lpaintedtime;
+            linear_count = endtime - lpaintedtime;
         }
 
-        snd_linear_count <<= 1;
+        linear_count <<= 1;
 
         // write a linear blast of samples
-        Snd_WriteLinearBlastStereo16();
+        Snd_WriteLinearBlastStereo16(p, out, linear_count);
 
-        snd_p += snd_linear_count;
-        lpaintedtime += (snd_linear_count >> 1);
+        p += linear_count;
+        lpaintedtime += (linear_count >> 1);
     }
 }
 
@@ -111,7 +343,7 @@ static void S_TransferPaintBuffer(int endtime)
     int count;
     int step;
     int val;
-    int* p;
+    const float* p;
 
     if(shm->samplebits == 16 && shm->channels == 2)
     {
@@ -119,7 +351,7 @@ static void S_TransferPaintBuffer(int endtime)
         return;
     }
 
-    p = (int*)paintbuffer;
+    p = (const float*)paintbuffer;
     count = (endtime - paintedtime) * shm->channels;
     out_mask = shm->samples - 1;
     out_idx = paintedtime * shm->channels & out_mask;
@@ -130,16 +362,8 @@ static void S_TransferPaintBuffer(int endtime)
         auto* out = (short*)shm->buffer;
         while(count--)
         {
-            val = *p / 256;
+            val = CLAMP(-32768.f, *p * (1.f / 256.f), 32767.f);
             p += step;
-            if(val > 0x7fff)
-            {
-                val = 0x7fff;
-            }
-            else if(val < (short)0x8000)
-            {
-                val = (short)0x8000;
-            }
             out[out_idx] = val;
             out_idx = (out_idx + 1) & out_mask;
         }
@@ -149,16 +373,8 @@ static void S_TransferPaintBuffer(int endtime)
         unsigned char* out = shm->buffer;
         while(count--)
         {
-            val = *p / 256;
+            val = CLAMP(-32768.f, *p * (1.f / 256.f), 32767.f);
             p += step;
-            if(val > 0x7fff)
-            {
-                val = 0x7fff;
-            }
-            else if(val < (short)0x8000)
-            {
-                val = (short)0x8000;
-            }
             out[out_idx] = (val / 256) + 128;
             out_idx = (out_idx + 1) & out_mask;
         }
@@ -168,16 +384,8 @@ static void S_TransferPaintBuffer(int endtime)
         auto* out = (signed char*)shm->buffer;
         while(count--)
         {
-            val = *p / 256;
+            val = CLAMP(-32768.f, *p * (1.f / 256.f), 32767.f);
             p += step;
-            if(val > 0x7fff)
-            {
-                val = 0x7fff;
-            }
-            else if(val < (short)0x8000)
-            {
-                val = (short)0x8000;
-            }
             out[out_idx] = (val / 256);
             out_idx = (out_idx + 1) & out_mask;
         }
@@ -232,7 +440,7 @@ static void S_MakeBlackmanWindowKernel(float* kernel, int M, float f_c)
 typedef struct
 {
     float* memory;  // kernelsize floats
-    float* kernel;  // kernelsize floats
+    float* kernel;  // kernelsize floats, the taps of each parity in turn
     int kernelsize; // M+1, rounded up to be a multiple of 16
     int M;          // M value used to make kernel, even
     int parity;     // 0-3
@@ -261,10 +469,89 @@ static void S_UpdateFilter(filter_t* filter, int M, float f_c)
         filter->memory = (float*)calloc(filter->kernelsize, sizeof(float));
         filter->kernel = (float*)calloc(filter->kernelsize, sizeof(float));
 
-        S_MakeBlackmanWindowKernel(filter->kernel, M, f_c);
+        float* kernel = (float*)calloc(filter->kernelsize, sizeof(float));
+        S_MakeBlackmanWindowKernel(kernel, M, f_c);
+
+        // at each parity only every 4th tap meets a nonzero input sample (see
+        // S_ApplyFilter), so store those taps together
+        const int taps = filter->kernelsize / 4;
+        for(int parity = 0; parity < 4; parity++)
+        {
+            for(int i = 0; i < taps; i++)
+            {
+                filter->kernel[parity * taps + i] =
+                    kernel[(4 - parity) % 4 + i * 4];
+            }
+        }
+
+        free(kernel);
     }
 }
 
+/*
+==============
+S_FilterSample
+
+dot product of 'taps' kernel taps (a multiple of 4) with the input, summed in
+four interleaved partial sums. the SSE2 and AVX2 versions add in the same
+order, so all of them give the same result.
+==============
+*/
+static float S_FilterSampleScalar(
+    const float* kernel, const float* input, int taps)
+{
+    float val[4] = {0, 0, 0, 0};
+
+    for(int i = 0; i < taps; i += 4)
+    {
+        val[0] += kernel[i] * input[i];
+        val[1] += kernel[i + 1] * input[i + 1];
+        val[2] += kernel[i + 2] * input[i + 2];
+        val[3] += kernel[i + 3] * input[i + 3];
+    }
+
+    return val[0] + val[1] + val[2] + val[3];
+}
+
+#if QUAKE_SIMD_X86
+static float S_FilterSampleSSE2(
+    const float* kernel, const float* input, int taps)
+{
+    __m128 acc = _mm_setzero_ps();
+
+    for(int i = 0; i < taps; i += 4)
+    {
+        acc = _mm_add_ps(acc,
+            _mm_mul_ps(_mm_loadu_ps(kernel + i), _mm_loadu_ps(input + i)));
+    }
+
+    alignas(16) float val[4];
+    _mm_store_ps(val, acc);
+    return val[0] + val[1] + val[2] + val[3];
+}
+
+// two output samples at once, one per 128 bit lane, each computed exactly like
+// S_FilterSampleSSE2
+QUAKE_TARGET_AVX2 static void S_FilterSamplePairAVX2(const float* kernel0,
+    const float* input0, const float* kernel1, const float* input1, int taps,
+    float* out)
+{
+    __m256 acc = _mm256_setzero_ps();
+
+    for(int i = 0; i < taps; i += 4)
+    {
+        acc = _mm256_add_ps(acc,
+            _mm256_mul_ps(_mm256_loadu2_m128(kernel1 + i, kernel0 + i),
+                _mm256_loadu2_m128(input1 + i, input0 + i)));
+    }
+
+    alignas(32) float val[8];
+    _mm256_store_ps(val, acc);
+    out[0] = val[0] + val[1] + val[2] + val[3];
+    out[1] = val[4] + val[5] + val[6] + val[7];
+}
+#endif
+
 /*
 ==============
 S_ApplyFilter
@@ -275,18 +562,22 @@ As an optimization, it decimates the audio to 11025Hz (setting every sample
 position that's not a multiple of 4 to 0), then convoluting with the filter
 kernel is 4x faster, because we can skip 3/4 of the input samples that are
 known to be 0 and skip 3/4 of the filter kernel.
+
+The samples that are kept are packed together first, so that every output
+sample is a contiguous dot product.
 ==============
 */
-static void S_ApplyFilter(filter_t* filter, int* data, int stride, int count)
+static void S_ApplyFilter(filter_t* filter, float* data, int stride, int count)
 {
     int i;
-    int j;
     float* input;
+    float* decimated;
     const int kernelsize = filter->kernelsize;
-    const float* kernel = filter->kernel;
+    const int taps = kernelsize / 4;
     int parity;
 
-    input = (float*)malloc(sizeof(float) * (filter->kernelsize + count));
+    input = (float*)malloc(
+        sizeof(float) * (kernelsize + count + (kernelsize + count) / 4 + 1));
 
     // QSS
     if(!input)
@@ -301,32 +592,73 @@ static void S_ApplyFilter(filter_t* filter, int* data, int stride, int count)
 
     for(i = 0; i < count; i++)
     {
-        input[filter->kernelsize + i] = data[i * stride] / (32768.0 * 256.0);
+        input[filter->kernelsize + i] =
+            data[i * stride] * (1.f / (32768.f * 256.f));
     }
 
     // copy out the last filter->kernelsize samples to 'memory' for next time
     memcpy(filter->memory, input + count, filter->kernelsize * sizeof(float));
 
-    // apply the filter
+    // output sample i at parity p reads input[i + (4 - p) % 4 + 4 * n]. the
+    // parity advances with i, so those are always the same phase of input.
     parity = filter->parity;
 
-    for(i = 0; i < count; i++)
+    const int first = (4 - parity) % 4;
+    const int numdecimated = (kernelsize + count - first + 3) / 4;
+    decimated = input + kernelsize + count;
+
+    for(i = 0; i < numdecimated; i++)
+    {
+        decimated[i] = input[first + i * 4];
+    }
+
+    // apply the filter
+    // 4.0 factor is to increase volume by 12 dB; this is to make up the
+    // volume drop caused by the zero-filling this filter does.
+    const float gain = 32768.f * 256.f * 4.f;
+
+    i = 0;
+
+#if QUAKE_SIMD_X86
+    if(snd_level == quake::simd::Level::AVX2)
     {
-        const float* input_plus_i = input + i;
-        float val[4] = {0, 0, 0, 0};
+        for(; i + 2 <= count; i += 2)
+        {
+            const int parity1 = (parity + 1) % 4;
+            float val[2];
+
+            S_FilterSamplePairAVX2(filter->kernel + parity * taps,
+                decimated + (i + (4 - parity) % 4 - first) / 4,
+                filter->kernel + parity1 * taps,
+                decimated + (i + 1 + (4 - parity1) % 4 - first) / 4, taps,
+                val);
+
+            data[i * stride] = val[0] * gain;
+            data[(i + 1) * stride] = val[1] * gain;
 
-        for(j = (4 - parity) % 4; j < kernelsize; j += 16)
+            parity = (parity + 2) % 4;
+        }
+    }
+#endif
+
+    for(; i < count; i++)
+    {
+        const float* kernel = filter->kernel + parity * taps;
+        const float* samples = decimated + (i + (4 - parity) % 4 - first) / 4;
+        float val;
+
+        switch(snd_level)
         {
-            val[0] += kernel[j] * input_plus_i[j];
-            val[1] += kernel[j + 4] * input_plus_i[j + 4];
-            val[2] += kernel[j + 8] * input_plus_i[j + 8];
-            val[3] += kernel[j + 12] * input_plus_i[j + 12];
+#if QUAKE_SIMD_X86
+            case quake::simd::Level::AVX2:
+            case quake::simd::Level::SSE2:
+                val = S_FilterSampleSSE2(kernel, samples, taps);
+                break;
+#endif
+            default: val = S_FilterSampleScalar(kernel, samples, taps);
         }
 
-        // 4.0 factor is to increase volume by 12 dB; this is to make up the
-        // volume drop caused by the zero-filling this filter does.
-        data[i * stride] =
-            (val[0] + val[1] + val[2] + val[3]) * (32768.0 * 256.0 * 4.0);
+        data[i * stride] = val * gain;
 
         parity = (parity + 1) % 4;
     }
@@ -340,12 +672,13 @@ static void S_ApplyFilter(filter_t* filter, int* data, int stride, int count)
 ==============
 S_LowpassFilter
 
-lowpass filters 24-bit integer samples in 'data' (stored in 32-bit ints).
+lowpass filters 24-bit samples in 'data' (stored in floats).
 assumes 44100Hz sample rate, and lowpasses at around 5kHz
 memory should be a zero-filled filter_t struct
 ==============
 */
-static void S_LowpassFilter(int* data, int stride, int count, filter_t* memory)
+static void S_LowpassFilter(
+    float* data, int stride, int count, filter_t* memory)
 {
     int M;
     float bw;
@@ -387,13 +720,247 @@ static void S_LowpassFilter(int* data, int stride, int count, filter_t* memory)
 
 CHANNEL MIXING
 
+each channel is mono: its samples are scaled by the left and right volumes and
+added to the interleaved stereo paintbuffer. the SIMD versions do the same
+multiplies and adds as the scalar one, so they give the same output.
+
 ===============================================================================
 */
 
+template <typename T>
+static void SND_PaintMonoScalar(float* out, const T* sfx, int i, int count,
+    float leftscale, float rightscale)
+{
+    for(; i < count; i++)
+    {
+        const float data = sfx[i];
+        out[i * 2] += data * leftscale;
+        out[i * 2 + 1] += data * rightscale;
+    }
+}
+
+#if QUAKE_SIMD_X86
+// adds four samples, scaled by 'scale' (left, right, left, right), to four
+// stereo pairs of 'out'
+static void SND_PaintFourSSE2(float* out, const __m128i samples, __m128 scale)
+{
+    const __m128 data = _mm_cvtepi32_ps(samples);
+
+    _mm_storeu_ps(out, _mm_add_ps(_mm_loadu_ps(out),
+                           _mm_mul_ps(_mm_unpacklo_ps(data, data), scale)));
+    _mm_storeu_ps(out + 4, _mm_add_ps(_mm_loadu_ps(out + 4),
+                               _mm_mul_ps(_mm_unpackhi_ps(data, data), scale)));
+}
+
+// adds eight signed 16 bit samples to eight stereo pairs of 'out'
+static void SND_PaintEightSSE2(float* out, const __m128i samples, __m128 scale)
+{
+    const __m128i sign = _mm_srai_epi16(samples, 15);
+
+    SND_PaintFourSSE2(out, _mm_unpacklo_epi16(samples, sign), scale);
+    SND_PaintFourSSE2(out + 8, _mm_unpackhi_epi16(samples, sign), scale);
+}
+
+static void SND_PaintMono8SSE2(float* out, const signed char* sfx, int count,
+    float leftscale, float rightscale)
+{
+    const __m128 scale =
+        _mm_setr_ps(leftscale, rightscale, leftscale, rightscale);
+    int i = 0;
+
+    for(; i + 16 <= count; i += 16)
+    {
+        const __m128i data =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(sfx + i));
+        const __m128i sign = _mm_cmplt_epi8(data, _mm_setzero_si128());
+
+        SND_PaintEightSSE2(out + i * 2, _mm_unpacklo_epi8(data, sign), scale);
+        SND_PaintEightSSE2(
+            out + i * 2 + 16, _mm_unpackhi_epi8(data, sign), scale);
+    }
+
+    SND_PaintMonoScalar(out, sfx, i, count, leftscale, rightscale);
+}
+
+static void SND_PaintMono16SSE2(float* out, const short* sfx, int count,
+    float leftscale, float rightscale)
+{
+    const __m128 scale =
+        _mm_setr_ps(leftscale, rightscale, leftscale, rightscale);
+    int i = 0;
+
+    for(; i + 8 <= count; i += 8)
+    {
+        SND_PaintEightSSE2(out + i * 2,
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(sfx + i)), scale);
+    }
+
+    SND_PaintMonoScalar(out, sfx, i, count, leftscale, rightscale);
+}
+
+// adds eight samples, already widened to 32 bits, to eight stereo pairs of
+// 'out'
+QUAKE_TARGET_AVX2 static void SND_PaintEightAVX2(
+    float* out, const __m256i samples, __m256 scale)
+{
+    const __m256 data = _mm256_cvtepi32_ps(samples);
+    const __m256 lo = _mm256_permutevar8x32_ps(
+        data, _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3));
+    const __m256 hi = _mm256_permutevar8x32_ps(
+        data, _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7));
+
+    _mm256_storeu_ps(
+        out, _mm256_add_ps(_mm256_loadu_ps(out), _mm256_mul_ps(lo, scale)));
+    _mm256_storeu_ps(out + 8,
+        _mm256_add_ps(_mm256_loadu_ps(out + 8), _mm256_mul_ps(hi, scale)));
+}
+
+QUAKE_TARGET_AVX2 static void SND_PaintMono8AVX2(float* out,
+    const signed char* sfx, int count, float leftscale, float rightscale)
+{
+    const __m256 scale = _mm256_setr_ps(leftscale, rightscale, leftscale,
+        rightscale, leftscale, rightscale, leftscale, rightscale);
+    int i = 0;
+
+    for(; i + 8 <= count; i += 8)
+    {
+        SND_PaintEightAVX2(out + i * 2,
+            _mm256_cvtepi8_epi32(
+                _mm_loadl_epi64(reinterpret_cast<const __m128i*>(sfx + i))),
+            scale);
+    }
+
+    SND_PaintMonoScalar(out, sfx, i, count, leftscale, rightscale);
+}
+
+QUAKE_TARGET_AVX2 static void SND_PaintMono16AVX2(float* out,
+    const short* sfx, int count, float leftscale, float rightscale)
+{
+    const __m256 scale = _mm256_setr_ps(leftscale, rightscale, leftscale,
+        rightscale, leftscale, rightscale, leftscale, rightscale);
+    int i = 0;
+
+    for(; i + 8 <= count; i += 8)
+    {
+        SND_PaintEightAVX2(out + i * 2,
+            _mm256_cvtepi16_epi32(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(sfx + i))),
+            scale);
+    }
+
+    SND_PaintMonoScalar(out, sfx, i, count, leftscale, rightscale);
+}
+#endif
+
+static void SND_PaintMono8(float* out, const signed char* sfx, int count,
+    float leftscale, float rightscale)
+{
+    switch(snd_level)
+    {
+#if QUAKE_SIMD_X86
+        case quake::simd::Level::AVX2:
+            SND_PaintMono8AVX2(out, sfx, count, leftscale, rightscale);
+            return;
+        case quake::simd::Level::SSE2:
+            SND_PaintMono8SSE2(out, sfx, count, leftscale, rightscale);
+            return;
+#endif
+        default:
+            SND_PaintMonoScalar(out, sfx, 0, count, leftscale, rightscale);
+    }
+}
+
+static void SND_PaintMono16(float* out, const short* sfx, int count,
+    float leftscale, float rightscale)
+{
+    switch(snd_level)
+    {
+#if QUAKE_SIMD_X86
+        case quake::simd::Level::AVX2:
+            SND_PaintMono16AVX2(out, sfx, count, leftscale, rightscale);
+            return;
+        case quake::simd::Level::SSE2:
+            SND_PaintMono16SSE2(out, sfx, count, leftscale, rightscale);
+            return;
+#endif
+        default:
+            SND_PaintMonoScalar(out, sfx, 0, count, leftscale, rightscale);
+    }
+}
+
+/*
+==============
+S_ClipPaintBuffer
+
+clip each sample to 0dB, then reduce by 6dB (to leave some headroom for the
+lowpass filter and the music). the lowpass will smooth out the clipping
+==============
+*/
+static void S_ClipPaintBufferScalar(float* data, int i, int count)
+{
+    for(; i < count; i++)
+    {
+        data[i] = CLAMP(-32768.f * 256.f, data[i], 32767.f * 256.f) * 0.5f;
+    }
+}
+
+#if QUAKE_SIMD_X86
+static void S_ClipPaintBufferSSE2(float* data, int count)
+{
+    const __m128 lo = _mm_set1_ps(-32768.f * 256.f);
+    const __m128 hi = _mm_set1_ps(32767.f * 256.f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    int i = 0;
+
+    for(; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_ps(data + i,
+            _mm_mul_ps(
+                _mm_min_ps(_mm_max_ps(_mm_loadu_ps(data + i), lo), hi), half));
+    }
+
+    S_ClipPaintBufferScalar(data, i, count);
+}
+
+QUAKE_TARGET_AVX2 static void S_ClipPaintBufferAVX2(float* data, int count)
+{
+    const __m256 lo = _mm256_set1_ps(-32768.f * 256.f);
+    const __m256 hi = _mm256_set1_ps(32767.f * 256.f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    int i = 0;
+
+    for(; i + 8 <= count; i += 8)
+    {
+        _mm256_storeu_ps(data + i,
+            _mm256_mul_ps(
+                _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(data + i), lo), hi),
+                half));
+    }
+
+    S_ClipPaintBufferScalar(data, i, count);
+}
+#endif
+
+static void S_ClipPaintBuffer(float* data, int count)
+{
+    switch(snd_level)
+    {
+#if QUAKE_SIMD_X86
+        case quake::simd::Level::AVX2:
+            S_ClipPaintBufferAVX2(data, count);
+            return;
+        case quake::simd::Level::SSE2:
+            S_ClipPaintBufferSSE2(data, count);
+            return;
+#endif
+        default: S_ClipPaintBufferScalar(data, 0, count);
+    }
+}
+
 static void SND_PaintChannelFrom8(
-    channel_t* ch, sfxcache_t* sc, int endtime, int paintbufferstart);
+    mixchannel_t* ch, sfxcache_t* sc, int endtime, int paintbufferstart);
 static void SND_PaintChannelFrom16(
-    channel_t* ch, sfxcache_t* sc, int endtime, int paintbufferstart);
+    mixchannel_t* ch, sfxcache_t* sc, int endtime, int paintbufferstart);
 
 void S_PaintChannels(int endtime)
 {
@@ -401,10 +968,10 @@ void S_PaintChannels(int endtime)
     int end;
     int ltime;
     int count;
-    channel_t* ch;
     sfxcache_t* sc;
 
     snd_vol = sfxvolume.value * 256;
+    snd_level = quake::simd::clampLevel(snd_mix_simd.value);
 
     while(paintedtime < endtime)
     {
@@ -417,22 +984,22 @@ void S_PaintChannels(int endtime)
 
         // clear the paint buffer
         memset(paintbuffer, 0,
-            (end - paintedtime) * sizeof(portable_samplepair_t));
+            (end - paintedtime) * sizeof(paintsample_t));
 
         // paint in the channels.
-        ch = snd_channels;
-        for(i = 0; i < total_channels; i++, ch++)
+        for(mixchannel_t& chref : mix_channels)
         {
+            mixchannel_t* ch = &chref;
             if(!ch->sfx)
             {
                 continue;
             }
-            if(!ch->leftvol && !ch->rightvol)
+            sc = (sfxcache_t*)ch->sfx->cache.data;
+            if(!sc)
             {
                 continue;
             }
-            sc = S_LoadSound(ch->sfx);
-            if(!sc)
+            if(!ch->leftvol && !ch->rightvol)
             {
                 continue;
             }
@@ -472,7 +1039,7 @@ void S_PaintChannels(int endtime)
                 // if at end of loop, restart
                 if(ltime >= ch->end)
                 {
-                    if(sc->loopstart >= 0)
+                    if(sc->loopstart >= 0 && sc->length > sc->loopstart)
                     {
                         ch->pos = sc->loopstart;
                         ch->end = ltime + sc->length - ch->pos;
@@ -487,42 +1054,36 @@ void S_PaintChannels(int endtime)
             }
         }
 
-        // clip each sample to 0dB, then reduce by 6dB (to leave some headroom
-        // for the lowpass filter and the music). the lowpass will smooth out
-        // the clipping
-        for(i = 0; i < end - paintedtime; i++)
-        {
-            paintbuffer[i].left =
-                CLAMP(-32768 * 256, paintbuffer[i].left, 32767 * 256) / 2;
-            paintbuffer[i].right =
-                CLAMP(-32768 * 256, paintbuffer[i].right, 32767 * 256) / 2;
-        }
+        S_ClipPaintBuffer((float*)paintbuffer, (end - paintedtime) * 2);
 
         // apply a lowpass filter
         if(sndspeed.value == 11025 && shm->speed == 44100)
         {
             static filter_t memory_l;
             static filter_t memory_r;
-            S_LowpassFilter((int*)paintbuffer, 2, end - paintedtime, &memory_l);
             S_LowpassFilter(
-                ((int*)paintbuffer) + 1, 2, end - paintedtime, &memory_r);
+                (float*)paintbuffer, 2, end - paintedtime, &memory_l);
+            S_LowpassFilter(
+                ((float*)paintbuffer) + 1, 2, end - paintedtime, &memory_r);
         }
 
-        // paint in the music
-        if(s_rawend >= paintedtime)
+        // paint in the music; the samples before rawend are complete
+        const int rawend = s_rawend;
+        const int ptime = paintedtime;
+        if(rawend >= ptime)
         {
             // copy from the streaming sound source
             int s;
             int stop;
 
-            stop = (end < s_rawend) ? end : s_rawend;
+            stop = (end < rawend) ? end : rawend;
 
-            for(i = paintedtime; i < stop; i++)
+            for(i = ptime; i < stop; i++)
             {
                 s = i & (MAX_RAW_SAMPLES - 1);
                 // lower music by 6db to match sfx
-                paintbuffer[i - paintedtime].left += s_rawsamples[s].left / 2;
-                paintbuffer[i - paintedtime].right += s_rawsamples[s].right / 2;
+                paintbuffer[i - ptime].left += s_rawsamples[s].left / 2;
+                paintbuffer[i - ptime].right += s_rawsamples[s].right / 2;
             }
             //	if (i != end)
             //		Con_Printf ("partial stream\n");
@@ -539,36 +1100,18 @@ void S_PaintChannels(int endtime)
 void SND_InitScaletable()
 {
     int i;
-    int j;
-    int scale;
 
+    // 8 bit sounds keep the 32 volume steps of the old lookup table
     for(i = 0; i < 32; i++)
     {
-        scale = i * 8 * 256 * sfxvolume.value;
-        for(j = 0; j < 256; j++)
-        {
-            /* When compiling with gcc-4.1.0 at optimisations O1 and
-               higher, the tricky signed char type conversion is not
-               guaranteed. Therefore we explicity calculate the signed
-               value from the index as required. From Kevin Shanahan.
-               See: http://gcc.gnu.org/bugzilla/show_bug.cgi?id=26719
-            */
-            //	snd_scaletable[i][j] = ((signed char)j) * scale;
-            snd_scaletable[i][j] = ((j < 128) ? j : j - 256) * scale;
-        }
+        snd_scaletable[i] = (int)(i * 8 * 256 * sfxvolume.value);
     }
 }
 
 
 static void SND_PaintChannelFrom8(
-    channel_t* ch, sfxcache_t* sc, int count, int paintbufferstart)
+    mixchannel_t* ch, sfxcache_t* sc, int count, int paintbufferstart)
 {
-    int data;
-    int* lscale;
-    int* rscale;
-    unsigned char* sfx;
-    int i;
-
     if(ch->leftvol > 255)
     {
         ch->leftvol = 255;
@@ -578,49 +1121,29 @@ static void SND_PaintChannelFrom8(
         ch->rightvol = 255;
     }
 
-    lscale = snd_scaletable[ch->leftvol >> 3];
-    rscale = snd_scaletable[ch->rightvol >> 3];
-    sfx = (unsigned char*)sc->data + ch->pos;
-
-    for(i = 0; i < count; i++)
-    {
-        data = sfx[i];
-        paintbuffer[paintbufferstart + i].left += lscale[data];
-        paintbuffer[paintbufferstart + i].right += rscale[data];
-    }
+    SND_PaintMono8((float*)(paintbuffer + paintbufferstart),
+        (const signed char*)sc->data + ch->pos, count,
+        snd_scaletable[ch->leftvol >> 3], snd_scaletable[ch->rightvol >> 3]);
 
     ch->pos += count;
 }
 
 static void SND_PaintChannelFrom16(
-    channel_t* ch, sfxcache_t* sc, int count, int paintbufferstart)
+    mixchannel_t* ch, sfxcache_t* sc, int count, int paintbufferstart)
 {
-    int data;
-    int left;
-    int right;
     int leftvol;
     int rightvol;
-    signed short* sfx;
-    int i;
 
+    // this was causing integer overflow as observed in quakespasm with the
+    // warpspasm mod when the samples were scaled by >>8 after multiplying,
+    // so the >>8 is applied to left/right volume here.
     leftvol = ch->leftvol * snd_vol;
     rightvol = ch->rightvol * snd_vol;
     leftvol /= 256;
     rightvol /= 256;
-    sfx = (signed short*)sc->data + ch->pos;
 
-    for(i = 0; i < count; i++)
-    {
-        data = sfx[i];
-        // this was causing integer overflow as observed in quakespasm
-        // with the warpspasm mod moved >>8 to left/right volume above.
-        //	left = (data * leftvol) >> 8;
-        //	right = (data * rightvol) >> 8;
-        left = data * leftvol;
-        right = data * rightvol;
-        paintbuffer[paintbufferstart + i].left += left;
-        paintbuffer[paintbufferstart + i].right += right;
-    }
+    SND_PaintMono16((float*)(paintbuffer + paintbufferstart),
+        (const short*)sc->data + ch->pos, count, leftvol, rightvol);
 
     ch->pos += count;
 }
@@ -0,0 +1,165 @@
+/*
+Copyright (C) 1996-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+// snd_null.cpp -- sound, music and voice capture for the dedicated server,
+// which plays nothing. Sounds started by QC reach the clients through
+// `SV_StartSound`, not through these. The headless timedemo plays nothing
+// either, but its client still has to read past the voice chat it receives.
+
+#include "quakedef.hpp"
+#include "q_sound.hpp"
+#include "bgmusic.hpp"
+#include "snd_voip.hpp"
+#include "msg.hpp"
+
+void S_Init()
+{
+}
+
+void S_Shutdown()
+{
+}
+
+void S_Update(const qvec3& origin, const qvec3& forward, const qvec3& right,
+    const qvec3& up)
+{
+    (void)origin;
+    (void)forward;
+    (void)right;
+    (void)up;
+}
+
+void S_StartSound(int entnum, int entchannel, sfx_t* sfx, const qvec3& origin,
+    float fvol, float attenuation)
+{
+    (void)entnum;
+    (void)entchannel;
+    (void)sfx;
+    (void)origin;
+    (void)fvol;
+    (void)attenuation;
+}
+
+void S_StaticSound(
+    sfx_t* sfx, const qvec3& origin, float vol, float attenuation)
+{
+    (void)sfx;
+    (void)origin;
+    (void)vol;
+    (void)attenuation;
+}
+
+void S_StopSound(int entnum, int entchannel)
+{
+    (void)entnum;
+    (void)entchannel;
+}
+
+void S_StopAllSounds(bool clear)
+{
+    (void)clear;
+}
+
+void S_TouchSound(const char* sample)
+{
+    (void)sample;
+}
+
+sfx_t* S_PrecacheSound(const char* sample)
+{
+    (void)sample;
+    return nullptr;
+}
+
+sfxcache_t* S_LoadSound(sfx_t* s)
+{
+    (void)s;
+    return nullptr;
+}
+
+void S_LocalSound(const char* name)
+{
+    (void)name;
+}
+
+void S_Voip_Transmit(unsigned char clc, sizebuf_t* buf)
+{
+    (void)clc;
+    (void)buf;
+}
+
+void S_Voip_MapChange()
+{
+}
+
+void S_Voip_Parse()
+{
+    (void)MSG_ReadByte(); // sender
+    (void)MSG_ReadByte(); // codec and generation
+    (void)MSG_ReadByte(); // sequence
+
+    for(int bytes = MSG_ReadShort(); bytes > 0; bytes--)
+    {
+        (void)MSG_ReadByte();
+    }
+}
+
+int S_Voip_Loudness(bool ignorevad)
+{
+    (void)ignorevad;
+    return -1;
+}
+
+bool S_Voip_Speaking(unsigned int plno)
+{
+    (void)plno;
+    return false;
+}
+
+bool BGM_Init()
+{
+    return false;
+}
+
+void BGM_Shutdown()
+{
+}
+
+void BGM_Update()
+{
+}
+
+void BGM_Stop()
+{
+}
+
+void BGM_Pause()
+{
+}
+
+void BGM_Resume()
+{
+}
+
+void BGM_PlayCDtrack(byte track, bool looping)
+{
+    (void)track;
+    (void)looping;
+}
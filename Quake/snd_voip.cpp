@@ -1053,6 +1053,7 @@ static void S_RawClearStream(streaming_t* s)
     currentcache = (sfxcache_t*)Cache_Check(&s->sfx.cache);
     if(currentcache)
     {
+        std::lock_guard lock{Cache_Mutex()};
         currentcache->loopstart = -1; // stop mixing it
     }
 
@@ -1072,7 +1073,9 @@ static void S_RawClearStream(streaming_t* s)
         Cache_Free(&s->sfx.cache, false);
     }
 
-    // clear whole struct.
+    // clear whole struct. the mixer may still be on a channel of this
+    // stream, and only looks at its sfx with Cache_Mutex held.
+    std::lock_guard lock{Cache_Mutex()};
     memset(s, 0, sizeof(*s));
 }
 
@@ -1141,7 +1144,10 @@ void S_RawAudio(int sourceid, byte* data, unsigned int speed,
         sfxcache_t* newcache;
 
         // clear whole struct.
-        memset(s, 0, sizeof(*s));
+        {
+            std::lock_guard lock{Cache_Mutex()};
+            memset(s, 0, sizeof(*s));
+        }
         // allocate cache.
         newsize = MAX_RAW_CACHE + sizeof(sfxcache_t);
 
@@ -1156,7 +1162,10 @@ void S_RawAudio(int sourceid, byte* data, unsigned int speed,
         s->id = sourceid;
         // strcpy(s->sfx.name, ""); // FIXME: probably we should put some
         // specific tag name here?
-        s->sfx.cache.data = newcache;
+
+        // Cache_Alloc already pointed s->sfx at it, which the mixer may still
+        // have a channel on
+        std::lock_guard lock{Cache_Mutex()};
         newcache->speed = shm->speed;
         newcache->stereo = channelsnum - 1;
         newcache->width = width;
@@ -1176,6 +1185,9 @@ void S_RawAudio(int sourceid, byte* data, unsigned int speed,
         return;
     }
 
+    // the mixer reads the stream's data as it's rewritten below
+    std::unique_lock cacheLock{Cache_Mutex()};
+
     if(currentcache->speed != shm->speed ||
         currentcache->stereo != (int)channelsnum - 1 ||
         currentcache->width != (int)width)
@@ -1191,37 +1203,28 @@ void S_RawAudio(int sourceid, byte* data, unsigned int speed,
     speedfactor = (double)speed / shm->speed;
     outsamples = samples / speedfactor;
 
-    // prepadl is the length of data at the start of the sample which appears to
-    // be unused. its the amount of data that we can discard.
-    prepadl = 0x7fffffff;
+    // prepadl is the length of data at the start of the sample that the
+    // mixer has already played, which can be discarded. it's only known to
+    // the mixer, which can't paint until the data and its position in it
+    // have both been moved.
+    prepadl = -1;
     for(i = 0; i < total_channels; i++)
     {
         if(snd_channels[i].sfx == &s->sfx)
         {
-            if(prepadl > (snd_channels[i].pos /*>>PITCHSHIFT*/))
-            {
-                prepadl = (snd_channels[i].pos /*>>PITCHSHIFT*/);
-            }
+            prepadl = SND_ChannelPos(&snd_channels[i]);
             break;
         }
     }
 
-    if(prepadl == 0x7fffffff)
+    if(prepadl < 0)
     {
-        prepadl = 0;
+        // not playing, or played all there was
+        prepadl = currentcache->length;
         spare = 0;
-        if(spare > shm->speed)
-        {
-            Con_DPrintf("Sacrificed raw sound stream\n");
-            spare = 0; // too far out. sacrifice it all
-        }
     }
     else
     {
-        if(prepadl < 0)
-        {
-            prepadl = 0;
-        }
         spare = currentcache->length - prepadl;
         if(spare < 0)
         { // remaining samples since last time
@@ -1240,6 +1243,7 @@ void S_RawAudio(int sourceid, byte* data, unsigned int speed,
     if(newsize > MAX_RAW_CACHE)
     { // this can happen quite often when our playback driver isn't playing
       // sound due to the window not having focus.
+        cacheLock.unlock();
         Con_DPrintf("VOIP stream overflowed\n");
         S_RawClearStream(s);
         return;
@@ -1247,8 +1251,9 @@ void S_RawAudio(int sourceid, byte* data, unsigned int speed,
 
     // move along spare/remaning samples in the begging of the buffer.
     memmove(currentcache->data,
-        currentcache->data +
-            prepadl * (currentcache->stereo + 1) * currentcache->width,
+        currentcache->data + (currentcache->length - spare) *
+                                 (currentcache->stereo + 1) *
+                                 currentcache->width,
         spare * (currentcache->stereo + 1) * currentcache->width);
 
     currentcache->length = spare + outsamples;
@@ -1264,31 +1269,17 @@ void S_RawAudio(int sourceid, byte* data, unsigned int speed,
 
     currentcache->loopstart = -1; // currentcache->total_length;
 
-    for(i = 0; i < total_channels; i++)
+    if(i != total_channels)
     {
-        if(snd_channels[i].sfx == &s->sfx)
-        {
-#if 0
-			// FIXME: qqshka: hrm, should it be just like this all the time??? I think it should.
-			snd_channels[i].pos = 0;
-			snd_channels[i].end = paintedtime + currentcache->total_length;
-#else
-            snd_channels[i].pos -= prepadl; // * channels[i].rate;
-            snd_channels[i].end += outsamples;
-            snd_channels[i].master_vol =
-                (int)(volume * 255); // this should changed volume on alredy
-                                     // playing sound.
-
-            if(snd_channels[i].end < paintedtime)
-            {
-                snd_channels[i].pos = 0;
-                snd_channels[i].end = paintedtime + currentcache->length;
-            }
-#endif
-            break;
-        }
+        // the game side follows the mixer's end time, see S_ChannelPlaying
+        snd_channels[i].end = SND_ShiftChannel(&snd_channels[i], -prepadl);
+        snd_channels[i].master_vol =
+            (int)(volume * 255); // this should changed volume on alredy
+                                 // playing sound.
     }
 
+    cacheLock.unlock();
+
     // this one wasn't playing, lets start it then.
     if(i == total_channels)
     {
@@ -2807,24 +2798,14 @@ void S_Voip_Transmit(unsigned char clc, sizebuf_t* buf)
             { // the small size of various voip packets means that the 12 bytes
               // of angles overhead is going to give a noticable size
               // overhead...
-                byte b;
-                unsigned short s;
-                int i = LittleLong(5 + outpos);
-                fwrite(&i, 4, 1, cls.demofile);
-                for(i = 0; i < 3; i++)
-                {
-                    float f = LittleFloat(cl.viewangles[i]);
-                    fwrite(&f, 4, 1, cls.demofile);
-                }
-                b = clc;
-                fwrite(&b, 1, 1, cls.demofile);
-                b = (s_voip.enccodec << 4) | (s_voip.generation & 0x0f);
-                fwrite(&b, 1, 1, cls.demofile);
-                b = initseq;
-                fwrite(&b, 1, 1, cls.demofile);
-                s = outpos;
-                fwrite(&s, 2, 1, cls.demofile);
-                fwrite(outbuf, outpos, 1, cls.demofile);
+                byte packet[5 + sizeof(outbuf)];
+                packet[0] = clc;
+                packet[1] = (s_voip.enccodec << 4) | (s_voip.generation & 0x0f);
+                packet[2] = initseq;
+                packet[3] = outpos & 0xff;
+                packet[4] = (outpos >> 8) & 0xff;
+                memcpy(&packet[5], outbuf, outpos);
+                CL_WriteDemoPacket(packet, 5 + outpos);
             }
         }
 
@@ -2940,254 +2921,3 @@ void S_Voip_Init()
     Cmd_AddCommand("-voip", S_Voip_Disable_f);
     Cmd_AddCommand("voip", S_Voip_f);
 }
-
-
-/*****************************************************************************************************************************/
-/*server componant*/
-
-cvar_t sv_voip = {"sv_voip", "1"};
-cvar_t sv_voip_echo = {"sv_voip_echo", "0"};
-
-
-/*
-Pivicy issues:
-By sending voice chat to a server, you are unsure who might be listening.
-Server could be changed to record voice.
-Voice will be saved in any demos made of the game.
-You're never quite sure if anyone might join the server and your team before you
-finish saying a sentance. You run the risk of sounds around you being recorded
-by quake, including but not limited to: TV channels, loved ones, phones, YouTube
-videos featuring certain moans. Default on non-team games is to broadcast.
-*/
-
-#define VOICE_RING_SIZE 512 /*POT*/
-struct voice_t
-{
-    struct voice_ring_s
-    {
-        unsigned int sender;
-        unsigned char receiver[MAX_SCOREBOARD / 8];
-        unsigned char gen;
-        unsigned char seq;
-        unsigned int datalen;
-        unsigned char data[1024];
-    } ring[VOICE_RING_SIZE];
-    unsigned int write;
-} voice;
-void SV_VoiceReadPacket(client_t* client)
-{
-    unsigned int vt = client->voip.target;
-    unsigned int j;
-    voice_t::voice_ring_s* ring;
-    unsigned short bytes;
-    client_t* cl;
-    unsigned char gen = MSG_ReadByte();
-    unsigned char seq = MSG_ReadByte();
-    /*read the data from the client*/
-    bytes = MSG_ReadShort();
-    ring = &voice.ring[voice.write & (VOICE_RING_SIZE - 1)];
-    if(bytes > sizeof(ring->data) || !sv_voip.value)
-    {
-        while(bytes-- > 0) (void)MSG_ReadByte();
-        return;
-    }
-    else
-    {
-        voice.write++;
-        for(j = 0; j < bytes; j++) ring->data[j] = MSG_ReadByte();
-    }
-
-    ring->datalen = bytes;
-    ring->sender = client - svs.clients;
-    ring->gen = gen;
-    ring->seq = seq;
-
-    /*broadcast it its to their team, and its not teamplay*/
-    if(vt == client_voip_t::VT_TEAM && !teamplay.value)
-        vt = client_voip_t::VT_ALL;
-
-    /*figure out which team members are meant to receive it*/
-    for(j = 0; j < MAX_SCOREBOARD / 8; j++) ring->receiver[j] = 0;
-    for(j = 0, cl = svs.clients; j < (unsigned int)svs.maxclients; j++, cl++)
-    {
-        if(!cl->spawned || !cl->active) continue;
-
-        if(vt == client_voip_t::VT_TEAM)
-        {
-            if((cl->colors & 0xf) == (client->colors & 0xf))
-                continue; // on different teams
-        }
-        else if(vt == client_voip_t::VT_NONMUTED)
-        {
-            if(client->voip.mute[j >> 3] & (1 << (j & 3))) continue;
-        }
-        else if(vt >= client_voip_t::VT_PLAYERSLOT0)
-        {
-            if(j != vt - client_voip_t::VT_PLAYERSLOT0) continue;
-        }
-
-        ring->receiver[j >> 3] |= 1 << (j & 3);
-    }
-}
-void SV_VoiceInitClient(client_t* client)
-{
-    client->voip.target = client_voip_t::VT_TEAM;
-    client->voip.active = false;
-    client->voip.read = voice.write;
-    memset(client->voip.mute, 0, sizeof(client->voip.mute));
-}
-void SV_VoiceSendPacket(client_t* client, sizebuf_t* buf)
-{
-    unsigned int clno;
-    bool send;
-    voice_t::voice_ring_s* ring;
-
-    clno = client - svs.clients;
-
-    if(!client->voip.active)
-    {
-        client->voip.read = voice.write;
-        return;
-    }
-
-    while(client->voip.read < voice.write)
-    {
-        /*they might be too far behind*/
-        if(client->voip.read + VOICE_RING_SIZE < voice.write)
-            client->voip.read = voice.write - VOICE_RING_SIZE;
-
-        ring = &voice.ring[(client->voip.read) & (VOICE_RING_SIZE - 1)];
-
-        /*figure out if it was for us*/
-        send = false;
-        if(ring->receiver[clno >> 3] & (1 << (clno & 3))) send = true;
-
-        if(client->voip.mute[ring->sender >> 3] & (1 << (ring->sender & 3)))
-            send = false;
-
-        if(ring->sender == clno && !sv_voip_echo.value) send = false;
-
-        if(send)
-        {
-            if(buf->maxsize - buf->cursize < (int)ring->datalen + 5) break;
-            MSG_WriteByte(buf, svcfte_voicechat);
-            MSG_WriteByte(buf, ring->sender);
-            MSG_WriteByte(buf, ring->gen);
-            MSG_WriteByte(buf, ring->seq);
-            MSG_WriteShort(buf, ring->datalen);
-            SZ_Write(buf, ring->data, ring->datalen);
-        }
-        client->voip.read++;
-    }
-}
-
-static void SV_Voice_Ignore_f()
-{
-    if(cmd_source != src_client)
-    {
-        if(cls.state == ca_connected) Cmd_ForwardToServer();
-    }
-    else
-    {
-        unsigned int other;
-        int type = 0;
-
-        if(Cmd_Argc() < 2)
-        {
-            /*only a name = toggle*/
-            type = 0;
-        }
-        else
-        {
-            /*mute if 1, unmute if 0*/
-            if(atoi(Cmd_Argv(2)))
-                type = 1;
-            else
-                type = -1;
-        }
-        other = atoi(Cmd_Argv(1));
-        if(other >= MAX_SCOREBOARD) return;
-
-        switch(type)
-        {
-            case -1:
-                host_client->voip.mute[other >> 3] &= ~(1 << (other & 3));
-                break;
-            case 0:
-                host_client->voip.mute[other >> 3] ^= (1 << (other & 3));
-                break;
-            case 1: host_client->voip.mute[other >> 3] |= (1 << (other & 3));
-        }
-    }
-}
-static void SV_Voice_Target_f()
-{
-    if(cmd_source != src_client)
-    {
-        if(cls.state == ca_connected) Cmd_ForwardToServer();
-    }
-    else
-    {
-        unsigned int other;
-        const char* t = Cmd_Argv(1);
-        if(!strcmp(t, "team"))
-        {
-            host_client->voip.target = client_voip_t::VT_TEAM;
-        }
-        else if(!strcmp(t, "all"))
-        {
-            host_client->voip.target = client_voip_t::VT_ALL;
-        }
-        else if(!strcmp(t, "nonmuted"))
-        {
-            host_client->voip.target = client_voip_t::VT_NONMUTED;
-        }
-        else if(*t >= '0' && *t <= '9')
-        {
-            other = atoi(t);
-            if(other >= MAX_SCOREBOARD) return;
-            host_client->voip.target = client_voip_t::VoipTarget(
-                client_voip_t::VT_PLAYERSLOT0 + other);
-        }
-        else
-        {
-            /*don't know who you mean, futureproofing*/
-            host_client->voip.target = client_voip_t::VT_TEAM;
-        }
-    }
-}
-static void SV_Voice_MuteAll_f()
-{
-    if(cmd_source != src_client)
-    {
-        Cvar_Set("cl_voip_play", "0");
-        if(cls.state == ca_connected) Cmd_ForwardToServer();
-    }
-    else
-    {
-        host_client->voip.active = false;
-    }
-}
-static void SV_Voice_UnmuteAll_f()
-{
-    if(cmd_source != src_client)
-    {
-        Cvar_Set("cl_voip_play", "1");
-        if(cls.state == ca_connected) Cmd_ForwardToServer();
-    }
-    else
-    {
-        host_client->voip.active = true;
-    }
-}
-
-void SV_VoiceInit()
-{
-    Cvar_RegisterVariable(&sv_voip);
-    Cvar_RegisterVariable(&sv_voip_echo);
-
-    Cmd_AddCommand_ClientCommand("muteall", SV_Voice_MuteAll_f);
-    Cmd_AddCommand_ClientCommand("unmuteall", SV_Voice_UnmuteAll_f);
-    Cmd_AddCommand_ClientCommand("vignore", SV_Voice_Ignore_f);
-    Cmd_AddCommand_ClientCommand("voicetarg", SV_Voice_Target_f);
-}
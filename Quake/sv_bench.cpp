@@ -0,0 +1,428 @@
+/*
+Copyright (C) 1996-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+// sv_bench.cpp -- bot-driven server load benchmark. Runs the server frames
+// directly, back to back, with a fixed frame time and random seed so that two
+// runs on the same map and progs do the same work.
+
+#include "sv_bench.hpp"
+#include "quakedef.hpp"
+#include "host.hpp"
+#include "server.hpp"
+#include "progs.hpp"
+#include "qcvm.hpp"
+#include "cmd.hpp"
+#include "common.hpp"
+#include "console.hpp"
+#include "client.hpp"
+#include "json.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace quake::svbench
+{
+
+bool enabled{false};
+PhaseStats stats[static_cast<int>(Phase::Count)];
+
+} // namespace quake::svbench
+
+namespace
+{
+
+struct BenchParams
+{
+    std::string map;
+    int bots{8};
+    int frames{1000};
+    unsigned int seed{1};
+    std::string outfile;
+    int observers{1};
+};
+
+// File scope rather than in SV_Bench_Run, which Host_Error can longjmp out
+// of; see SV_Bench_Abort.
+std::vector<double> frameMs;
+double oldFrametime;
+
+using quake::bench::toMs;
+
+[[nodiscard]] const char* phaseName(const quake::svbench::Phase phase) noexcept
+{
+    using quake::svbench::Phase;
+
+    switch(phase)
+    {
+        case Phase::QC: return "qc";
+        case Phase::Physics: return "physics";
+        case Phase::Move: return "move";
+        case Phase::Send: return "send";
+        default: return "unknown";
+    }
+}
+
+// Connects bots through FrikBot's `BotConnect`, as its `impulse 100` does.
+// Returns how many connected, or 0 if the progs have no bots.
+[[nodiscard]] int SV_Bench_SpawnBots(const int count)
+{
+    QCVMGuard qg{&sv.qcvm};
+
+    dfunction_t* const botConnect = ED_FindFunction("BotConnect");
+    const ddef_t* const botCount = ED_FindGlobal("bot_count");
+    if(!botConnect || !botCount)
+    {
+        Con_Printf(
+            "sv_bench: progs have no BotConnect, running without bots\n");
+        return 0;
+    }
+
+    const float before = qcvm->globals[botCount->ofs];
+    for(int i = 0; i < count; i++)
+    {
+        pr_global_struct->self = EDICT_TO_PROG(qcvm->edicts);
+        G_FLOAT(OFS_PARM0) = 0;           // same team as self
+        G_FLOAT(OFS_PARM1) = 0;           // random name
+        G_FLOAT(OFS_PARM2) = skill.value; // skill
+        PR_ExecuteProgram(botConnect - qcvm->functions);
+    }
+
+    return static_cast<int>(qcvm->globals[botCount->ofs] - before);
+}
+
+// FrikBot's bots live in client edicts without engine clients, so nothing
+// would be sent for them. Observers are engine clients without a connection
+// that join like players do and then stand still; the server builds their
+// datagrams while the benchmark runs, see SV_ClientGetsDatagrams. Returns how
+// many connected.
+[[nodiscard]] int SV_Bench_ConnectObservers(const int count)
+{
+    QCVMGuard qg{&sv.qcvm};
+
+    int connected = 0;
+    for(int i = 0; i < svs.maxclients && connected < count; i++)
+    {
+        client_t* const client = &svs.clients[i];
+        if(client->active)
+        {
+            continue;
+        }
+
+        client->netconnection = nullptr;
+        SV_ConnectClient(i);
+        q_snprintf(client->name, sizeof(client->name), "observer%d", i);
+
+        // what SV_SendServerinfo settles on for a client without protocol
+        // extensions, which it can't ask about without a connection. the
+        // delta protocol isn't an option: it needs the connection's sequence
+        // numbers and acks.
+        SZ_Clear(&client->message);
+        client->sendsignon = false;
+        client->pextknown = true;
+        client->protocol_pext2 = 0;
+        if(sv.protocol == PROTOCOL_NETQUAKE)
+        {
+            client->limit_unreliable = 1024;
+            client->limit_reliable = 8192;
+            client->limit_entities = 600;
+            client->limit_models = 256;
+            client->limit_sounds = 256;
+        }
+        else
+        {
+            client->limit_unreliable = DATAGRAM_MTU;
+            client->limit_reliable = MAX_DATAGRAM;
+            client->limit_entities = q_min(qcvm->max_edicts, 0x8000);
+            client->limit_models = MAX_MODELS;
+            client->limit_sounds = MAX_SOUNDS;
+        }
+
+        // as Host_Spawn_f
+        edict_t* const ent = client->edict;
+        memset(&ent->v, 0, qcvm->progs->entityfields * 4);
+        PR_FieldIndexTouch(ent);
+        ent->v.colormap = NUM_FOR_EDICT(ent);
+        ent->v.team = (client->colors & 15) + 1;
+        ent->v.netname = PR_SetEngineString(client->name);
+
+        int j = 0;
+        for(; j < NUM_BASIC_SPAWN_PARMS; j++)
+        {
+            (&pr_global_struct->parm1)[j] = client->spawn_parms[j];
+        }
+        for(; j < NUM_TOTAL_SPAWN_PARMS; j++)
+        {
+            if(const ddef_t* const g = ED_FindGlobal(va("parm%i", j + 1)))
+            {
+                qcvm->globals[g->ofs] = client->spawn_parms[j];
+            }
+        }
+
+        pr_global_struct->time = qcvm->time;
+        pr_global_struct->self = EDICT_TO_PROG(ent);
+        PR_ExecuteProgram(pr_global_struct->ClientConnect);
+        PR_ExecuteProgram(pr_global_struct->PutClientInServer);
+
+        client->knowntoqc = true;
+        client->spawned = true;
+        ++connected;
+    }
+
+    return connected;
+}
+
+void SV_Bench_Run(const BenchParams& params)
+{
+    using namespace quake::svbench;
+
+    if(cls.state != ca_dedicated)
+    {
+        Con_Printf("sv_bench: only available on a dedicated server\n");
+        return;
+    }
+
+    // The bots and observers take client slots, and there has to be more
+    // than one for the progs to run as a deathmatch.
+    Host_ShutdownServer(false);
+    const int maxplayers = q_max(params.bots + params.observers, 2);
+    if(maxplayers > svs.maxclientslimit)
+    {
+        Con_Printf(
+            "sv_bench: at most %d bots and observers, start with "
+            "-dedicated %d\n",
+            svs.maxclientslimit, maxplayers);
+        return;
+    }
+    Cmd_ExecuteString(va("maxplayers %d", maxplayers), src_command);
+
+    srand(params.seed);
+    Cmd_ExecuteString(va("map %s", params.map.c_str()), src_command);
+    if(!sv.active)
+    {
+        Con_Printf("sv_bench: couldn't spawn %s\n", params.map.c_str());
+        return;
+    }
+
+    // Observers first: FrikBot fills the slots from the top.
+    const int observers = SV_Bench_ConnectObservers(params.observers);
+    const int bots = SV_Bench_SpawnBots(params.bots);
+
+    // Everything from here on runs on the fixed dedicated tick.
+    const double frametime = sys_ticrate.value;
+    oldFrametime = host_frametime;
+    host_frametime = frametime;
+
+    for(PhaseStats& s : stats)
+    {
+        s = {};
+    }
+    enabled = true;
+
+    frameMs.clear();
+    frameMs.reserve(params.frames);
+
+    const auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < params.frames && sv.active; i++)
+    {
+        const auto frameStart = std::chrono::steady_clock::now();
+        {
+            QCVMGuard qg{&sv.qcvm};
+            Host_ServerFrame();
+        }
+        frameMs.push_back(
+            toMs(std::chrono::steady_clock::now() - frameStart));
+    }
+    const auto total = std::chrono::steady_clock::now() - start;
+
+    enabled = false;
+    host_frametime = oldFrametime;
+
+    int edicts = 0;
+    {
+        QCVMGuard qg{&sv.qcvm};
+        for(int i = 0; i < qcvm->num_edicts; i++)
+        {
+            if(!EDICT_NUM(i)->free)
+            {
+                ++edicts;
+            }
+        }
+    }
+
+    nlohmann::json result;
+    result["map"] = params.map;
+    result["bots"] = bots;
+    result["observers"] = observers;
+    result["seed"] = params.seed;
+    result["frametime"] = frametime;
+    result["frames"] = frameMs.size();
+    result["edicts"] = edicts;
+    result["total_ms"] = toMs(total);
+
+    if(!frameMs.empty())
+    {
+        std::vector<double> sorted = frameMs;
+        std::sort(sorted.begin(), sorted.end());
+
+        const auto percentile = [&](const double p) {
+            return sorted[static_cast<std::size_t>(p * (sorted.size() - 1))];
+        };
+
+        result["frame_ms"] = {
+            {"mean", toMs(total) / frameMs.size()},
+            {"p50", percentile(0.5)},
+            {"p95", percentile(0.95)},
+            {"p99", percentile(0.99)},
+            {"max", sorted.back()},
+        };
+    }
+
+    for(int i = 0; i < static_cast<int>(Phase::Count); i++)
+    {
+        const PhaseStats& s = stats[i];
+        result["phases"][phaseName(static_cast<Phase>(i))] = {
+            {"total_ms", toMs(s.time)},
+            {"calls", s.calls},
+            {"per_frame_ms",
+                frameMs.empty() ? 0.0 : toMs(s.time) / frameMs.size()},
+        };
+    }
+
+    const std::string text = result.dump(4);
+    Con_Printf("%s\n", text.c_str());
+
+    if(!params.outfile.empty())
+    {
+        char name[MAX_OSPATH];
+        q_snprintf(
+            name, sizeof(name), "%s/%s", com_gamedir, params.outfile.c_str());
+
+        FILE* f = fopen(name, "w");
+        if(!f)
+        {
+            Con_Printf("sv_bench: couldn't write %s\n", name);
+            return;
+        }
+
+        fprintf(f, "%s\n", text.c_str());
+        fclose(f);
+        Con_Printf("sv_bench: wrote %s\n", name);
+    }
+}
+
+} // namespace
+
+/*
+==================
+SV_Bench_f
+
+sv_bench <map> [bots] [frames] [seed] [outfile] [observers]
+==================
+*/
+static void SV_Bench_f()
+{
+    if(Cmd_Argc() < 2)
+    {
+        Con_Printf(
+            "sv_bench <map> [bots] [frames] [seed] [outfile] [observers]: "
+            "run a server benchmark and print the timings as JSON\n");
+        return;
+    }
+
+    if(cmd_source != src_command)
+    {
+        return;
+    }
+
+    BenchParams params;
+    params.map = Cmd_Argv(1);
+    if(Cmd_Argc() > 2)
+    {
+        params.bots = q_max(Q_atoi(Cmd_Argv(2)), 0);
+    }
+    if(Cmd_Argc() > 3)
+    {
+        params.frames = q_max(Q_atoi(Cmd_Argv(3)), 1);
+    }
+    if(Cmd_Argc() > 4)
+    {
+        params.seed = strtoul(Cmd_Argv(4), nullptr, 10);
+    }
+    if(Cmd_Argc() > 5)
+    {
+        params.outfile = Cmd_Argv(5);
+    }
+    if(Cmd_Argc() > 6)
+    {
+        params.observers = q_max(Q_atoi(Cmd_Argv(6)), 0);
+    }
+
+    SV_Bench_Run(params);
+}
+
+void SV_Bench_Init()
+{
+    Cmd_AddCommand("sv_bench", SV_Bench_f);
+}
+
+void SV_Bench_Abort()
+{
+    using namespace quake::svbench;
+
+    if(!enabled)
+    {
+        return;
+    }
+
+    enabled = false;
+    quake::bench::closePhases(stats, static_cast<int>(Phase::Count));
+    host_frametime = oldFrametime;
+
+    Con_Printf("sv_bench: aborted\n");
+}
+
+bool SV_Bench_QueueFromCommandLine()
+{
+    const int i = COM_CheckParm("-svbench");
+    if(!i)
+    {
+        return false;
+    }
+
+    // the arguments of `sv_bench` follow the flag, up to the next option
+    std::string cmd = "sv_bench";
+    for(int j = i + 1; j < com_argc; j++)
+    {
+        if(com_argv[j][0] == '-' || com_argv[j][0] == '+')
+        {
+            break;
+        }
+
+        cmd += ' ';
+        cmd += com_argv[j];
+    }
+
+    Cbuf_AddText(va("%s\nquit\n", cmd.c_str()));
+    return true;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "bench.hpp"
+
+// Server load benchmark: `sv_bench` spawns a map with bots, runs a fixed
+// number of server frames and reports where the time went as JSON. The phase
+// timers below are compiled into the regular server code and cost a single
+// branch unless a benchmark is running.
+
+namespace quake::svbench
+{
+
+enum class Phase : int
+{
+    QC = 0,  // outermost PR_ExecuteProgram calls
+    Physics, // SV_Physics, includes most of the QC and traces
+    Move,    // SV_Move traces, from the engine and from QC builtins
+    Send,    // SV_SendClientMessages, including snapshot building
+    Count
+};
+
+using PhaseStats = quake::bench::PhaseStats;
+
+extern bool enabled;
+extern PhaseStats stats[static_cast<int>(Phase::Count)];
+
+[[nodiscard]] inline quake::bench::Timer startTimer(const Phase phase) noexcept
+{
+    return quake::bench::startTimer(
+        enabled ? &stats[static_cast<int>(phase)] : nullptr);
+}
+
+using quake::bench::stopTimer;
+
+} // namespace quake::svbench
+
+void SV_Bench_Init();
+
+// Called by Host_Error and Host_EndGame before they longjmp out of a running
+// benchmark: turns the timers off again and restores the frame time.
+void SV_Bench_Abort();
+
+// Queues `sv_bench` followed by `quit` when started with `-svbench`.
+// Returns false if the flag is absent.
+[[nodiscard]] bool SV_Bench_QueueFromCommandLine();
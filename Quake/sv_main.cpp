@@ -40,8 +40,15 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "snd_voip.hpp"
 #include "qcvm.hpp"
 #include "client.hpp"
+#include "jobs.hpp"
+#include "sv_bench.hpp"
 
 #include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 server_t sv;
 server_static_t svs;
@@ -745,9 +752,31 @@ static void MSGFTE_WriteEntityUpdate(unsigned int bits, entity_state_t* state,
     */
 }
 
-static client_t::entity_num_state_s* snapshot_entstate;
-static size_t snapshot_numents;
-static size_t snapshot_maxents;
+// Spare snapshot buffer, swapped with the client's previous snapshot by
+// SVFTE_CalcEntityDeltas. One per thread so that clients can be built in
+// parallel by SV_PrepareClientSnapshots.
+static thread_local client_t::entity_num_state_s* snapshot_entstate;
+static thread_local size_t snapshot_numents;
+static thread_local size_t snapshot_maxents;
+
+// 1 only sends attenuated sounds to clients in the PHS of the sound, when the
+// map has one (see mod_vismatrix). Off by default: it changes which distant
+// sounds clients hear.
+cvar_t sv_phssounds = {"sv_phssounds", "0", CVAR_NONE};
+
+// 1 builds the per-client entity snapshots on the job threads
+cvar_t sv_threadedsnapshots = {"sv_threadedsnapshots", "1", CVAR_NONE};
+
+// Per-client work done ahead of time by SV_PrepareClientSnapshots, indexed
+// like svs.clients. The flags are cleared once the result has been used.
+struct sv_clientsnapshot_t
+{
+    std::vector<unsigned int> visibleents; // non-FTE protocols
+    bool visibleready{false};
+    bool deltasready{false}; // SVFTE_CalcEntityDeltas has already run
+};
+
+static std::vector<sv_clientsnapshot_t> sv_clientsnapshots;
 
 void SVFTE_DestroyFrames(client_t* client)
 {
@@ -1620,6 +1649,10 @@ void SV_Init()
     extern cvar_t com_protocolname;    // spike
     extern cvar_t net_masters[];       // spike
     extern cvar_t rcon_password;       // spike, proquake-compatible rcon
+    extern cvar_t sv_findradius_compat;
+    extern cvar_t sv_fatpvs_cache;
+    extern cvar_t sv_phssounds;
+    extern cvar_t sv_areadepth;
     extern cvar_t
         sv_sound_watersplash;    // spike - making these changable is handy...
     extern cvar_t sv_sound_land; // spike - and also mutable...
@@ -1641,6 +1674,11 @@ void SV_Init()
     Cvar_RegisterVariable(&sv_freezenonclients);
     Cvar_RegisterVariable(&sv_gameplayfix_spawnbeforethinks);
     Cvar_RegisterVariable(&sv_gameplayfix_setmodelrealbox);
+    Cvar_RegisterVariable(&sv_findradius_compat);
+    Cvar_RegisterVariable(&sv_threadedsnapshots);
+    Cvar_RegisterVariable(&sv_fatpvs_cache);
+    Cvar_RegisterVariable(&sv_phssounds);
+    Cvar_RegisterVariable(&sv_areadepth);
     Cvar_RegisterVariable(&pr_checkextension);
     Cvar_RegisterVariable(&sv_altnoclip); // johnfitz
 
@@ -1667,6 +1705,7 @@ void SV_Init()
 
     Cmd_AddCommand_ClientCommand("pext", SV_Pext_f);
     Cmd_AddCommand("sv_protocol", &SV_Protocol_f); // johnfitz
+    Cmd_AddCommand("sv_areastats", SV_AreaStats_f);
 
     for(i = 0; i < MAX_MODELS; i++)
     {
@@ -1689,6 +1728,7 @@ void SV_Init()
     Sys_Printf("Server using protocol %i (%s)\n", sv_protocol, p);
 
     SV_VoiceInit();
+    SV_Bench_Init();
 }
 
 /*
@@ -1850,6 +1890,18 @@ void SV_StartSound(edict_t* entity, const qvec3* origin, int channel,
     }
     // johnfitz
 
+    // with a precomputed PHS, skip the clients that can't possibly hear it
+    const byte* phs = nullptr;
+    if(sv_phssounds.value && attenuation > 0)
+    {
+        const qvec3 sndorg =
+            origin ? *origin
+                   : entity->v.origin + 0.5f * (entity->v.mins + entity->v.maxs);
+
+        phs = Mod_LeafPHS(
+            Mod_PointInLeaf(sndorg, qcvm->worldmodel), qcvm->worldmodel);
+    }
+
     for(p = 0; p < svs.maxclients; p++)
     {
         cl = &svs.clients[p];
@@ -1868,6 +1920,20 @@ void SV_StartSound(edict_t* entity, const qvec3* origin, int channel,
             continue;
         }
 
+        if(phs)
+        {
+            const edict_t* clent = cl->edict;
+            const int leafnum =
+                Mod_PointInLeaf(
+                    clent->v.origin + clent->v.view_ofs, qcvm->worldmodel) -
+                qcvm->worldmodel->leafs - 1;
+
+            if(leafnum >= 0 && !(phs[leafnum >> 3] & (1 << (leafnum & 7))))
+            {
+                continue;
+            }
+        }
+
         /*
         if((field_mask & (SND_LARGEENTITY | SND_LARGESOUND)) &&
             (!cl->protocol_pext2 || sv.protocol == PROTOCOL_NETQUAKE))
@@ -2447,31 +2513,38 @@ crosses a waterline.
 =============================================================================
 */
 
-static int fatbytes;
-static byte* fatpvs;
-static int fatpvs_capacity;
+// 0 disables the fat PVS cache, otherwise the maximum number of cached rows
+cvar_t sv_fatpvs_cache = {"sv_fatpvs_cache", "2048", CVAR_NONE};
+
+static thread_local int fatbytes;
+static thread_local std::vector<std::uint64_t> fatpvs;
+static thread_local std::vector<int> fatleafs;
+
+// Fat PVS rows keyed by the set of leafs they were built from. Only grows
+// while the world model stays the same, so returned rows remain valid; it is
+// shared by the renderer and the job threads building client snapshots.
+static struct
+{
+    std::mutex mutex;
+    qmodel_t* worldmodel{nullptr};
+    mleaf_t* leafs{nullptr};
+    std::unordered_map<std::string, std::vector<std::uint64_t>> rows;
+} fatpvscache;
 
-void SV_AddToFatPVS(const qvec3& org, mnode_t* node,
+static void SV_FindFatPVSLeafs(const qvec3& org, mnode_t* node,
     qmodel_t* worldmodel) // johnfitz -- added worldmodel as a parameter
 {
-    int i;
-    byte* pvs;
     mplane_t* plane;
     float d;
 
     while(true)
     {
-        // if this is a leaf, accumulate the pvs bits
+        // if this is a leaf, remember it
         if(node->contents < 0)
         {
             if(node->contents != CONTENTS_SOLID)
             {
-                pvs = Mod_LeafPVS((mleaf_t*)node,
-                    worldmodel); // johnfitz -- worldmodel as a parameter
-                for(i = 0; i < fatbytes; i++)
-                {
-                    fatpvs[i] |= pvs[i];
-                }
+                fatleafs.push_back((mleaf_t*)node - worldmodel->leafs);
             }
             return;
         }
@@ -2489,13 +2562,31 @@ void SV_AddToFatPVS(const qvec3& org, mnode_t* node,
         else
         {
             // go down both
-            SV_AddToFatPVS(org, node->children[0],
+            SV_FindFatPVSLeafs(org, node->children[0],
                 worldmodel); // johnfitz -- worldmodel as a parameter
             node = node->children[1];
         }
     }
 }
 
+static void SV_OrPVSRow(std::uint64_t* out, const byte* pvs)
+{
+    const int words = fatbytes / 8;
+
+    for(int i = 0; i < words; i++)
+    {
+        std::uint64_t w;
+        memcpy(&w, pvs + i * 8, sizeof(w));
+        out[i] |= w;
+    }
+
+    byte* outbytes = (byte*)out;
+    for(int i = words * 8; i < fatbytes; i++)
+    {
+        outbytes[i] |= pvs[i];
+    }
+}
+
 /*
 =============
 SV_FatPVS
@@ -2509,21 +2600,56 @@ byte* SV_FatPVS(const qvec3& org,
 {
     fatbytes = (worldmodel->numleafs + 7) >>
                3; // ericw -- was +31, assumed to be a bug/typo
-    if(fatpvs == nullptr || fatbytes > fatpvs_capacity)
+    const std::size_t fatwords = (fatbytes + 7) / 8;
+
+    fatleafs.clear();
+    SV_FindFatPVSLeafs(org, worldmodel->nodes,
+        worldmodel); // johnfitz -- worldmodel as a parameter
+
+    // usually a single leaf, unless the point is close to a plane
+    std::sort(fatleafs.begin(), fatleafs.end());
+    const std::string key(
+        (const char*)fatleafs.data(), fatleafs.size() * sizeof(int));
+
+    const bool usecache = sv_fatpvs_cache.value > 0;
+    if(usecache)
+    {
+        std::lock_guard lock{fatpvscache.mutex};
+
+        if(fatpvscache.worldmodel != worldmodel ||
+            fatpvscache.leafs != worldmodel->leafs)
+        {
+            fatpvscache.rows.clear();
+            fatpvscache.worldmodel = worldmodel;
+            fatpvscache.leafs = worldmodel->leafs;
+        }
+
+        const auto it = fatpvscache.rows.find(key);
+        if(it != fatpvscache.rows.end())
+        {
+            return (byte*)it->second.data();
+        }
+    }
+
+    fatpvs.assign(fatwords, 0);
+    for(const int leafnum : fatleafs)
+    {
+        SV_OrPVSRow(fatpvs.data(),
+            Mod_LeafPVS(&worldmodel->leafs[leafnum], worldmodel));
+    }
+
+    if(usecache)
     {
-        fatpvs_capacity = fatbytes;
-        fatpvs = (byte*)realloc(fatpvs, fatpvs_capacity);
-        if(!fatpvs)
+        std::lock_guard lock{fatpvscache.mutex};
+
+        if(fatpvscache.rows.size() < (std::size_t)sv_fatpvs_cache.value)
         {
-            Sys_Error(
-                "SV_FatPVS: realloc() failed on %d bytes", fatpvs_capacity);
+            const auto it = fatpvscache.rows.try_emplace(key, fatpvs).first;
+            return (byte*)it->second.data();
         }
     }
 
-    Q_memset(fatpvs, 0, fatbytes);
-    SV_AddToFatPVS(org, worldmodel->nodes,
-        worldmodel); // johnfitz -- worldmodel as a parameter
-    return fatpvs;
+    return (byte*)fatpvs.data();
 }
 
 /*
@@ -2557,20 +2683,20 @@ bool SV_VisibleToClient(edict_t* client, edict_t* test, qmodel_t* worldmodel)
 
 /*
 =============
-SV_WriteEntitiesToClient
+SV_CollectVisibleEntities
 
+Fills `out` with the numbers of the entities that touch the client's PVS.
+Only reads the edicts, so it can run for several clients at once.
 =============
 */
-void SV_WriteEntitiesToClient(client_t* client, sizebuf_t* msg)
+static void SV_CollectVisibleEntities(
+    client_t* client, std::vector<unsigned int>& out)
 {
+    out.clear();
+
     const unsigned int maxedict = std::min(
         static_cast<unsigned int>(qcvm->num_edicts), client->limit_entities);
 
-    // try to avoid sounds getting lost. flickering entities are weird, but
-    // missing sounds+particles are just eerie.
-    const int maxsize =
-        msg->maxsize - client->datagram.cursize - sv.datagram.cursize;
-
     // find the client's PVS
     const edict_t* clent = client->edict;
     const qvec3 org = clent->v.origin + clent->v.view_ofs;
@@ -2621,6 +2747,35 @@ void SV_WriteEntitiesToClient(client_t* client, sizebuf_t* msg)
             }
         }
 
+        out.push_back(e);
+    }
+}
+
+/*
+=============
+SV_WriteEntitiesToClient
+
+=============
+*/
+void SV_WriteEntitiesToClient(client_t* client, sizebuf_t* msg)
+{
+    // try to avoid sounds getting lost. flickering entities are weird, but
+    // missing sounds+particles are just eerie.
+    const int maxsize =
+        msg->maxsize - client->datagram.cursize - sv.datagram.cursize;
+
+    sv_clientsnapshot_t& snapshot = sv_clientsnapshots[client - svs.clients];
+    if(!snapshot.visibleready)
+    {
+        SV_CollectVisibleEntities(client, snapshot.visibleents);
+    }
+
+    snapshot.visibleready = false;
+
+    for(const unsigned int e : snapshot.visibleents)
+    {
+        edict_t* ent = EDICT_NUM(e);
+
         // johnfitz -- max size for protocol 15 is 18 bytes, not 16 as
         // originally assumed here.  And, for protocol 85 the max size is
         // actually 24 bytes.
@@ -3383,6 +3538,20 @@ void SV_WriteClientdataToMessage(client_t* client, sizebuf_t* msg)
 #endif
 }
 
+/*
+=======================
+SV_ClientGetsDatagrams
+
+bots have no connection to send anything to, but while `sv_bench` runs their
+datagrams are built all the same and then thrown away, so that its send phase
+covers the work that remote players cause
+=======================
+*/
+static bool SV_ClientGetsDatagrams(const client_t* client)
+{
+    return client->netconnection || quake::svbench::enabled;
+}
+
 /*
 =======================
 SV_SendClientDatagram
@@ -3394,7 +3563,7 @@ bool SV_SendClientDatagram(client_t* client)
     sizebuf_t msg;
 
     // QSS
-    if(!client->netconnection)
+    if(!SV_ClientGetsDatagrams(client))
     {
         // botclient, shouldn't be sent anything.
         SZ_Clear(&client->datagram);
@@ -3429,11 +3598,15 @@ bool SV_SendClientDatagram(client_t* client)
                 SVFTE_WriteStats(client, &msg);
             }
 
-            if(!client->snapshotresume)
+            sv_clientsnapshot_t& snapshot =
+                sv_clientsnapshots[client - svs.clients];
+            if(!client->snapshotresume && !snapshot.deltasready)
             {
                 SVFTE_BuildSnapshotForClient(client);
                 SVFTE_CalcEntityDeltas(client);
             }
+
+            snapshot.deltasready = false;
             SVFTE_WriteEntitiesToClient(
                 client, &msg, sizeof(buf)); // must always write some data, or
                                             // the stats will break
@@ -3487,6 +3660,13 @@ bool SV_SendClientDatagram(client_t* client)
     msg.maxsize = client->limit_unreliable;
     Host_AppendDownloadData(client, &msg);
 
+    if(!client->netconnection)
+    {
+        // built for `sv_bench`, see SV_ClientGetsDatagrams; the reliable
+        // messages have nowhere to go either
+        SZ_Clear(&client->message);
+        return true;
+    }
 
     // send the datagram
     if(msg.cursize &&
@@ -3706,6 +3886,104 @@ int SV_SendPrespawnBaselines(int idx)
     return idx;
 }
 
+/*
+=======================
+SV_CheckSnapshotEdicts
+
+Does the lookups of the snapshot building that can Host_Error, so that a bad
+model string or tag_entity errors out here instead of longjmp'ing out of a
+job thread.
+=======================
+*/
+static void SV_CheckSnapshotEdicts()
+{
+    edict_t* ent = NEXT_EDICT(qcvm->edicts);
+    for(int e = 1; e < qcvm->num_edicts; e++, ent = NEXT_EDICT(ent))
+    {
+        if(ent->v.modelindex)
+        {
+            PR_GetString(ent->v.model);
+        }
+
+        const eval_t* val =
+            GetEdictFieldValue(ent, qcvm->extfields.tag_entity);
+        if(val && val->edict)
+        {
+            NUM_FOR_EDICT(PROG_TO_EDICT(val->edict));
+        }
+    }
+}
+
+/*
+=======================
+SV_InvalidateClientSnapshots
+
+Called when QC runs in the middle of SV_SendClientMessages (a client being
+dropped): it may have freed or moved edicts, so the clients that are still
+to be sent redo their snapshot instead of using the prepared one.
+=======================
+*/
+void SV_InvalidateClientSnapshots()
+{
+    for(sv_clientsnapshot_t& snapshot : sv_clientsnapshots)
+    {
+        snapshot.visibleready = false;
+        snapshot.deltasready = false;
+    }
+}
+
+/*
+=======================
+SV_PrepareClientSnapshots
+
+Runs the read-only part of every client's entity update (PVS culling, and
+snapshot building plus delta calculation for FTE clients) in parallel.
+SV_SendClientDatagram then writes the messages one client at a time, in the
+same order as before, so the output does not depend on the thread count.
+=======================
+*/
+static void SV_PrepareClientSnapshots()
+{
+    sv_clientsnapshots.resize(svs.maxclients);
+    SV_InvalidateClientSnapshots();
+
+    if(!sv_threadedsnapshots.value || quake::jobs::numThreads() == 1)
+    {
+        return;
+    }
+
+    SV_CheckSnapshotEdicts();
+
+    quake::jobs::parallelFor(
+        svs.maxclients, 1, [](const std::size_t begin, const std::size_t end) {
+            for(std::size_t i = begin; i < end; ++i)
+            {
+                client_t* client = &svs.clients[i];
+
+                // same conditions as SV_SendClientDatagram
+                if(!client->active || !SV_ClientGetsDatagrams(client) ||
+                    !client->spawned)
+                {
+                    continue;
+                }
+
+                sv_clientsnapshot_t& snapshot = sv_clientsnapshots[i];
+
+                if(!(client->protocol_pext2 & PEXT2_REPLACEMENTDELTAS))
+                {
+                    SV_CollectVisibleEntities(client, snapshot.visibleents);
+                    snapshot.visibleready = true;
+                }
+                else if(!client->snapshotresume)
+                {
+                    SVFTE_BuildSnapshotForClient(client);
+                    SVFTE_CalcEntityDeltas(client);
+                    snapshot.deltasready = true;
+                }
+            }
+        });
+}
+
 /*
 =======================
 SV_SendClientMessages
@@ -3715,9 +3993,18 @@ void SV_SendClientMessages()
 {
     int i;
 
+    const quake::bench::Timer benchTimer =
+        quake::svbench::startTimer(quake::svbench::Phase::Send);
+
     // update frags, names, etc
     SV_UpdateToReliableMessages();
 
+    SV_PrepareClientSnapshots();
+
+    // every client datagram of the frame goes out in as few syscalls as the
+    // lan driver allows
+    NET_BeginSendBatch();
+
     // build individual updates
     for(i = 0, host_client = svs.clients; i < svs.maxclients;
         i++, host_client++)
@@ -3840,9 +4127,12 @@ void SV_SendClientMessages()
         }
     }
 
+    NET_FlushSendBatch();
 
     // clear muzzle flashes
     SV_CleanupEnts();
+
+    quake::svbench::stopTimer(benchTimer);
 }
 
 
@@ -32,6 +32,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "quakeglm.hpp"
 #include "sys.hpp"
 #include "qcvm.hpp"
+#include "sv_bench.hpp"
 
 #include <algorithm>
 #include <tuple>
@@ -1638,6 +1639,11 @@ void SV_Physics()
     int entity_cap; // For sv_freezenonclients
     edict_t* ent;
 
+    const quake::bench::Timer benchTimer =
+        quake::svbench::startTimer(quake::svbench::Phase::Physics);
+
+    SV_AreaStatsFrame();
+
     // let the progs know that a new frame has started
     pr_global_struct->self = EDICT_TO_PROG(qcvm->edicts);
     pr_global_struct->other = EDICT_TO_PROG(qcvm->edicts);
@@ -1716,4 +1722,6 @@ void SV_Physics()
     {
         qcvm->time += host_frametime;
     }
+
+    quake::svbench::stopTimer(benchTimer);
 }
@@ -0,0 +1,285 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+// Server side of voice chat: relays the clients' voice packets to each
+// other. The capture and playback side lives in snd_voip.cpp.
+
+#include "snd_voip.hpp"
+#include "quakedef.hpp"
+#include "console.hpp"
+#include "common.hpp"
+#include "msg.hpp"
+#include "client.hpp"
+#include "server.hpp"
+#include "cmd.hpp"
+#include "cvar.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+/*****************************************************************************************************************************/
+/*server componant*/
+
+cvar_t sv_voip = {"sv_voip", "1"};
+cvar_t sv_voip_echo = {"sv_voip_echo", "0"};
+
+
+/*
+Pivicy issues:
+By sending voice chat to a server, you are unsure who might be listening.
+Server could be changed to record voice.
+Voice will be saved in any demos made of the game.
+You're never quite sure if anyone might join the server and your team before you
+finish saying a sentance. You run the risk of sounds around you being recorded
+by quake, including but not limited to: TV channels, loved ones, phones, YouTube
+videos featuring certain moans. Default on non-team games is to broadcast.
+*/
+
+#define VOICE_RING_SIZE 512 /*POT*/
+struct voice_t
+{
+    struct voice_ring_s
+    {
+        unsigned int sender;
+        unsigned char receiver[MAX_SCOREBOARD / 8];
+        unsigned char gen;
+        unsigned char seq;
+        unsigned int datalen;
+        unsigned char data[1024];
+    } ring[VOICE_RING_SIZE];
+    unsigned int write;
+} voice;
+void SV_VoiceReadPacket(client_t* client)
+{
+    unsigned int vt = client->voip.target;
+    unsigned int j;
+    voice_t::voice_ring_s* ring;
+    unsigned short bytes;
+    client_t* cl;
+    unsigned char gen = MSG_ReadByte();
+    unsigned char seq = MSG_ReadByte();
+    /*read the data from the client*/
+    bytes = MSG_ReadShort();
+    ring = &voice.ring[voice.write & (VOICE_RING_SIZE - 1)];
+    if(bytes > sizeof(ring->data) || !sv_voip.value)
+    {
+        while(bytes-- > 0) (void)MSG_ReadByte();
+        return;
+    }
+    else
+    {
+        voice.write++;
+        for(j = 0; j < bytes; j++) ring->data[j] = MSG_ReadByte();
+    }
+
+    ring->datalen = bytes;
+    ring->sender = client - svs.clients;
+    ring->gen = gen;
+    ring->seq = seq;
+
+    /*broadcast it its to their team, and its not teamplay*/
+    if(vt == client_voip_t::VT_TEAM && !teamplay.value)
+        vt = client_voip_t::VT_ALL;
+
+    /*figure out which team members are meant to receive it*/
+    for(j = 0; j < MAX_SCOREBOARD / 8; j++) ring->receiver[j] = 0;
+    for(j = 0, cl = svs.clients; j < (unsigned int)svs.maxclients; j++, cl++)
+    {
+        if(!cl->spawned || !cl->active) continue;
+
+        if(vt == client_voip_t::VT_TEAM)
+        {
+            if((cl->colors & 0xf) == (client->colors & 0xf))
+                continue; // on different teams
+        }
+        else if(vt == client_voip_t::VT_NONMUTED)
+        {
+            if(client->voip.mute[j >> 3] & (1 << (j & 3))) continue;
+        }
+        else if(vt >= client_voip_t::VT_PLAYERSLOT0)
+        {
+            if(j != vt - client_voip_t::VT_PLAYERSLOT0) continue;
+        }
+
+        ring->receiver[j >> 3] |= 1 << (j & 3);
+    }
+}
+void SV_VoiceInitClient(client_t* client)
+{
+    client->voip.target = client_voip_t::VT_TEAM;
+    client->voip.active = false;
+    client->voip.read = voice.write;
+    memset(client->voip.mute, 0, sizeof(client->voip.mute));
+}
+void SV_VoiceSendPacket(client_t* client, sizebuf_t* buf)
+{
+    unsigned int clno;
+    bool send;
+    voice_t::voice_ring_s* ring;
+
+    clno = client - svs.clients;
+
+    if(!client->voip.active)
+    {
+        client->voip.read = voice.write;
+        return;
+    }
+
+    while(client->voip.read < voice.write)
+    {
+        /*they might be too far behind*/
+        if(client->voip.read + VOICE_RING_SIZE < voice.write)
+            client->voip.read = voice.write - VOICE_RING_SIZE;
+
+        ring = &voice.ring[(client->voip.read) & (VOICE_RING_SIZE - 1)];
+
+        /*figure out if it was for us*/
+        send = false;
+        if(ring->receiver[clno >> 3] & (1 << (clno & 3))) send = true;
+
+        if(client->voip.mute[ring->sender >> 3] & (1 << (ring->sender & 3)))
+            send = false;
+
+        if(ring->sender == clno && !sv_voip_echo.value) send = false;
+
+        if(send)
+        {
+            if(buf->maxsize - buf->cursize < (int)ring->datalen + 5) break;
+            MSG_WriteByte(buf, svcfte_voicechat);
+            MSG_WriteByte(buf, ring->sender);
+            MSG_WriteByte(buf, ring->gen);
+            MSG_WriteByte(buf, ring->seq);
+            MSG_WriteShort(buf, ring->datalen);
+            SZ_Write(buf, ring->data, ring->datalen);
+        }
+        client->voip.read++;
+    }
+}
+
+static void SV_Voice_Ignore_f()
+{
+    if(cmd_source != src_client)
+    {
+        if(cls.state == ca_connected) Cmd_ForwardToServer();
+    }
+    else
+    {
+        unsigned int other;
+        int type = 0;
+
+        if(Cmd_Argc() < 2)
+        {
+            /*only a name = toggle*/
+            type = 0;
+        }
+        else
+        {
+            /*mute if 1, unmute if 0*/
+            if(atoi(Cmd_Argv(2)))
+                type = 1;
+            else
+                type = -1;
+        }
+        other = atoi(Cmd_Argv(1));
+        if(other >= MAX_SCOREBOARD) return;
+
+        switch(type)
+        {
+            case -1:
+                host_client->voip.mute[other >> 3] &= ~(1 << (other & 3));
+                break;
+            case 0:
+                host_client->voip.mute[other >> 3] ^= (1 << (other & 3));
+                break;
+            case 1: host_client->voip.mute[other >> 3] |= (1 << (other & 3));
+        }
+    }
+}
+static void SV_Voice_Target_f()
+{
+    if(cmd_source != src_client)
+    {
+        if(cls.state == ca_connected) Cmd_ForwardToServer();
+    }
+    else
+    {
+        unsigned int other;
+        const char* t = Cmd_Argv(1);
+        if(!strcmp(t, "team"))
+        {
+            host_client->voip.target = client_voip_t::VT_TEAM;
+        }
+        else if(!strcmp(t, "all"))
+        {
+            host_client->voip.target = client_voip_t::VT_ALL;
+        }
+        else if(!strcmp(t, "nonmuted"))
+        {
+            host_client->voip.target = client_voip_t::VT_NONMUTED;
+        }
+        else if(*t >= '0' && *t <= '9')
+        {
+            other = atoi(t);
+            if(other >= MAX_SCOREBOARD) return;
+            host_client->voip.target = client_voip_t::VoipTarget(
+                client_voip_t::VT_PLAYERSLOT0 + other);
+        }
+        else
+        {
+            /*don't know who you mean, futureproofing*/
+            host_client->voip.target = client_voip_t::VT_TEAM;
+        }
+    }
+}
+static void SV_Voice_MuteAll_f()
+{
+    if(cmd_source != src_client)
+    {
+        Cvar_Set("cl_voip_play", "0");
+        if(cls.state == ca_connected) Cmd_ForwardToServer();
+    }
+    else
+    {
+        host_client->voip.active = false;
+    }
+}
+static void SV_Voice_UnmuteAll_f()
+{
+    if(cmd_source != src_client)
+    {
+        Cvar_Set("cl_voip_play", "1");
+        if(cls.state == ca_connected) Cmd_ForwardToServer();
+    }
+    else
+    {
+        host_client->voip.active = true;
+    }
+}
+
+void SV_VoiceInit()
+{
+    Cvar_RegisterVariable(&sv_voip);
+    Cvar_RegisterVariable(&sv_voip_echo);
+
+    Cmd_AddCommand_ClientCommand("muteall", SV_Voice_MuteAll_f);
+    Cmd_AddCommand_ClientCommand("unmuteall", SV_Voice_UnmuteAll_f);
+    Cmd_AddCommand_ClientCommand("vignore", SV_Voice_Ignore_f);
+    Cmd_AddCommand_ClientCommand("voicetarg", SV_Voice_Target_f);
+}
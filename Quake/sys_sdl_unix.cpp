@@ -50,7 +50,9 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <pwd.h>
 #endif
 
+#ifndef SERVERONLY
 #include <SDL2/SDL.h>
+#endif
 
 // Boost temporarily disabled --f
 //#include <boost/stacktrace.hpp>
@@ -415,10 +417,12 @@ void Sys_Error(const char* error, ...)
     fputs(text, stderr);
     fputs("\n\n", stderr);
 
+#ifndef SERVERONLY
     if(!isDedicated)
     {
         PL_ErrorDialog(text);
     }
+#endif
 
     exit(1);
 }
@@ -441,8 +445,14 @@ void Sys_Quit()
 
 double Sys_DoubleTime()
 {
+#ifdef SERVERONLY
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+#else
     return SDL_GetPerformanceCounter() /
            (long double)SDL_GetPerformanceFrequency();
+#endif
 }
 
 const char* Sys_ConsoleInput()
@@ -495,13 +505,18 @@ const char* Sys_ConsoleInput()
 
 void Sys_Sleep(unsigned long msecs)
 {
-    /*	usleep (msecs * 1000);*/
+#ifdef SERVERONLY
+    usleep(msecs * 1000);
+#else
     SDL_Delay(msecs);
+#endif
 }
 
 void Sys_SendKeyEvents()
 {
+#ifndef SERVERONLY
     IN_Commands(); // ericw -- allow joysticks to add keys so they can be used
                    // to confirm SCR_ModalMessage
     IN_SendKeyEvents();
+#endif
 }
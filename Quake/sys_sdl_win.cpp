@@ -47,7 +47,9 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include <string>
 
+#ifndef SERVERONLY
 #include <SDL2/SDL.h>
+#endif
 
 #pragma comment(lib, "dbgeng.lib")
 // Boost temporarily disabled --f
@@ -419,16 +421,18 @@ void Sys_Error(const char* error, ...)
     fputs(text, stderr);
     fputs("\n\n", stderr);
 
+#ifndef SERVERONLY
     if(!isDedicated)
     {
         PL_ErrorDialog(text);
     }
     else
+#endif
     {
         WriteFile(houtput, errortxt2, strlen(errortxt2), &dummy, nullptr);
         WriteFile(houtput, text, strlen(text), &dummy, nullptr);
         WriteFile(houtput, "\r\n", 2, &dummy, nullptr);
-        SDL_Delay(3000); /* show the console 3 more seconds */
+        Sys_Sleep(3000); /* show the console 3 more seconds */
     }
 
     exit(1);
@@ -480,8 +484,16 @@ void Sys_Quit()
 
 double Sys_DoubleTime()
 {
+#ifdef SERVERONLY
+    LARGE_INTEGER counter;
+    LARGE_INTEGER frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return counter.QuadPart / (long double)frequency.QuadPart;
+#else
     return SDL_GetPerformanceCounter() /
            (long double)SDL_GetPerformanceFrequency();
+#endif
 }
 
 const char* Sys_ConsoleInput()
@@ -564,13 +576,18 @@ const char* Sys_ConsoleInput()
 
 void Sys_Sleep(unsigned long msecs)
 {
-    /*	Sleep (msecs);*/
+#ifdef SERVERONLY
+    Sleep(msecs);
+#else
     SDL_Delay(msecs);
+#endif
 }
 
 void Sys_SendKeyEvents()
 {
+#ifndef SERVERONLY
     IN_Commands(); // ericw -- allow joysticks to add keys so they can be used
                    // to confirm SCR_ModalMessage
     IN_SendKeyEvents();
+#endif
 }
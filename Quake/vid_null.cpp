@@ -0,0 +1,580 @@
+/*
+Copyright (C) 1996-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+// vid_null.cpp -- video, renderer, textures and 2D drawing for the dedicated
+// server. Models are still loaded for collision, but nothing is uploaded:
+// `isDedicated` keeps `gl_model.cpp` away from textures, and the alias VBO
+// code in `gl_mesh.cpp` is skipped because `gl_glsl_alias_able` is false.
+//
+// The headless timedemo runs the client on top of these as well. Everything
+// the client parser hands to the renderer is dropped here, after reading its
+// part of the message where there is one.
+
+#include "quakedef.hpp"
+#include "glquake.hpp"
+#include "gl_texmgr.hpp"
+#include "image.hpp"
+#include "draw.hpp"
+#include "screen.hpp"
+#include "sbar.hpp"
+#include "render.hpp"
+#include "vid.hpp"
+#include "view.hpp"
+#include "msg.hpp"
+#include "client.hpp"
+#include "shader.hpp"
+
+#include <GL/glew.h>
+
+/*
+==============================================================================
+
+VIDEO
+
+==============================================================================
+*/
+
+viddef_t vid;
+int glx, gly, glwidth, glheight;
+
+bool gl_glsl_alias_able = false;
+
+// Referenced by the VBO code in `gl_mesh.cpp`, never called.
+PFNGLBINDBUFFERARBPROC __glewBindBufferARB = nullptr;
+PFNGLBUFFERDATAARBPROC __glewBufferDataARB = nullptr;
+PFNGLDELETEBUFFERSARBPROC __glewDeleteBuffersARB = nullptr;
+PFNGLGENBUFFERSARBPROC __glewGenBuffersARB = nullptr;
+
+// Referenced by the particle drawing in `r_part.cpp`, never called.
+PFNGLBINDBUFFERPROC __glewBindBuffer = nullptr;
+PFNGLBINDVERTEXARRAYPROC __glewBindVertexArray = nullptr;
+PFNGLBUFFERDATAPROC __glewBufferData = nullptr;
+PFNGLBUFFERSUBDATAPROC __glewBufferSubData = nullptr;
+PFNGLDISABLEVERTEXATTRIBARRAYPROC __glewDisableVertexAttribArray = nullptr;
+PFNGLENABLEVERTEXATTRIBARRAYPROC __glewEnableVertexAttribArray = nullptr;
+PFNGLGENBUFFERSPROC __glewGenBuffers = nullptr;
+PFNGLGENVERTEXARRAYSPROC __glewGenVertexArrays = nullptr;
+PFNGLUNIFORM3FPROC __glewUniform3f = nullptr;
+PFNGLUNIFORM4FVPROC __glewUniform4fv = nullptr;
+PFNGLUNIFORMMATRIX4FVPROC __glewUniformMatrix4fv = nullptr;
+PFNGLUSEPROGRAMPROC __glewUseProgram = nullptr;
+PFNGLVERTEXATTRIBIPOINTERPROC __glewVertexAttribIPointer = nullptr;
+PFNGLVERTEXATTRIBPOINTERPROC __glewVertexAttribPointer = nullptr;
+
+// The CSQC drawing builtins and the particle drawing call these directly.
+// Neither runs without a renderer.
+void GLAPIENTRY glBegin(GLenum mode)
+{
+    (void)mode;
+}
+
+void GLAPIENTRY glEnd()
+{
+}
+
+void GLAPIENTRY glVertex2f(GLfloat x, GLfloat y)
+{
+    (void)x;
+    (void)y;
+}
+
+void GLAPIENTRY glTexCoord2f(GLfloat s, GLfloat t)
+{
+    (void)s;
+    (void)t;
+}
+
+void GLAPIENTRY glColor4f(GLfloat red, GLfloat green, GLfloat blue,
+    GLfloat alpha)
+{
+    (void)red;
+    (void)green;
+    (void)blue;
+    (void)alpha;
+}
+
+void GLAPIENTRY glColor4fv(const GLfloat* v)
+{
+    (void)v;
+}
+
+void GLAPIENTRY glColor3f(GLfloat red, GLfloat green, GLfloat blue)
+{
+    (void)red;
+    (void)green;
+    (void)blue;
+}
+
+void GLAPIENTRY glDepthMask(GLboolean flag)
+{
+    (void)flag;
+}
+
+void GLAPIENTRY glDrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+    (void)mode;
+    (void)first;
+    (void)count;
+}
+
+void GLAPIENTRY glGetFloatv(GLenum pname, GLfloat* params)
+{
+    (void)pname;
+    (void)params;
+}
+
+void GLAPIENTRY glTexEnvf(GLenum target, GLenum pname, GLfloat param)
+{
+    (void)target;
+    (void)pname;
+    (void)param;
+}
+
+void GLAPIENTRY glEnable(GLenum cap)
+{
+    (void)cap;
+}
+
+void GLAPIENTRY glDisable(GLenum cap)
+{
+    (void)cap;
+}
+
+void GLAPIENTRY glScissor(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    (void)x;
+    (void)y;
+    (void)width;
+    (void)height;
+}
+
+void VID_Init()
+{
+}
+
+void VID_Shutdown()
+{
+}
+
+void VID_Lock()
+{
+}
+
+void VID_SetWindowCaption(const char* newcaption)
+{
+    (void)newcaption;
+}
+
+/*
+==============================================================================
+
+RENDERER
+
+==============================================================================
+*/
+
+qvec3 vup;
+qvec3 vpn;
+qvec3 vright;
+qvec3 r_origin;
+refdef_t r_refdef;
+
+cvar_t r_novis = {"r_novis", "0", CVAR_ARCHIVE};
+cvar_t r_nolerp_list = {"r_nolerp_list", "", CVAR_NONE};
+cvar_t r_noshadow_list = {"r_noshadow_list", "", CVAR_NONE};
+cvar_t gl_subdivide_size = {"gl_subdivide_size", "128", CVAR_ARCHIVE};
+cvar_t r_lerpmodels = {"r_lerpmodels", "1", CVAR_NONE};
+cvar_t r_lerpmove = {"r_lerpmove", "1", CVAR_NONE};
+
+int gl_warpimagesize;
+
+#define NUMVERTEXNORMALS 162
+
+float r_avertexnormals[NUMVERTEXNORMALS][3] = {
+#include "anorms.hpp"
+};
+
+// Only the client runs this, and only the lerping cvars change what the
+// client does.
+void R_Init()
+{
+    Cvar_RegisterVariable(&r_lerpmodels);
+    Cvar_RegisterVariable(&r_lerpmove);
+}
+
+void R_NewGame()
+{
+}
+
+void R_NewMap()
+{
+}
+
+void R_CheckEfrags()
+{
+}
+
+void R_AddEfrags(entity_t* ent)
+{
+    (void)ent;
+}
+
+void R_TranslatePlayerSkin(int playernum)
+{
+    (void)playernum;
+}
+
+void R_TranslateNewPlayerSkin(int playernum)
+{
+    (void)playernum;
+}
+
+void Sky_LoadSkyBox(const char* name)
+{
+    (void)name;
+}
+
+void Fog_ParseServerMessage()
+{
+    (void)MSG_ReadByte();  // density
+    (void)MSG_ReadByte();  // red
+    (void)MSG_ReadByte();  // green
+    (void)MSG_ReadByte();  // blue
+    (void)MSG_ReadShort(); // time
+}
+
+namespace quake
+{
+
+[[nodiscard]] GLuint make_gl_program(const std::string_view src_vertex,
+    const std::string_view src_geometry,
+    const std::string_view src_frag) noexcept
+{
+    (void)src_vertex;
+    (void)src_geometry;
+    (void)src_frag;
+    return 0;
+}
+
+} // namespace quake
+
+void D_FlushCaches()
+{
+}
+
+int R_LightPoint(const qvec3& p)
+{
+    (void)p;
+    return 0;
+}
+
+void GL_SubdivideSurface(msurface_t* fa)
+{
+    (void)fa;
+}
+
+void GL_ClearBufferBindings()
+{
+}
+
+void Sky_LoadTexture(
+    texture_t* mt, srcformat fmt, unsigned int width, unsigned int height)
+{
+    (void)mt;
+    (void)fmt;
+    (void)width;
+    (void)height;
+}
+
+/*
+==============================================================================
+
+TEXTURES
+
+==============================================================================
+*/
+
+unsigned int d_8to24table[256];
+
+void TexMgr_Init()
+{
+}
+
+void TexMgr_NewGame()
+{
+}
+
+void TexMgr_BeginBatch()
+{
+}
+
+void TexMgr_EndBatch()
+{
+}
+
+gltexture_t* TexMgr_LoadImage(qmodel_t* owner, const char* name, int width,
+    int height, srcformat format, byte* data, const char* source_file,
+    src_offset_t source_offset, unsigned flags)
+{
+    (void)owner;
+    (void)name;
+    (void)width;
+    (void)height;
+    (void)format;
+    (void)data;
+    (void)source_file;
+    (void)source_offset;
+    (void)flags;
+    return nullptr;
+}
+
+void TexMgr_FreeTexturesForOwner(qmodel_t* owner)
+{
+    (void)owner;
+}
+
+int TexMgr_SafeTextureSize(int s)
+{
+    return s;
+}
+
+int TexMgr_PadConditional(int s)
+{
+    return s;
+}
+
+// Only the uncompressed formats are known, so embedded compressed mips are
+// skipped in favour of the regular 8 bit ones.
+srcformat TexMgr_FormatForCode(const char* code)
+{
+    (void)code;
+    return SRC_EXTERNAL;
+}
+
+size_t TexMgr_ImageSize(int width, int height, srcformat format)
+{
+    switch(format)
+    {
+        case SRC_RGBA: return width * height * 4;
+        case SRC_INDEXED: return width * height;
+        default: return 0;
+    }
+}
+
+void GL_Bind(gltexture_t* texture)
+{
+    (void)texture;
+}
+
+byte* Image_LoadImage(
+    const char* name, int* width, int* height, srcformat* fmt, bool* malloced)
+{
+    (void)name;
+    (void)width;
+    (void)height;
+    (void)fmt;
+    (void)malloced;
+    return nullptr;
+}
+
+// The particle textures are only ever uploaded, so every one of them can be
+// the same transparent pixel.
+byte* Image_LoadImage(const char* name, int* width, int* height)
+{
+    static byte pixel[4];
+
+    (void)name;
+    *width = 1;
+    *height = 1;
+    return pixel;
+}
+
+/*
+==============================================================================
+
+2D DRAWING
+
+==============================================================================
+*/
+
+gltexture_t* char_texture;
+qpic_t *pic_ovr, *pic_ins;
+
+void Draw_Init()
+{
+}
+
+void Draw_NewGame()
+{
+}
+
+void Draw_Character(int x, int y, int num, float scale)
+{
+    (void)x;
+    (void)y;
+    (void)num;
+    (void)scale;
+}
+
+void Draw_String(int x, int y, const char* str, float scale)
+{
+    (void)x;
+    (void)y;
+    (void)str;
+    (void)scale;
+}
+
+void Draw_Pic(int x, int y, qpic_t* pic)
+{
+    (void)x;
+    (void)y;
+    (void)pic;
+}
+
+void Draw_SubPic(float x, float y, float w, float h, qpic_t* pic, float s1,
+    float t1, float s2, float t2)
+{
+    (void)x;
+    (void)y;
+    (void)w;
+    (void)h;
+    (void)pic;
+    (void)s1;
+    (void)t1;
+    (void)s2;
+    (void)t2;
+}
+
+void Draw_PicPolygon(qpic_t* pic, unsigned int numverts, polygonvert_t* verts)
+{
+    (void)pic;
+    (void)numverts;
+    (void)verts;
+}
+
+void Draw_ConsoleBackground()
+{
+}
+
+qpic_t* Draw_PicFromWad(const char* name)
+{
+    (void)name;
+    return nullptr;
+}
+
+qpic_t* Draw_TryCachePic(const char* path)
+{
+    (void)path;
+    return nullptr;
+}
+
+void GL_SetCanvas(canvastype newcanvas)
+{
+    (void)newcanvas;
+}
+
+/*
+==============================================================================
+
+SCREEN
+
+==============================================================================
+*/
+
+bool scr_disabled_for_loading;
+int clearnotify;
+int scr_tileclear_updates = 0;
+float scr_centertime_off;
+cvar_t scr_sbarscale = {"scr_sbarscale", "1", CVAR_ARCHIVE};
+
+int scoreboardlines;
+int fragsort[MAX_SCOREBOARD];
+
+void SCR_Init()
+{
+}
+
+void SCR_UpdateScreen()
+{
+}
+
+void SCR_BeginLoadingPlaque()
+{
+}
+
+void SCR_EndLoadingPlaque()
+{
+}
+
+void SCR_CenterPrint(const char* str)
+{
+    (void)str;
+}
+
+void Sbar_Init()
+{
+}
+
+void Sbar_Changed()
+{
+}
+
+int Sbar_ColorForMap(int m)
+{
+    return m;
+}
+
+/*
+==============================================================================
+
+VIEW
+
+==============================================================================
+*/
+
+qvec3 v_punchangles[2];
+
+void V_Init()
+{
+}
+
+// The roll cvars belong to the view code and are never registered without
+// it, so they read as zero.
+qfloat V_CalcRoll(const qvec3& angles, const qvec3& velocity)
+{
+    (void)angles;
+    (void)velocity;
+    return 0;
+}
+
+void V_ParseDamage()
+{
+    (void)MSG_ReadByte(); // armor
+    (void)MSG_ReadByte(); // blood
+    (void)MSG_ReadVec3(cl.protocolflags);
+}
+
+void V_StartPitchDrift()
+{
+}
+
+void V_StopPitchDrift()
+{
+}
@@ -280,6 +280,8 @@ struct VrGunWallCollision
     edict_t* _ent{nullptr};
 };
 
+[[nodiscard]] float VR_GetHandZOrigin(const qvec3& playerOrigin) noexcept;
+
 [[nodiscard]] qvec3 VR_GetAdjustedPlayerOrigin(qvec3 playerOrigin) noexcept;
 
 [[nodiscard]] qvec3 VR_GetWorldHandPos(
@@ -288,6 +290,8 @@ struct VrGunWallCollision
 [[nodiscard]] qvec3 VR_GetResolvedHandPos(edict_t* edict,
     const qvec3& worldHandPos, const qvec3& adjPlayerOrigin) noexcept;
 
+[[nodiscard]] qvec3 VR_CalcLocalWpnMuzzlePos(const int index) noexcept;
+
 qvec3 VR_UpdateGunWallCollisions(edict_t* edict, const int handIndex,
     VrGunWallCollision& out, qvec3 resolvedHandPos) noexcept;
 
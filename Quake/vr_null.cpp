@@ -0,0 +1,73 @@
+#include "vr.hpp"
+#include "vr_cvars.hpp"
+#include "client.hpp"
+
+// VR entry points for `quakevr-server` and `quakevr-timedemo`, which have no
+// headset or controllers. The server still registers the VR cvars, as some of
+// them (e.g. `vr_body_interactions`) are gameplay settings it enforces.
+
+void VR_InitCvars()
+{
+    quake::vr::register_all_cvars();
+}
+
+void VID_VR_Shutdown()
+{
+}
+
+void VR_InitGame()
+{
+}
+
+void VR_ModAllModels()
+{
+}
+
+void VR_OnSpawnServer()
+{
+}
+
+void VR_DoHaptic(const int hand, const float delay, const float duration,
+    const float frequency, const float amplitude)
+{
+    (void)hand;
+    (void)delay;
+    (void)duration;
+    (void)frequency;
+    (void)amplitude;
+}
+
+// With no tracked controllers, the hands rest where the head is.
+[[nodiscard]] qvec3 VR_GetWorldHandPos(
+    const int handIndex, const qvec3& playerOrigin) noexcept
+{
+    (void)handIndex;
+    return {playerOrigin[0], playerOrigin[1], VR_GetHandZOrigin(playerOrigin)};
+}
+
+// There are no weapon view models to take the muzzle offset from.
+[[nodiscard]] qvec3 VR_CalcLocalWpnMuzzlePos(const int index) noexcept
+{
+    (void)index;
+    return vec3_zero;
+}
+
+void VR_OnClientClearState()
+{
+}
+
+void VR_Move(usercmd_t* cmd)
+{
+    (void)cmd;
+}
+
+void VR_PushYaw()
+{
+}
+
+// Without a headset, the aim simply follows the view.
+void VR_SetAngles(const qvec3& angles) noexcept
+{
+    cl.aimangles = angles;
+    cl.viewangles = angles;
+}
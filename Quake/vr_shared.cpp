@@ -0,0 +1,189 @@
+#include "vr.hpp"
+#include "vr_cvars.hpp"
+#include "console.hpp"
+#include "common.hpp"
+#include "progs.hpp"
+#include "qcvm.hpp"
+#include "server.hpp"
+#include "world.hpp"
+#include "util.hpp"
+
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// VR code that does not talk to OpenVR and is needed by the server as well
+// as the client. Built into both `quakevr` and `quakevr-server`.
+
+using quake::util::hitSomething;
+
+//
+//
+// Hand touch
+
+[[nodiscard]] float VR_GetEasyHandTouchBonus() noexcept
+{
+    return 4.5f;
+}
+
+void VR_SetHandtouchParams(int hand, edict_t* player, edict_t* target)
+{
+    player->v.touchinghand = hand;
+    target->v.handtouch_hand = hand;
+    target->v.handtouch_ent = EDICT_TO_PROG(player);
+}
+
+void VR_SetFakeHandtouchParams(edict_t* player, edict_t* target)
+{
+    VR_SetHandtouchParams(2, player, target);
+}
+
+//
+//
+// Hand collision
+
+// Get a reasonable height around where hands should be when aiming a gun.
+[[nodiscard]] float VR_GetHandZOrigin(const qvec3& playerOrigin) noexcept
+{
+    return playerOrigin[2] + vr_floor_offset.value + vr_gun_z_offset.value;
+}
+
+// Get the player origin vector, but adjusted to the upper torso on the Z axis.
+[[nodiscard]] qvec3 VR_GetAdjustedPlayerOrigin(qvec3 playerOrigin) noexcept
+{
+    playerOrigin[2] = VR_GetHandZOrigin(playerOrigin) + 40;
+    return playerOrigin;
+}
+
+[[nodiscard]] qvec3 VR_GetResolvedHandPos(edict_t* edict,
+    const qvec3& worldHandPos, const qvec3& adjPlayerOrigin) noexcept
+{
+    // Size of hand hitboxes.
+    constexpr qvec3 mins{-1.f, -1.f, -1.f};
+    constexpr qvec3 maxs{1.f, 1.f, 1.f};
+
+    // Trace from upper torso to desired final location. `SV_Move` detects
+    // entities as well, not just geometry.
+    const trace_t trace =
+        SV_Move(adjPlayerOrigin, mins, maxs, worldHandPos, MOVE_NORMAL, edict);
+
+    // Compute final collision resolution position, starting from the
+    // desired position and resolving only against the collision plane's
+    // normal vector.
+    if(!hitSomething(trace))
+    {
+        return worldHandPos;
+    }
+
+    // Resolve collision along trace normals.
+    qvec3 res = worldHandPos;
+
+    for(int i = 0; i < 3; ++i)
+    {
+        if(trace.plane.normal[i] != 0)
+        {
+            res[i] = trace.endpos[i];
+        }
+    }
+
+    return res;
+}
+
+qvec3 VR_UpdateGunWallCollisions(edict_t* edict, const int handIndex,
+    VrGunWallCollision& out, qvec3 resolvedHandPos) noexcept
+{
+    constexpr qvec3 handMins{-1.f, -1.f, -1.f};
+    constexpr qvec3 handMaxs{1.f, 1.f, 1.f};
+
+    // Local position of the gun's muzzle. Takes orientation into
+    // account.
+    const auto localMuzzlePos = VR_CalcLocalWpnMuzzlePos(handIndex);
+
+    // World position of the gun's muzzle.
+    const auto muzzlePos = resolvedHandPos + localMuzzlePos;
+
+    // Check for collisions between the muzzle and geometry/entities.
+    const trace_t gunTrace = SV_Move(
+        resolvedHandPos, handMins, handMaxs, muzzlePos, MOVE_NORMAL, edict);
+
+    // Position of the hand after resolving collisions with the gun
+    // muzzle.
+    const auto resolvedHandMuzzlePos = gunTrace.endpos - localMuzzlePos;
+
+    if(hitSomething(gunTrace))
+    {
+        // TODO VR: (P2) haptics cancel each other
+        // VR_DoHaptic(index, 0.f, 0.1f, 50, 1.f - gunTrace.fraction);
+
+        out._colliding = true;
+        out._ent = gunTrace.ent;
+
+        for(int i = 0; i < 3; ++i)
+        {
+            out._normals[i] = gunTrace.plane.normal[i] != 0;
+            resolvedHandPos[i] = resolvedHandMuzzlePos[i];
+        }
+    }
+    else
+    {
+        out._colliding = false;
+        out._ent = nullptr;
+    }
+
+    return resolvedHandPos;
+}
+
+//
+//
+// PAK Stuff
+
+[[nodiscard]] const std::string& VR_GetActiveStartPakName()
+{
+    const std::size_t idx = vr_activestartpaknameidx.value;
+    const auto& vec = VR_GetLoadedPakNamesWithStartMaps();
+    return vec[idx % vec.size()];
+}
+
+[[nodiscard]] std::vector<std::string>& VR_GetLoadedPakNames()
+{
+    static std::vector<std::string> res;
+    return res;
+}
+
+[[nodiscard]] std::vector<std::string>& VR_GetLoadedPakNamesWithStartMaps()
+{
+    static std::vector<std::string> res;
+    return res;
+}
+
+[[nodiscard]] std::string VR_ExtractPakName(std::string_view sv)
+{
+    const auto afterSlash = sv.find_last_of("/\\") + 1;
+    sv = sv.substr(afterSlash, sv.size() - afterSlash);
+    sv.remove_suffix(4);
+
+    return std::string(sv.data(), sv.size());
+}
+
+[[nodiscard]] std::string VR_ExtractPakName(const pack_t& pak)
+{
+    return VR_ExtractPakName(pak.filename);
+}
+
+void VR_OnLoadedPak(pack_t& pak)
+{
+    const auto extractedName = VR_ExtractPakName(pak);
+
+    VR_GetLoadedPakNames().emplace_back(extractedName);
+    Con_Printf("Added pakfile to search paths: '%s'\n", extractedName.data());
+
+    for(int i = 0; i < pak.numfiles; i++)
+    {
+        if(std::strcmp(pak.files[i].name, "maps/start.bsp") == 0)
+        {
+            VR_GetLoadedPakNamesWithStartMaps().emplace_back(extractedName);
+            continue;
+        }
+    }
+}
@@ -33,6 +33,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "sys.hpp"
 #include "areanode.hpp"
 #include "qcvm.hpp"
+#include "sv_bench.hpp"
 
 #include <cassert>
 
@@ -229,13 +230,30 @@ ENTITY AREA CHECKING
 
 
 
+cvar_t sv_areadepth = {"sv_areadepth", "0", CVAR_NONE};
+
+// leaf nodes are not split below this size on either axis
+#define AREA_MIN_LEAF_SIZE 1024.f
+
+// number of edicts looked at by the area node walks, see SV_AreaStats_f
+struct sv_areastats_t
+{
+    int clip;  // SV_ClipToLinks
+    int touch; // SV_AreaTriggerEdicts
+    int query; // SV_AreaEdicts
+};
+
+static sv_areastats_t sv_areastats;
+static sv_areastats_t sv_areastats_lastframe;
+
 /*
 ===============
 SV_CreateAreaNode
 
 ===============
 */
-areanode_t* SV_CreateAreaNode(int depth, const qvec3& mins, const qvec3& maxs)
+areanode_t* SV_CreateAreaNode(
+    int depth, const int maxdepth, const qvec3& mins, const qvec3& maxs)
 {
     // QSS
     areanode_t* anode = &qcvm->areanodes[qcvm->numareanodes];
@@ -244,7 +262,7 @@ areanode_t* SV_CreateAreaNode(int depth, const qvec3& mins, const qvec3& maxs)
     ClearLink(&anode->trigger_edicts);
     ClearLink(&anode->solid_edicts);
 
-    if(depth == AREA_DEPTH)
+    if(depth == maxdepth)
     {
         anode->axis = -1;
         anode->children[0] = anode->children[1] = nullptr;
@@ -270,12 +288,54 @@ areanode_t* SV_CreateAreaNode(int depth, const qvec3& mins, const qvec3& maxs)
 
     maxs1[anode->axis] = mins2[anode->axis] = anode->dist;
 
-    anode->children[0] = SV_CreateAreaNode(depth + 1, mins2, maxs2);
-    anode->children[1] = SV_CreateAreaNode(depth + 1, mins1, maxs1);
+    anode->children[0] = SV_CreateAreaNode(depth + 1, maxdepth, mins2, maxs2);
+    anode->children[1] = SV_CreateAreaNode(depth + 1, maxdepth, mins1, maxs1);
 
     return anode;
 }
 
+/*
+===============
+SV_AreaDepth
+
+The original fixed depth of 4 gives 16 leaves whatever the map size, so big
+maps end up with hundreds of edicts per list. Keep splitting until the leaves
+get down to AREA_MIN_LEAF_SIZE, but never into more leaves than there can be
+edicts to put in them.
+===============
+*/
+static int SV_AreaDepth(const qvec3& mins, const qvec3& maxs)
+{
+    if(sv_areadepth.value > 0)
+    {
+        return CLAMP(1, (int)sv_areadepth.value, AREA_MAX_DEPTH);
+    }
+
+    const qvec3 size = maxs - mins;
+    float sizex = size[0];
+    float sizey = size[1];
+
+    int depth = 0;
+    while(depth < AREA_MAX_DEPTH &&
+          q_max(sizex, sizey) > 2.f * AREA_MIN_LEAF_SIZE &&
+          (1 << depth) < qcvm->max_edicts)
+    {
+        // same axis choice as SV_CreateAreaNode
+        if(sizex > sizey)
+        {
+            sizex *= 0.5f;
+        }
+        else
+        {
+            sizey *= 0.5f;
+        }
+
+        ++depth;
+    }
+
+    return q_max(depth, AREA_DEPTH);
+}
+
 /*
 ===============
 SV_ClearWorld
@@ -288,7 +348,64 @@ void SV_ClearWorld()
 
     memset(qcvm->areanodes, 0, sizeof(qcvm->areanodes));
     qcvm->numareanodes = 0;
-    SV_CreateAreaNode(0, qcvm->worldmodel->mins, qcvm->worldmodel->maxs);
+    qcvm->areadepth =
+        SV_AreaDepth(qcvm->worldmodel->mins, qcvm->worldmodel->maxs);
+    SV_CreateAreaNode(0, qcvm->areadepth, qcvm->worldmodel->mins,
+        qcvm->worldmodel->maxs);
+}
+
+/*
+===============
+SV_AreaStatsFrame
+
+Called at the start of every server frame.
+===============
+*/
+void SV_AreaStatsFrame()
+{
+    sv_areastats_lastframe = sv_areastats;
+    sv_areastats = {};
+}
+
+/*
+===============
+SV_AreaStats_f
+
+===============
+*/
+void SV_AreaStats_f()
+{
+    if(!sv.active)
+    {
+        Con_Printf("sv_areastats: no server running\n");
+        return;
+    }
+
+    QCVMGuard qg{&sv.qcvm};
+
+    int linked = 0;
+    int longest = 0;
+    for(int i = 0; i < qcvm->numareanodes; i++)
+    {
+        const areanode_t& node = qcvm->areanodes[i];
+        for(const link_t* list : {&node.trigger_edicts, &node.solid_edicts})
+        {
+            int len = 0;
+            for(const link_t* l = list->next; l != list; l = l->next)
+            {
+                ++len;
+            }
+
+            linked += len;
+            longest = q_max(longest, len);
+        }
+    }
+
+    Con_Printf("area nodes: %d (depth %d), %d linked edicts, longest list %d\n",
+        qcvm->numareanodes, qcvm->areadepth, linked, longest);
+    Con_Printf("last frame candidates: %d clip, %d touch, %d query\n",
+        sv_areastats_lastframe.clip, sv_areastats_lastframe.touch,
+        sv_areastats_lastframe.query);
 }
 
 
@@ -309,6 +426,82 @@ void SV_UnlinkEdict(edict_t* ent)
 }
 
 
+/*
+====================
+SV_AreaEdicts_r
+
+====================
+*/
+static void SV_AreaEdicts_r(areanode_t* node, const qvec3& mins,
+    const qvec3& maxs, edict_t** list, int* listcount, const int listspace)
+{
+    const auto loopEdicts = [&](link_t& edictList) {
+        for(link_t* l = edictList.next; l != &edictList; l = l->next)
+        {
+            edict_t* target = EDICT_FROM_AREA(l);
+            ++sv_areastats.query;
+
+            if(!quake::util::boxIntersection(
+                   mins, maxs, target->v.absmin, target->v.absmax))
+            {
+                continue;
+            }
+
+            if(*listcount == listspace)
+            {
+                // should never happen
+                assert(false);
+                return;
+            }
+
+            list[*listcount] = target;
+            (*listcount)++;
+        }
+    };
+
+    loopEdicts(node->trigger_edicts);
+    loopEdicts(node->solid_edicts);
+
+    // recurse down both sides
+    if(node->axis == -1)
+    {
+        return;
+    }
+
+    if(maxs[node->axis] > node->dist)
+    {
+        SV_AreaEdicts_r(
+            node->children[0], mins, maxs, list, listcount, listspace);
+    }
+
+    if(mins[node->axis] < node->dist)
+    {
+        SV_AreaEdicts_r(
+            node->children[1], mins, maxs, list, listcount, listspace);
+    }
+}
+
+/*
+====================
+SV_AreaEdicts
+
+Spatial query over the area nodes: only visits the nodes whose half-spaces
+touch the box, so the cost depends on how crowded the area is rather than on
+num_edicts.
+====================
+*/
+int SV_AreaEdicts(
+    const qvec3& mins, const qvec3& maxs, edict_t** list, const int listspace)
+{
+    int listcount = 0;
+
+    // QSS
+    SV_AreaEdicts_r(qcvm->areanodes, mins, maxs, list, &listcount, listspace);
+
+    return listcount;
+}
+
+
 /*
 ====================
 SV_AreaTriggerEdicts
@@ -327,6 +520,7 @@ static void SV_AreaTriggerEdicts(edict_t* ent, areanode_t* node, edict_t** list,
         {
             next = l->next;
             edict_t* target = EDICT_FROM_AREA(l);
+            ++sv_areastats.touch;
 
             if(target == ent)
             {
@@ -1151,6 +1345,8 @@ void SV_ClipToLinks(areanode_t* node, moveclip_t* clip)
     {
         next = l->next;
         edict_t* target = EDICT_FROM_AREA(l);
+        ++sv_areastats.clip;
+
         if(target->v.solid == SOLID_NOT ||
             target->v.solid == SOLID_NOT_BUT_TOUCHABLE ||
             target == clip->passedict)
@@ -1317,6 +1513,9 @@ SV_Move
 trace_t SV_Move(const qvec3& start, const qvec3& mins, const qvec3& maxs,
     const qvec3& end, const int type, edict_t* const passedict)
 {
+    const quake::bench::Timer benchTimer =
+        quake::svbench::startTimer(quake::svbench::Phase::Move);
+
     moveclip_t clip;
     memset(&clip, 0, sizeof(moveclip_t));
 
@@ -1365,6 +1564,7 @@ trace_t SV_Move(const qvec3& start, const qvec3& mins, const qvec3& maxs,
     // clip to entities
     SV_ClipToLinks(qcvm->areanodes, &clip); // QSS
 
+    quake::svbench::stopTimer(benchTimer);
     return clip.trace;
 }
 
@@ -58,11 +58,20 @@ struct trace_t
 void SV_ClearWorld();
 // called after the world model has been loaded, before linking any entities
 
+void SV_AreaStatsFrame();
+void SV_AreaStats_f();
+// per-frame count of the edicts the area node walks looked at
+
 void SV_UnlinkEdict(edict_t* ent);
 // call before removing an entity, and before trying to move one,
 // so it doesn't clip against itself
 // flags ent->v.modified
 
+int SV_AreaEdicts(
+    const qvec3& mins, const qvec3& maxs, edict_t** list, int listspace);
+// fills list with the linked edicts whose absmin/absmax touch the box and
+// returns how many were written. SOLID_NOT edicts are never linked.
+
 void SV_LinkEdict(edict_t* ent, bool touch_triggers);
 // Needs to be called any time an entity changes origin, mins, maxs, or solid
 // flags ent->v.modified
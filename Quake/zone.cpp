@@ -32,6 +32,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "sys.hpp"
 #include "gl_texmgr.hpp"
 
+#include <mutex>
+
 #define DYNAMIC_SIZE \
     (4 * 1024 * 1024) // ericw -- was 512KB (64-bit) / 384KB (32-bit)
 
@@ -711,9 +713,16 @@ typedef struct cache_system_s
 } cache_system_t;
 
 cache_system_t* Cache_TryAlloc(int size, bool nobottom);
+static void Cache_Unlink(cache_user_t* c);
 
 cache_system_t cache_head;
 
+std::mutex& Cache_Mutex() noexcept
+{
+    static std::mutex res;
+    return res;
+}
+
 /*
 ===========
 Cache_Move
@@ -729,10 +738,11 @@ void Cache_Move(cache_system_t* c)
     {
         //		Con_Printf ("cache_move ok\n");
 
+        std::lock_guard lock{Cache_Mutex()};
         Q_memcpy(new_cs + 1, c + 1, c->size - sizeof(cache_system_t));
         new_cs->user = c->user;
         Q_memcpy(new_cs->name, c->name, sizeof(new_cs->name));
-        Cache_Free(c->user, false); // johnfitz -- added second argument
+        Cache_Unlink(c->user);
         new_cs->user->data = (void*)(new_cs + 1);
     }
     else
@@ -977,13 +987,12 @@ void Cache_Init()
 
 /*
 ==============
-Cache_Free
+Cache_Unlink
 
-Frees the memory and removes it from the LRU list
+Frees the memory and removes it from the LRU list, with Cache_Mutex held
 ==============
 */
-void Cache_Free(
-    cache_user_t* c, bool freetextures) // johnfitz -- added second argument
+static void Cache_Unlink(cache_user_t* c)
 {
     cache_system_t* cs;
 
@@ -1001,6 +1010,22 @@ void Cache_Free(
     c->data = nullptr;
 
     Cache_UnlinkLRU(cs);
+}
+
+/*
+==============
+Cache_Free
+
+Frees the memory and removes it from the LRU list
+==============
+*/
+void Cache_Free(
+    cache_user_t* c, bool freetextures) // johnfitz -- added second argument
+{
+    {
+        std::lock_guard lock{Cache_Mutex()};
+        Cache_Unlink(c);
+    }
 
     // johnfitz -- if a model becomes uncached, free the gltextures.  This only
     // works becuase the cache_user_t is the last component of the qmodel_t
@@ -1066,8 +1091,10 @@ void* Cache_Alloc(cache_user_t* c, int size, const char* name)
         if(cs)
         {
             q_strlcpy(cs->name, name, CACHENAME_LEN);
-            c->data = (void*)(cs + 1);
             cs->user = c;
+
+            std::lock_guard lock{Cache_Mutex()};
+            c->data = (void*)(cs + 1);
             break;
         }
 
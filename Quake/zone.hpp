@@ -23,6 +23,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #pragma once
 
+#include <mutex>
+
 /*
  memory allocation
 
@@ -157,3 +159,9 @@ void* Cache_Alloc(cache_user_t* c, int size, const char* name);
 // wasn't enough room.
 
 void Cache_Report();
+
+// Held by the cache while it moves or frees a block, or points a
+// cache_user_t at a new one. Threads other than the main one (the sound
+// mixer) look up cache data and use it with this held, so that it can't go
+// away under them.
+[[nodiscard]] std::mutex& Cache_Mutex() noexcept;